@@ -0,0 +1,169 @@
+#include "ChangeCoalescer.h"
+#include "Metrics.h"
+
+namespace {
+    bool isHexDigit(wchar_t c) {
+        return (c >= L'0' && c <= L'9') || (c >= L'a' && c <= L'f') || (c >= L'A' && c <= L'F');
+    }
+
+    ObjectChangeInfo makeChange(std::wstring_view name, std::wstring_view type, ChangeType changeType, EventTick tick) {
+        ObjectChangeInfo changeInfo;
+        changeInfo.objectName = name;
+        changeInfo.objectType = type;
+        changeInfo.changeType = changeType;
+        changeInfo.tick = tick;
+        Metrics::instance().stringAllocated(name.size());
+        Metrics::instance().stringAllocated(type.size());
+        return changeInfo;
+    }
+}
+
+const wchar_t* changeTypeName(ChangeType changeType) {
+    switch (changeType) {
+    case ChangeType::Created: return L"Created";
+    case ChangeType::Deleted: return L"Deleted";
+    case ChangeType::Modified: return L"Modified";
+    case ChangeType::Transient: return L"Transient";
+    }
+    return L"Unknown";
+}
+
+ChangeCoalescer::ChangeCoalescer(CoalescingOptions options) : options(options) {
+}
+
+void ChangeCoalescer::created(std::wstring_view name, std::wstring_view type, EventTick tick,
+    const Callback& deliver) {
+    if (options.window.count() <= 0 || pending.size() >= options.maxPending) {
+        deliver(makeChange(name, type, ChangeType::Created, tick));
+        return;
+    }
+
+    auto it = pending.find(name);
+    if (it == pending.end()) {
+        pending.emplace_hint(it, std::wstring(name), PendingObject{ std::wstring(type), tick });
+        Metrics& metrics = Metrics::instance();
+        metrics.add(MetricCounter::Allocations);
+        metrics.stringAllocated(name.size());
+        metrics.stringAllocated(type.size());
+    }
+}
+
+void ChangeCoalescer::deleted(std::wstring_view name, std::wstring_view type, EventTick tick,
+    const Callback& deliver) {
+    auto it = pending.find(name);
+    if (it == pending.end()) {
+        deliver(makeChange(name, type, ChangeType::Deleted, tick));
+        return;
+    }
+
+    std::wstring pattern = namePattern(name);
+    auto key = std::make_pair(std::move(it->second.type), std::move(pattern));
+    pending.erase(it);
+
+    if (transients.find(key) == transients.end()) {
+        size_t& patterns = patternsPerType[key.first];
+        if (patterns >= options.maxPatterns) {
+            key.second = L"*";
+        }
+        else {
+            patterns++;
+        }
+    }
+    transients[key]++;
+    Metrics::instance().add(MetricCounter::TransientObjects);
+}
+
+bool ChangeCoalescer::windowElapsed(EventTick since, EventTick tick) const {
+    return tick - since >= static_cast<EventTick>(std::chrono::nanoseconds(options.window).count());
+}
+
+void ChangeCoalescer::advance(EventTick tick, const Callback& deliver) {
+    if (options.window.count() <= 0) {
+        // The window was switched off; release what it was holding.
+        if (!pending.empty() || !transients.empty()) {
+            flush(tick, deliver);
+        }
+        return;
+    }
+
+    for (auto it = pending.begin(); it != pending.end();) {
+        if (windowElapsed(it->second.seen, tick)) {
+            deliver(makeChange(it->first, it->second.type, ChangeType::Created, it->second.seen));
+            it = pending.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+
+    if (!windowOpen) {
+        windowStart = tick;
+        windowOpen = true;
+    }
+    else if (windowElapsed(windowStart, tick)) {
+        deliverAggregates(tick, deliver);
+        windowStart = tick;
+    }
+}
+
+void ChangeCoalescer::flush(EventTick tick, const Callback& deliver) {
+    std::map<std::pair<std::wstring, std::wstring>, std::pair<const std::wstring*, size_t>> created;
+    for (const auto& [name, object] : pending) {
+        auto& group = created[std::make_pair(object.type, namePattern(name))];
+        group.first = &name;
+        group.second++;
+    }
+    for (const auto& [key, group] : created) {
+        ObjectChangeInfo changeInfo = makeChange(group.second == 1 ? *group.first : key.second, key.first,
+            ChangeType::Created, tick);
+        changeInfo.count = group.second;
+        deliver(changeInfo);
+    }
+    pending.clear();
+    deliverAggregates(tick, deliver);
+    windowOpen = false;
+}
+
+void ChangeCoalescer::deliverAggregates(EventTick tick, const Callback& deliver) {
+    for (const auto& [key, count] : transients) {
+        ObjectChangeInfo changeInfo = makeChange(key.second, key.first, ChangeType::Transient, tick);
+        changeInfo.count = count;
+        deliver(changeInfo);
+    }
+    transients.clear();
+    patternsPerType.clear();
+}
+
+std::wstring ChangeCoalescer::namePattern(std::wstring_view name) {
+    std::wstring pattern;
+    pattern.reserve(name.size());
+
+    size_t i = 0;
+    while (i < name.size()) {
+        if (!isHexDigit(name[i])) {
+            pattern += name[i++];
+            continue;
+        }
+
+        size_t runStart = i;
+        size_t digits = 0;
+        while (i < name.size() && isHexDigit(name[i])) {
+            digits += name[i] >= L'0' && name[i] <= L'9';
+            i++;
+        }
+        if (digits > 0 && i - runStart >= 8) {
+            pattern += L'*';
+            continue;
+        }
+        for (size_t j = runStart; j < i; j++) {
+            bool digit = name[j] >= L'0' && name[j] <= L'9';
+            if (!digit) {
+                pattern += name[j];
+            }
+            else if (pattern.empty() || pattern.back() != L'*') {
+                pattern += L'*';
+            }
+        }
+    }
+    return pattern;
+}
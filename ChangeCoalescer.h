@@ -0,0 +1,92 @@
+#pragma once
+#include "Timestamp.h"
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <utility>
+
+enum class ChangeType : uint8_t {
+    Created,
+    Deleted,
+    Modified,
+    // Per-window aggregate of objects created and deleted within the window.
+    Transient
+};
+
+const wchar_t* changeTypeName(ChangeType changeType);
+
+struct ObjectChangeInfo {
+    std::wstring objectName;
+    std::wstring objectType;
+    // Tick of the scan that saw the change.
+    EventTick tick = 0;
+    // Aggregates, and Created events for objects still held back when
+    // monitoring stops, carry a name pattern in objectName and the objects
+    // it stands for in count.
+    size_t count = 1;
+    ChangeType changeType = ChangeType::Created;
+};
+
+struct CoalescingOptions {
+    // A Created event is held back this long; if the object is deleted
+    // within it, the pair is folded into a Transient count instead.
+    // Zero delivers every event as it is seen.
+    std::chrono::milliseconds window{ 0 };
+    // Objects held back at once. Past this, creations are delivered raw.
+    size_t maxPending = 100000;
+    // Distinct name patterns per type and window. Past this, transients
+    // of that type are counted under "*".
+    size_t maxPatterns = 64;
+};
+
+// Sits between the monitor's diff and its change callback. Objects that
+// live shorter than the window never reach the callback individually;
+// each window ends with one Transient event per type and name pattern, so
+// delivery is bounded by the number of long-lived changes plus the number
+// of patterns, however fast the host creates and deletes objects.
+class ChangeCoalescer {
+public:
+    using Callback = std::function<void(const ObjectChangeInfo&)>;
+
+    explicit ChangeCoalescer(CoalescingOptions options = {});
+
+    void setOptions(const CoalescingOptions& newOptions) { options = newOptions; }
+    const CoalescingOptions& getOptions() const { return options; }
+
+    void created(std::wstring_view name, std::wstring_view type, EventTick tick, const Callback& deliver);
+    void deleted(std::wstring_view name, std::wstring_view type, EventTick tick, const Callback& deliver);
+    // Whether the creation of name is still held back.
+    bool isPending(std::wstring_view name) const { return pending.find(name) != pending.end(); }
+
+    // Delivers creations that outlived the window and, once a window has
+    // elapsed, its Transient aggregates. Call once per monitor tick.
+    void advance(EventTick tick, const Callback& deliver);
+    // Delivers everything held back, for when monitoring stops. Objects
+    // whose lifetime is still open are grouped by pattern as well.
+    void flush(EventTick tick, const Callback& deliver);
+
+    // Runs of decimal digits, and hex runs of eight or more characters
+    // containing a digit (GUIDs, hashes), become '*': "Churn_1234" and
+    // "Churn_98" share the pattern "Churn_*".
+    static std::wstring namePattern(std::wstring_view name);
+
+private:
+    struct PendingObject {
+        std::wstring type;
+        EventTick seen;
+    };
+
+    bool windowElapsed(EventTick since, EventTick tick) const;
+    void deliverAggregates(EventTick tick, const Callback& deliver);
+
+    CoalescingOptions options;
+    std::map<std::wstring, PendingObject, std::less<>> pending;
+    // (type, pattern) -> objects created and deleted in the current window.
+    std::map<std::pair<std::wstring, std::wstring>, size_t> transients;
+    std::map<std::wstring, size_t, std::less<>> patternsPerType;
+    EventTick windowStart = 0;
+    bool windowOpen = false;
+};
@@ -0,0 +1,290 @@
+#include "DependencyGraph.h"
+#include <algorithm>
+#include <limits>
+
+namespace {
+    const DependencyGraph::Node Unvisited = std::numeric_limits<DependencyGraph::Node>::max();
+
+    void appendXmlEscaped(std::wstring& out, std::wstring_view text) {
+        for (wchar_t c : text) {
+            switch (c) {
+            case L'&': out += L"&amp;"; break;
+            case L'<': out += L"&lt;"; break;
+            case L'>': out += L"&gt;"; break;
+            case L'"': out += L"&quot;"; break;
+            default: out += c; break;
+            }
+        }
+    }
+
+    void appendDotEscaped(std::wstring& out, std::wstring_view text) {
+        for (wchar_t c : text) {
+            if (c == L'"' || c == L'\\') {
+                out += L'\\';
+            }
+            out += c;
+        }
+    }
+}
+
+DependencyGraph::DependencyGraph(const std::vector<ObjectDependency>& dependencies) {
+    std::vector<Node> sources;
+    std::vector<Node> targets;
+    std::vector<uint8_t> edgeKindList;
+    sources.reserve(dependencies.size());
+    targets.reserve(dependencies.size());
+    edgeKindList.reserve(dependencies.size());
+
+    for (const auto& dep : dependencies) {
+        sources.push_back(intern(dep.sourceObject));
+        targets.push_back(intern(dep.targetObject));
+        edgeKindList.push_back(kindOf(dep.dependencyType));
+    }
+
+    // Counting sort of the edges by source into adjacency arrays.
+    edgeOffsets.assign(names.size() + 1, 0);
+    inDegree.assign(names.size(), 0);
+    for (size_t i = 0; i < sources.size(); i++) {
+        edgeOffsets[sources[i] + 1]++;
+        inDegree[targets[i]]++;
+    }
+    for (size_t node = 0; node < names.size(); node++) {
+        edgeOffsets[node + 1] += edgeOffsets[node];
+    }
+
+    std::vector<size_t> fill(edgeOffsets.begin(), edgeOffsets.end() - 1);
+    edgeTargets.resize(sources.size());
+    edgeKinds.resize(sources.size());
+    for (size_t i = 0; i < sources.size(); i++) {
+        size_t slot = fill[sources[i]]++;
+        edgeTargets[slot] = targets[i];
+        edgeKinds[slot] = edgeKindList[i];
+    }
+}
+
+DependencyGraph::Node DependencyGraph::intern(const std::wstring& name) {
+    auto it = nodeIndex.find(name);
+    if (it != nodeIndex.end()) {
+        return it->second;
+    }
+    Node node = static_cast<Node>(names.size());
+    names.push_back(name);
+    nodeIndex.emplace(names.back(), node);
+    return node;
+}
+
+uint8_t DependencyGraph::kindOf(const std::wstring& kind) {
+    for (size_t i = 0; i < kinds.size(); i++) {
+        if (kinds[i] == kind) {
+            return static_cast<uint8_t>(i);
+        }
+    }
+    if (kinds.size() > std::numeric_limits<uint8_t>::max()) {
+        return std::numeric_limits<uint8_t>::max();
+    }
+    kinds.push_back(kind);
+    return static_cast<uint8_t>(kinds.size() - 1);
+}
+
+std::vector<DependencyGraph::Node> DependencyGraph::topByDegree(size_t k,
+    const std::function<size_t(Node)>& degree) const {
+    std::vector<Node> nodes;
+    for (Node node = 0; node < names.size(); node++) {
+        if (degree(node) > 0) {
+            nodes.push_back(node);
+        }
+    }
+
+    auto higher = [&](Node a, Node b) {
+        size_t degreeA = degree(a);
+        size_t degreeB = degree(b);
+        return degreeA != degreeB ? degreeA > degreeB : a < b;
+    };
+    if (nodes.size() > k) {
+        std::nth_element(nodes.begin(), nodes.begin() + k, nodes.end(), higher);
+        nodes.resize(k);
+    }
+    std::sort(nodes.begin(), nodes.end(), higher);
+    return nodes;
+}
+
+std::vector<DependencyGraph::Node> DependencyGraph::topFanIn(size_t k) const {
+    return topByDegree(k, [this](Node node) { return fanIn(node); });
+}
+
+std::vector<DependencyGraph::Node> DependencyGraph::topFanOut(size_t k) const {
+    return topByDegree(k, [this](Node node) { return fanOut(node); });
+}
+
+std::vector<std::vector<DependencyGraph::Node>> DependencyGraph::cycles() const {
+    // Tarjan's algorithm with an explicit call stack; link chains can be
+    // far deeper than the thread stack allows for recursion.
+    std::vector<std::vector<Node>> components;
+    std::vector<Node> order(names.size(), Unvisited);
+    std::vector<Node> lowLink(names.size(), 0);
+    std::vector<bool> onStack(names.size(), false);
+    std::vector<Node> stack;
+    std::vector<std::pair<Node, size_t>> calls;
+    Node nextOrder = 0;
+
+    for (Node root = 0; root < names.size(); root++) {
+        if (order[root] != Unvisited) {
+            continue;
+        }
+        order[root] = lowLink[root] = nextOrder++;
+        stack.push_back(root);
+        onStack[root] = true;
+        calls.emplace_back(root, edgeOffsets[root]);
+
+        while (!calls.empty()) {
+            auto& [node, edge] = calls.back();
+            if (edge < edgeOffsets[node + 1]) {
+                Node target = edgeTargets[edge++];
+                if (order[target] == Unvisited) {
+                    order[target] = lowLink[target] = nextOrder++;
+                    stack.push_back(target);
+                    onStack[target] = true;
+                    calls.emplace_back(target, edgeOffsets[target]);
+                }
+                else if (onStack[target]) {
+                    lowLink[node] = std::min(lowLink[node], order[target]);
+                }
+                continue;
+            }
+
+            Node finished = node;
+            calls.pop_back();
+            if (!calls.empty()) {
+                Node parent = calls.back().first;
+                lowLink[parent] = std::min(lowLink[parent], lowLink[finished]);
+            }
+            if (lowLink[finished] != order[finished]) {
+                continue;
+            }
+
+            std::vector<Node> component;
+            Node member;
+            do {
+                member = stack.back();
+                stack.pop_back();
+                onStack[member] = false;
+                component.push_back(member);
+            } while (member != finished);
+
+            bool selfLoop = component.size() == 1 &&
+                std::find(edgeTargets.begin() + edgeOffsets[finished], edgeTargets.begin() + edgeOffsets[finished + 1],
+                    finished) != edgeTargets.begin() + edgeOffsets[finished + 1];
+            if (component.size() > 1 || selfLoop) {
+                std::reverse(component.begin(), component.end());
+                components.push_back(std::move(component));
+            }
+        }
+    }
+    return components;
+}
+
+std::vector<std::pair<DependencyGraph::Node, DependencyGraph::Node>> DependencyGraph::orphanedLinks(
+    const std::function<bool(const std::wstring&)>& exists) const {
+    std::vector<std::pair<Node, Node>> orphans;
+    auto link = std::find(kinds.begin(), kinds.end(), L"SymbolicLink");
+    if (link == kinds.end()) {
+        return orphans;
+    }
+    uint8_t linkKind = static_cast<uint8_t>(link - kinds.begin());
+
+    for (Node node = 0; node < names.size(); node++) {
+        for (size_t edge = edgeOffsets[node]; edge < edgeOffsets[node + 1]; edge++) {
+            if (edgeKinds[edge] == linkKind && !exists(names[edgeTargets[edge]])) {
+                orphans.emplace_back(node, edgeTargets[edge]);
+            }
+        }
+    }
+    return orphans;
+}
+
+std::vector<std::pair<DependencyGraph::Node, size_t>> DependencyGraph::sectionsPerProcess() const {
+    std::vector<std::pair<Node, size_t>> processes;
+    auto shared = std::find(kinds.begin(), kinds.end(), L"SharedMemory");
+    if (shared == kinds.end()) {
+        return processes;
+    }
+    uint8_t sharedKind = static_cast<uint8_t>(shared - kinds.begin());
+
+    std::vector<size_t> sections(names.size(), 0);
+    for (size_t edge = 0; edge < edgeTargets.size(); edge++) {
+        if (edgeKinds[edge] == sharedKind) {
+            sections[edgeTargets[edge]]++;
+        }
+    }
+    for (Node node = 0; node < names.size(); node++) {
+        if (sections[node] > 0) {
+            processes.emplace_back(node, sections[node]);
+        }
+    }
+    std::sort(processes.begin(), processes.end(), [](const auto& a, const auto& b) {
+        return a.second != b.second ? a.second > b.second : a.first < b.first;
+    });
+    return processes;
+}
+
+void DependencyGraph::writeGraphML(OutputSink& out) const {
+    out.writeText(L"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        L"<graphml xmlns=\"http://graphml.graphdrawing.org/xmlns\">\n"
+        L"  <key id=\"name\" for=\"node\" attr.name=\"name\" attr.type=\"string\"/>\n"
+        L"  <key id=\"kind\" for=\"edge\" attr.name=\"kind\" attr.type=\"string\"/>\n"
+        L"  <graph id=\"dependencies\" edgedefault=\"directed\">\n");
+
+    std::wstring line;
+    for (Node node = 0; node < names.size(); node++) {
+        line.assign(L"    <node id=\"n");
+        line += std::to_wstring(node);
+        line += L"\"><data key=\"name\">";
+        appendXmlEscaped(line, names[node]);
+        line += L"</data></node>\n";
+        out.writeText(line);
+    }
+    for (Node node = 0; node < names.size(); node++) {
+        for (size_t edge = edgeOffsets[node]; edge < edgeOffsets[node + 1]; edge++) {
+            line.assign(L"    <edge source=\"n");
+            line += std::to_wstring(node);
+            line += L"\" target=\"n";
+            line += std::to_wstring(edgeTargets[edge]);
+            line += L"\"><data key=\"kind\">";
+            appendXmlEscaped(line, kinds[edgeKinds[edge]]);
+            line += L"</data></edge>\n";
+            out.writeText(line);
+        }
+    }
+
+    out.writeText(L"  </graph>\n</graphml>\n");
+    out.flush();
+}
+
+void DependencyGraph::writeDot(OutputSink& out) const {
+    out.writeText(L"digraph dependencies {\n");
+
+    std::wstring line;
+    for (Node node = 0; node < names.size(); node++) {
+        line.assign(L"  n");
+        line += std::to_wstring(node);
+        line += L" [label=\"";
+        appendDotEscaped(line, names[node]);
+        line += L"\"];\n";
+        out.writeText(line);
+    }
+    for (Node node = 0; node < names.size(); node++) {
+        for (size_t edge = edgeOffsets[node]; edge < edgeOffsets[node + 1]; edge++) {
+            line.assign(L"  n");
+            line += std::to_wstring(node);
+            line += L" -> n";
+            line += std::to_wstring(edgeTargets[edge]);
+            line += L" [label=\"";
+            appendDotEscaped(line, kinds[edgeKinds[edge]]);
+            line += L"\"];\n";
+            out.writeText(line);
+        }
+    }
+
+    out.writeText(L"}\n");
+    out.flush();
+}
@@ -0,0 +1,77 @@
+#pragma once
+#include "NameFolding.h"
+#include "ObjectAnalyzer.h"
+#include "OutputSink.h"
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Compact directed view of buildDependencyGraph's edges for analysis.
+// Object names are interned case-insensitively, as the Object Manager
+// matches them, and edges are kept in adjacency arrays, so every query
+// below is a linear pass (top-K adds a log factor over K only).
+class DependencyGraph {
+public:
+    using Node = uint32_t;
+
+    explicit DependencyGraph(const std::vector<ObjectDependency>& dependencies);
+
+    size_t nodeCount() const { return names.size(); }
+    size_t edgeCount() const { return edgeTargets.size(); }
+    const std::wstring& name(Node node) const { return names[node]; }
+    size_t fanIn(Node node) const { return inDegree[node]; }
+    size_t fanOut(Node node) const { return edgeOffsets[node + 1] - edgeOffsets[node]; }
+
+    // Outgoing edges of node are the indices [firstEdge, endEdge).
+    size_t firstEdge(Node node) const { return edgeOffsets[node]; }
+    size_t endEdge(Node node) const { return edgeOffsets[node + 1]; }
+    Node edgeTarget(size_t edge) const { return edgeTargets[edge]; }
+    const std::wstring& edgeKind(size_t edge) const { return kinds[edgeKinds[edge]]; }
+
+    // At most k nodes with the most incoming or outgoing edges, highest
+    // first; nodes without any are left out.
+    std::vector<Node> topFanIn(size_t k) const;
+    std::vector<Node> topFanOut(size_t k) const;
+
+    // Strongly connected components of more than one node, plus nodes
+    // with an edge to themselves: the dependency cycles.
+    std::vector<std::vector<Node>> cycles() const;
+
+    // SymbolicLink edges (source, target) whose target exists() rejects.
+    std::vector<std::pair<Node, Node>> orphanedLinks(const std::function<bool(const std::wstring&)>& exists) const;
+
+    // Process nodes with the number of SharedMemory edges pointing at
+    // them, most first.
+    std::vector<std::pair<Node, size_t>> sectionsPerProcess() const;
+
+    // Both stream through out's buffer, which must be a Human format sink
+    // since the machine formats drop free text.
+    void writeGraphML(OutputSink& out) const;
+    void writeDot(OutputSink& out) const;
+
+private:
+    struct FoldedHash {
+        size_t operator()(std::wstring_view name) const { return static_cast<size_t>(hashIgnoreCase(name)); }
+    };
+    struct FoldedEqual {
+        bool operator()(std::wstring_view a, std::wstring_view b) const { return equalsIgnoreCase(a, b); }
+    };
+
+    Node intern(const std::wstring& name);
+    uint8_t kindOf(const std::wstring& kind);
+    std::vector<Node> topByDegree(size_t k, const std::function<size_t(Node)>& degree) const;
+
+    // A deque so the interned views stay valid as names are added.
+    std::deque<std::wstring> names;
+    std::unordered_map<std::wstring_view, Node, FoldedHash, FoldedEqual> nodeIndex;
+    std::vector<std::wstring> kinds;
+    // Edges of node n are edgeTargets[edgeOffsets[n] .. edgeOffsets[n + 1]).
+    std::vector<size_t> edgeOffsets;
+    std::vector<Node> edgeTargets;
+    std::vector<uint8_t> edgeKinds;
+    std::vector<size_t> inDegree;
+};
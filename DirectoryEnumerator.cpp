@@ -0,0 +1,126 @@
+#include "DirectoryEnumerator.h"
+#include "Metrics.h"
+#include <algorithm>
+
+DirectoryEnumerator::DirectoryEnumerator(NtApi& ntApi, size_t bufferSize) : ntApi(ntApi), buffer(bufferSize) {
+}
+
+DirectoryEnumerator::DirectoryEnumerator(NtApi& ntApi, std::wstring_view path, size_t bufferSize)
+    : ntApi(ntApi), buffer(bufferSize) {
+    open(path);
+}
+
+DirectoryEnumerator::~DirectoryEnumerator() {
+    close();
+}
+
+NTSTATUS DirectoryEnumerator::open(std::wstring_view path) {
+    close();
+
+    lastStatus = DirectoryHandlePool::of(ntApi).acquire(path, lease);
+    directory = lease.get();
+    rewind();
+    return lastStatus;
+}
+
+void DirectoryEnumerator::close() {
+    lease.reset();
+    directory = nullptr;
+    current = nullptr;
+    lastStatus = STATUS_INVALID_HANDLE;
+}
+
+const OBJECT_DIRECTORY_INFORMATION* DirectoryEnumerator::next() {
+    while (directory) {
+        if (current && current->Name.Length > 0) {
+            const OBJECT_DIRECTORY_INFORMATION* entry = current++;
+            consumed++;
+            if (pendingSkip > 0) {
+                pendingSkip--;
+                continue;
+            }
+            Metrics::instance().add(MetricCounter::EntriesEnumerated);
+            return entry;
+        }
+
+        if (lastBatch) {
+            current = nullptr;
+            lastStatus = STATUS_NO_MORE_ENTRIES;
+            return nullptr;
+        }
+        if (!fill()) {
+            return nullptr;
+        }
+    }
+    return nullptr;
+}
+
+bool DirectoryEnumerator::hasMore() const {
+    if (!directory || !NT_SUCCESS(lastStatus) || lastStatus == STATUS_NO_MORE_ENTRIES) {
+        return false;
+    }
+    if (current && current->Name.Length > 0) {
+        return true;
+    }
+    return !lastBatch;
+}
+
+bool DirectoryEnumerator::fill() {
+    current = nullptr;
+    if (!NT_SUCCESS(lastStatus) || lastStatus == STATUS_NO_MORE_ENTRIES) {
+        return false;
+    }
+
+    Metrics& metrics = Metrics::instance();
+    ULONG context = nextContext;
+    ULONG returnLength = 0;
+    NTSTATUS status;
+
+    while (true) {
+        status = ntApi.queryDirectoryObject(directory, buffer.data(), static_cast<ULONG>(buffer.size()), FALSE,
+            context == 0 ? TRUE : FALSE, &context, &returnLength);
+        metrics.ntCall(NT_SUCCESS(status) || status == STATUS_NO_MORE_ENTRIES);
+        queries++;
+
+        // A single entry larger than the buffer.
+        if (status == STATUS_BUFFER_TOO_SMALL && returnLength > buffer.size()) {
+            buffer.resize(returnLength);
+            context = nextContext;
+            continue;
+        }
+        break;
+    }
+
+    lastStatus = status;
+    if (!NT_SUCCESS(status) || status == STATUS_NO_MORE_ENTRIES) {
+        return false;
+    }
+    metrics.add(MetricCounter::BytesBuffered, returnLength);
+    bytes += returnLength;
+
+    batchContext = nextContext;
+    nextContext = context;
+    lastBatch = status != STATUS_MORE_ENTRIES;
+    consumed = 0;
+    current = reinterpret_cast<const OBJECT_DIRECTORY_INFORMATION*>(buffer.data());
+    return true;
+}
+
+DirectoryCursor DirectoryEnumerator::cursor() const {
+    if (current) {
+        return { batchContext, consumed + pendingSkip };
+    }
+    return { nextContext, pendingSkip };
+}
+
+void DirectoryEnumerator::seek(const DirectoryCursor& position) {
+    current = nullptr;
+    nextContext = position.context;
+    batchContext = position.context;
+    consumed = 0;
+    lastBatch = false;
+    pendingSkip = position.consumed;
+    if (directory) {
+        lastStatus = STATUS_SUCCESS;
+    }
+}
@@ -0,0 +1,118 @@
+#pragma once
+#include "DirectoryHandlePool.h"
+#include "NtApi.h"
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Resume point inside a directory: the kernel context a query buffer was
+// read from plus the entries of that buffer already handed out. Stays
+// valid across enumerators of the same directory.
+struct DirectoryCursor {
+    ULONG context = 0;
+    ULONG consumed = 0;
+};
+
+// Lazy enumeration of one object directory. Entries are pulled from the
+// kernel one query buffer at a time as the caller asks for them, so
+// stopping at the first match or after a page costs a single
+// NtQueryDirectoryObject call instead of a full scan.
+class DirectoryEnumerator {
+public:
+    static constexpr size_t DefaultBufferSize = 16 * 1024;
+
+    explicit DirectoryEnumerator(NtApi& ntApi = NtApi::system(), size_t bufferSize = DefaultBufferSize);
+    DirectoryEnumerator(NtApi& ntApi, std::wstring_view path, size_t bufferSize = DefaultBufferSize);
+    ~DirectoryEnumerator();
+
+    DirectoryEnumerator(const DirectoryEnumerator&) = delete;
+    DirectoryEnumerator& operator=(const DirectoryEnumerator&) = delete;
+
+    // Releases the current directory, if any, and opens path at its first
+    // entry. The handle is leased from the backend's DirectoryHandlePool,
+    // so a path enumerated again soon is not reopened. The query buffer is
+    // kept.
+    NTSTATUS open(std::wstring_view path);
+    void close();
+    bool isOpen() const { return directory != nullptr; }
+
+    // Status of the open, of the last failed query, or
+    // STATUS_NO_MORE_ENTRIES once the directory is exhausted.
+    NTSTATUS status() const { return lastStatus; }
+
+    // The next entry, or nullptr at the end or on error. The entry and its
+    // strings stay valid until the next call.
+    const OBJECT_DIRECTORY_INFORMATION* next();
+    // False once the directory is known to be exhausted; never queries.
+    bool hasMore() const;
+
+    // NtQueryDirectoryObject calls and bytes returned since construction.
+    uint64_t queryCount() const { return queries; }
+    uint64_t bytesRead() const { return bytes; }
+
+    // Where the next call to next() continues from.
+    DirectoryCursor cursor() const;
+    void seek(const DirectoryCursor& position);
+    void rewind() { seek({}); }
+
+    static std::wstring_view nameOf(const OBJECT_DIRECTORY_INFORMATION& entry) {
+        return std::wstring_view(entry.Name.Buffer, entry.Name.Length / sizeof(WCHAR));
+    }
+    static std::wstring_view typeOf(const OBJECT_DIRECTORY_INFORMATION& entry) {
+        return std::wstring_view(entry.TypeName.Buffer, entry.TypeName.Length / sizeof(WCHAR));
+    }
+
+    // Single-pass input iterator; advancing it consumes the enumerator.
+    class iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = OBJECT_DIRECTORY_INFORMATION;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const OBJECT_DIRECTORY_INFORMATION*;
+        using reference = const OBJECT_DIRECTORY_INFORMATION&;
+
+        iterator() = default;
+        iterator(DirectoryEnumerator* owner, pointer entry) : owner(owner), entry(entry) {}
+
+        reference operator*() const { return *entry; }
+        pointer operator->() const { return entry; }
+        iterator& operator++() {
+            entry = owner->next();
+            return *this;
+        }
+        bool operator==(const iterator& other) const { return entry == other.entry; }
+        bool operator!=(const iterator& other) const { return entry != other.entry; }
+
+    private:
+        DirectoryEnumerator* owner = nullptr;
+        pointer entry = nullptr;
+    };
+
+    iterator begin() { return iterator(this, next()); }
+    iterator end() { return iterator(this, nullptr); }
+
+private:
+    bool fill();
+
+    NtApi& ntApi;
+    DirectoryHandlePool::Lease lease;
+    HANDLE directory = nullptr;
+    NTSTATUS lastStatus = STATUS_INVALID_HANDLE;
+    std::vector<BYTE> buffer;
+
+    // Next entry to hand out from buffer, or nullptr when nothing is buffered.
+    const OBJECT_DIRECTORY_INFORMATION* current = nullptr;
+    ULONG batchContext = 0;
+    ULONG nextContext = 0;
+    ULONG consumed = 0;
+    // The buffered batch was answered with STATUS_SUCCESS rather than
+    // STATUS_MORE_ENTRIES, so nothing follows it.
+    bool lastBatch = false;
+    uint64_t queries = 0;
+    uint64_t bytes = 0;
+    // Entries still to drop after a seek into the middle of a buffer.
+    ULONG pendingSkip = 0;
+};
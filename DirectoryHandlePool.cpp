@@ -0,0 +1,242 @@
+#include "DirectoryHandlePool.h"
+#include "Metrics.h"
+#include <algorithm>
+
+namespace {
+    struct Registry {
+        std::mutex mutex;
+        std::unordered_map<const NtApi*, DirectoryHandlePool*> pools;
+    };
+
+    // Never destroyed: every backend discards its pool in its destructor,
+    // including the static WinNtApi during exit, which may run after this
+    // registry would have been torn down.
+    Registry& registry() {
+        static auto* instance = new Registry();
+        return *instance;
+    }
+
+    std::wstring_view normalized(std::wstring_view path) {
+        if (path.size() > 1 && path.back() == L'\\') {
+            path.remove_suffix(1);
+        }
+        return path;
+    }
+}
+
+DirectoryHandlePool::Lease& DirectoryHandlePool::Lease::operator=(Lease&& other) noexcept {
+    if (this != &other) {
+        reset();
+        pool = other.pool;
+        entry = other.entry;
+        other.pool = nullptr;
+        other.entry = nullptr;
+    }
+    return *this;
+}
+
+HANDLE DirectoryHandlePool::Lease::get() const {
+    return entry ? entry->handle : nullptr;
+}
+
+void DirectoryHandlePool::Lease::reset() {
+    if (entry) {
+        pool->release(entry);
+        pool = nullptr;
+        entry = nullptr;
+    }
+}
+
+DirectoryHandlePool& DirectoryHandlePool::of(NtApi& ntApi) {
+    Registry& pools = registry();
+    std::lock_guard<std::mutex> lock(pools.mutex);
+    DirectoryHandlePool*& pool = pools.pools[&ntApi];
+    if (!pool) {
+        pool = new DirectoryHandlePool(ntApi);
+    }
+    return *pool;
+}
+
+void DirectoryHandlePool::discard(NtApi& ntApi) {
+    DirectoryHandlePool* pool = nullptr;
+    {
+        Registry& pools = registry();
+        std::lock_guard<std::mutex> lock(pools.mutex);
+        auto it = pools.pools.find(&ntApi);
+        if (it == pools.pools.end()) {
+            return;
+        }
+        pool = it->second;
+        pools.pools.erase(it);
+    }
+    pool->closeAll();
+    delete pool;
+}
+
+DirectoryHandlePool::DirectoryHandlePool(NtApi& ntApi) : ntApi(ntApi) {
+}
+
+DirectoryHandlePool::~DirectoryHandlePool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    sweepWake.notify_all();
+    if (sweeper.joinable()) {
+        sweeper.join();
+    }
+}
+
+void DirectoryHandlePool::setOptions(const DirectoryPoolOptions& newOptions) {
+    std::lock_guard<std::mutex> lock(mutex);
+    options = newOptions;
+    expireLocked(Clock::now());
+    sweepWake.notify_all();
+}
+
+NTSTATUS DirectoryHandlePool::acquire(std::wstring_view path, Lease& lease) {
+    lease.reset();
+    path = normalized(path);
+    FoldedName key(path);
+    Clock::time_point now = Clock::now();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        expireLocked(now);
+
+        auto it = entries.find(key);
+        if (it != entries.end()) {
+            Entry* entry = it->second.get();
+            if (now - entry->openedAt < options.maxAge) {
+                if (entry->leases++ == 0) {
+                    idle.erase(entry->idlePosition);
+                }
+                Metrics::instance().add(MetricCounter::DirectoryHandlesReused);
+                lease.pool = this;
+                lease.entry = entry;
+                return STATUS_SUCCESS;
+            }
+            // Too old; leases still using it keep it until they end.
+            removeLocked(entry);
+        }
+    }
+
+    // Opened without the lock; two threads missing the same path at once
+    // both open it and the second handle is not pooled.
+    UNICODE_STRING uniPath;
+    uniPath.Buffer = const_cast<PWSTR>(path.data());
+    uniPath.Length = static_cast<USHORT>(std::min<size_t>(path.size() * sizeof(WCHAR), 0xFFFE));
+    uniPath.MaximumLength = uniPath.Length;
+
+    OBJECT_ATTRIBUTES objAttributes;
+    InitializeObjectAttributes(&objAttributes, &uniPath, OBJ_CASE_INSENSITIVE, NULL, NULL);
+
+    HANDLE handle = nullptr;
+    NTSTATUS status = ntApi.openDirectoryObject(&handle, DIRECTORY_QUERY, &objAttributes);
+    Metrics::instance().ntCall(NT_SUCCESS(status));
+    if (!NT_SUCCESS(status)) {
+        return status;
+    }
+
+    auto entry = std::make_unique<Entry>();
+    entry->handle = handle;
+    entry->key = std::move(key);
+    entry->leases = 1;
+    entry->openedAt = now;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    while (entries.size() >= options.maxOpenHandles && !idle.empty()) {
+        removeLocked(idle.front());
+    }
+    if (entries.size() >= options.maxOpenHandles || entries.count(entry->key) != 0) {
+        entry->pooled = false;
+        lease.entry = entry.release();
+    }
+    else {
+        lease.entry = entry.get();
+        FoldedName mapKey = entry->key;
+        entries.emplace(std::move(mapKey), std::move(entry));
+    }
+    lease.pool = this;
+    return STATUS_SUCCESS;
+}
+
+void DirectoryHandlePool::release(Entry* entry) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (--entry->leases > 0) {
+        return;
+    }
+    if (!entry->pooled) {
+        lock.unlock();
+        ntApi.close(entry->handle);
+        delete entry;
+        return;
+    }
+    entry->idleSince = Clock::now();
+    bool wasEmpty = idle.empty();
+    entry->idlePosition = idle.insert(idle.end(), entry);
+    expireLocked(entry->idleSince);
+
+    if (!sweeper.joinable()) {
+        sweeper = std::thread(&DirectoryHandlePool::sweep, this);
+    }
+    else if (wasEmpty) {
+        sweepWake.notify_all();
+    }
+}
+
+void DirectoryHandlePool::sweep() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        if (idle.empty()) {
+            sweepWake.wait(lock, [this] { return stopping || !idle.empty(); });
+            continue;
+        }
+        // The oldest idle handle expires first; a lease taken meanwhile
+        // just moves the deadline on the next round.
+        Clock::time_point deadline = idle.front()->idleSince + options.idleTimeout;
+        sweepWake.wait_until(lock, deadline);
+        expireLocked(Clock::now());
+    }
+}
+
+void DirectoryHandlePool::expireLocked(Clock::time_point now) {
+    while (!idle.empty() && now - idle.front()->idleSince >= options.idleTimeout) {
+        removeLocked(idle.front());
+    }
+}
+
+void DirectoryHandlePool::removeLocked(Entry* entry) {
+    auto it = entries.find(entry->key);
+    std::unique_ptr<Entry> owned = std::move(it->second);
+    entries.erase(it);
+
+    if (entry->leases == 0) {
+        idle.erase(entry->idlePosition);
+        ntApi.close(entry->handle);
+    }
+    else {
+        // The last lease closes and frees it.
+        entry->pooled = false;
+        owned.release();
+    }
+}
+
+size_t DirectoryHandlePool::openHandles() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+void DirectoryHandlePool::trim() {
+    std::lock_guard<std::mutex> lock(mutex);
+    while (!idle.empty()) {
+        removeLocked(idle.front());
+    }
+}
+
+void DirectoryHandlePool::closeAll() {
+    std::lock_guard<std::mutex> lock(mutex);
+    while (!entries.empty()) {
+        removeLocked(entries.begin()->second.get());
+    }
+}
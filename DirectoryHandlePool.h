@@ -0,0 +1,116 @@
+#pragma once
+#include "NameFolding.h"
+#include "NtApi.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+struct DirectoryPoolOptions {
+    // Pooled handles kept open at once. Past this the least recently used
+    // idle handle is closed; if every handle is leased, the new one is
+    // closed again when its lease ends.
+    size_t maxOpenHandles = 128;
+    // An unleased handle is closed after this long, whether or not the
+    // pool is used again.
+    std::chrono::seconds idleTimeout{ 30 };
+    // A handle this old is reopened on its next acquire, so a directory
+    // deleted and recreated under the same name is picked up.
+    std::chrono::seconds maxAge{ 60 };
+};
+
+// Open DIRECTORY_QUERY handles shared by the explorer, the monitor and the
+// analyzer, one pool per backend. Directory queries carry their position
+// in the caller's context rather than in the handle, so any number of
+// enumerations can share one handle; a path that is scanned every tick
+// is opened once instead of on every scan. Paths are keyed folded and
+// without a trailing backslash. Idle handles are closed by a sweeper
+// thread, started the first time a handle goes idle. Thread-safe.
+class DirectoryHandlePool {
+    struct Entry;
+
+public:
+    // Holds a handle open while in use. Move-only; released on destruction.
+    class Lease {
+    public:
+        Lease() = default;
+        ~Lease() { reset(); }
+        Lease(Lease&& other) noexcept : pool(other.pool), entry(other.entry) {
+            other.pool = nullptr;
+            other.entry = nullptr;
+        }
+        Lease& operator=(Lease&& other) noexcept;
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        HANDLE get() const;
+        explicit operator bool() const { return entry != nullptr; }
+        void reset();
+
+    private:
+        friend class DirectoryHandlePool;
+
+        DirectoryHandlePool* pool = nullptr;
+        Entry* entry = nullptr;
+    };
+
+    // The pool for ntApi, created on first use.
+    static DirectoryHandlePool& of(NtApi& ntApi);
+    // Closes the handles of a backend that is going away and forgets its
+    // pool. Backends call this from their destructor; nothing may still
+    // hold a lease.
+    static void discard(NtApi& ntApi);
+
+    DirectoryHandlePool(const DirectoryHandlePool&) = delete;
+    DirectoryHandlePool& operator=(const DirectoryHandlePool&) = delete;
+
+    void setOptions(const DirectoryPoolOptions& newOptions);
+
+    // Leases a handle to path, opening it only if the pool has none.
+    // Returns the open status; lease is left empty on failure.
+    NTSTATUS acquire(std::wstring_view path, Lease& lease);
+
+    size_t openHandles() const;
+    // Closes every handle not currently leased.
+    void trim();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        HANDLE handle = nullptr;
+        FoldedName key;
+        size_t leases = 0;
+        Clock::time_point openedAt;
+        Clock::time_point idleSince;
+        // False once the entry has left the map: over the cap, or retired
+        // for age while leased. The last lease closes it.
+        bool pooled = true;
+        std::list<Entry*>::iterator idlePosition;
+    };
+
+    explicit DirectoryHandlePool(NtApi& ntApi);
+    ~DirectoryHandlePool();
+
+    void release(Entry* entry);
+    void sweep();
+    void expireLocked(Clock::time_point now);
+    void removeLocked(Entry* entry);
+    void closeAll();
+
+    NtApi& ntApi;
+    DirectoryPoolOptions options;
+    mutable std::mutex mutex;
+    std::unordered_map<FoldedName, std::unique_ptr<Entry>, FoldedNameHash> entries;
+    // Unleased entries, least recently released first.
+    std::list<Entry*> idle;
+
+    std::thread sweeper;
+    std::condition_variable sweepWake;
+    bool stopping = false;
+};
@@ -0,0 +1,870 @@
+#include "Gzip.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <queue>
+#include <stdexcept>
+
+namespace {
+    const size_t WindowSize = 32768;
+    const size_t MinMatch = 3;
+    const size_t MaxMatch = 258;
+    const unsigned HashBits = 15;
+    // Match search effort: candidates tried per position, and the match
+    // length that ends the search (and skips the lazy retry) early.
+    const size_t MaxChain = 64;
+    const size_t NiceMatch = 128;
+    // Three-byte matches this far back cost more bits than the literals.
+    const size_t FarShortMatch = 4096;
+    // Symbols per deflate block; each block gets its own Huffman codes.
+    const size_t BlockSymbols = 32768;
+
+    // Input handed to the compressor thread at a time, and how many such
+    // blocks may wait for it before write() blocks.
+    const size_t QueueBlockSize = 256 * 1024;
+    const size_t MaxQueuedBlocks = 4;
+
+    const uint16_t LengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+        35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+    const uint8_t LengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+        3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+    const uint16_t DistanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+        257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+    const uint8_t DistanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+        7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+    // Order in which the code length code lengths are transmitted.
+    const uint8_t CodeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+    struct CrcTable {
+        uint32_t entries[256];
+
+        CrcTable() {
+            for (uint32_t i = 0; i < 256; i++) {
+                uint32_t c = i;
+                for (int bit = 0; bit < 8; bit++) {
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+                entries[i] = c;
+            }
+        }
+    };
+
+    uint32_t updateCrc(uint32_t crc, const char* data, size_t size) {
+        static const CrcTable table;
+        crc = ~crc;
+        for (size_t i = 0; i < size; i++) {
+            crc = table.entries[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+        }
+        return ~crc;
+    }
+
+    void appendLittleEndian(std::string& out, uint32_t value) {
+        for (int i = 0; i < 4; i++) {
+            out += static_cast<char>((value >> (8 * i)) & 0xFF);
+        }
+    }
+
+    size_t lengthSymbol(size_t length) {
+        return 257 + (std::upper_bound(LengthBase, LengthBase + 29, length) - LengthBase - 1);
+    }
+
+    size_t distanceSymbol(size_t distance) {
+        return std::upper_bound(DistanceBase, DistanceBase + 30, distance) - DistanceBase - 1;
+    }
+
+    uint32_t reverseBits(uint32_t code, unsigned length) {
+        uint32_t reversed = 0;
+        for (unsigned i = 0; i < length; i++) {
+            reversed = (reversed << 1) | (code & 1);
+            code >>= 1;
+        }
+        return reversed;
+    }
+
+    // Huffman code lengths no longer than limit. Frequencies are halved
+    // until the tree fits, which costs a fraction of a percent against an
+    // optimal length-limited code.
+    std::vector<uint8_t> codeLengths(std::vector<uint32_t> frequencies, unsigned limit) {
+        size_t symbols = frequencies.size();
+        std::vector<uint8_t> lengths(symbols, 0);
+
+        while (true) {
+            using Entry = std::pair<uint64_t, size_t>;
+            std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap;
+            std::vector<std::pair<size_t, size_t>> children;
+            for (size_t i = 0; i < symbols; i++) {
+                if (frequencies[i] != 0) {
+                    heap.push({ frequencies[i], i });
+                }
+            }
+
+            // Internal nodes are numbered after the symbols, children first,
+            // so depths can be assigned walking down from the last one.
+            while (heap.size() > 1) {
+                Entry a = heap.top();
+                heap.pop();
+                Entry b = heap.top();
+                heap.pop();
+                children.push_back({ a.second, b.second });
+                heap.push({ a.first + b.first, symbols + children.size() - 1 });
+            }
+
+            std::vector<unsigned> depth(symbols + children.size(), 0);
+            unsigned deepest = 0;
+            for (size_t node = children.size(); node-- > 0;) {
+                unsigned childDepth = depth[symbols + node] + 1;
+                depth[children[node].first] = childDepth;
+                depth[children[node].second] = childDepth;
+                deepest = std::max(deepest, childDepth);
+            }
+
+            if (deepest <= limit) {
+                for (size_t i = 0; i < symbols; i++) {
+                    lengths[i] = static_cast<uint8_t>(frequencies[i] != 0 ? depth[i] : 0);
+                }
+                return lengths;
+            }
+            for (auto& frequency : frequencies) {
+                if (frequency != 0) {
+                    frequency = (frequency + 1) / 2;
+                }
+            }
+        }
+    }
+
+    // Canonical codes, bit-reversed because deflate writes them from the
+    // most significant bit into an LSB-first stream.
+    std::vector<uint16_t> canonicalCodes(const std::vector<uint8_t>& lengths) {
+        uint16_t lengthCount[16] = {};
+        for (uint8_t length : lengths) {
+            lengthCount[length]++;
+        }
+        lengthCount[0] = 0;
+
+        uint16_t nextCode[16] = {};
+        uint16_t code = 0;
+        for (int bits = 1; bits < 16; bits++) {
+            code = static_cast<uint16_t>((code + lengthCount[bits - 1]) << 1);
+            nextCode[bits] = code;
+        }
+
+        std::vector<uint16_t> codes(lengths.size(), 0);
+        for (size_t i = 0; i < lengths.size(); i++) {
+            if (lengths[i] != 0) {
+                codes[i] = static_cast<uint16_t>(reverseBits(nextCode[lengths[i]]++, lengths[i]));
+            }
+        }
+        return codes;
+    }
+
+    // A complete code needs two symbols; give unused ones a count of one.
+    void ensureTwoSymbols(std::vector<uint32_t>& frequencies) {
+        size_t used = std::count_if(frequencies.begin(), frequencies.end(), [](uint32_t f) { return f != 0; });
+        for (size_t i = 0; used < 2 && i < frequencies.size(); i++) {
+            if (frequencies[i] == 0) {
+                frequencies[i] = 1;
+                used++;
+            }
+        }
+    }
+}
+
+// LZ77 with hash chains and one-step lazy matching, emitted as deflate
+// blocks with dynamic Huffman codes. History carries over between
+// compress() calls, so matches reach back into earlier input.
+class DeflateEncoder {
+public:
+    DeflateEncoder() : head(size_t(1) << HashBits, 0), previous(WindowSize, 0) {
+        tokens.reserve(BlockSymbols);
+    }
+
+    // Appends compressed output to out.
+    void compress(std::string_view data, std::string& out) {
+        window.append(data.data(), data.size());
+        size_t end = window.size();
+
+        while (position < end) {
+            hashUpTo(position + 1, end);
+            size_t distance = 0;
+            size_t length = longestMatch(position, end, distance);
+
+            if (length >= MinMatch && length < NiceMatch && position + 1 < end) {
+                hashUpTo(position + 2, end);
+                size_t nextDistance = 0;
+                if (longestMatch(position + 1, end, nextDistance) > length) {
+                    addLiteral(static_cast<unsigned char>(window[position]), out);
+                    position++;
+                    continue;
+                }
+            }
+
+            if (length >= MinMatch) {
+                addMatch(length, distance, out);
+                position += length;
+            }
+            else {
+                addLiteral(static_cast<unsigned char>(window[position]), out);
+                position++;
+            }
+        }
+
+        slideWindow();
+    }
+
+    // Writes the final block and pads the stream to a whole byte.
+    void finish(std::string& out) {
+        writeBlock(true, out);
+        if (bitCount > 0) {
+            putBits(0, 8 - bitCount, out);
+        }
+    }
+
+private:
+    struct Token {
+        // Zero for a literal.
+        uint16_t length;
+        // The literal byte, or the match distance.
+        uint16_t value;
+    };
+
+    uint32_t hashAt(size_t at) const {
+        uint32_t h = (static_cast<unsigned char>(window[at]) << 10) ^
+            (static_cast<unsigned char>(window[at + 1]) << 5) ^
+            static_cast<unsigned char>(window[at + 2]);
+        return h & ((1u << HashBits) - 1);
+    }
+
+    // Chains hold positions plus one, newest first; zero ends a chain.
+    void hashUpTo(size_t limit, size_t end) {
+        while (hashed < limit && hashed + MinMatch <= end) {
+            uint32_t h = hashAt(hashed);
+            previous[hashed & (WindowSize - 1)] = head[h];
+            head[h] = static_cast<uint32_t>(hashed + 1);
+            hashed++;
+        }
+    }
+
+    // The position itself must already be hashed; it is skipped.
+    size_t longestMatch(size_t at, size_t end, size_t& distance) const {
+        size_t limit = std::min(MaxMatch, end - at);
+        if (limit < MinMatch || hashed <= at) {
+            return 0;
+        }
+
+        size_t best = 0;
+        const char* current = window.data() + at;
+        uint32_t link = previous[at & (WindowSize - 1)];
+        for (size_t chain = 0; link != 0 && chain < MaxChain; chain++) {
+            size_t candidate = link - 1;
+            if (candidate >= at || at - candidate > WindowSize) {
+                break;
+            }
+
+            const char* earlier = window.data() + candidate;
+            if (earlier[best] == current[best]) {
+                size_t length = 0;
+                while (length < limit && earlier[length] == current[length]) {
+                    length++;
+                }
+                if (length > best) {
+                    best = length;
+                    distance = at - candidate;
+                    if (best >= NiceMatch || best == limit) {
+                        break;
+                    }
+                }
+            }
+
+            uint32_t next = previous[candidate & (WindowSize - 1)];
+            if (next >= link) {
+                break;
+            }
+            link = next;
+        }
+
+        if (best == MinMatch && distance > FarShortMatch) {
+            return 0;
+        }
+        return best;
+    }
+
+    void addLiteral(unsigned char literal, std::string& out) {
+        tokens.push_back({ 0, literal });
+        if (tokens.size() >= BlockSymbols) {
+            writeBlock(false, out);
+        }
+    }
+
+    void addMatch(size_t length, size_t distance, std::string& out) {
+        tokens.push_back({ static_cast<uint16_t>(length), static_cast<uint16_t>(distance) });
+        if (tokens.size() >= BlockSymbols) {
+            writeBlock(false, out);
+        }
+    }
+
+    // Keeps one to two windows of history. Whole windows are dropped so
+    // the chain slots (position modulo the window) stay where they are.
+    void slideWindow() {
+        if (window.size() < 2 * WindowSize) {
+            return;
+        }
+        size_t drop = (window.size() - WindowSize) / WindowSize * WindowSize;
+        window.erase(0, drop);
+        position -= drop;
+        hashed -= drop;
+        for (auto& link : head) {
+            link = link > drop ? static_cast<uint32_t>(link - drop) : 0;
+        }
+        for (auto& link : previous) {
+            link = link > drop ? static_cast<uint32_t>(link - drop) : 0;
+        }
+    }
+
+    void putBits(uint32_t value, unsigned count, std::string& out) {
+        bitBuffer |= static_cast<uint64_t>(value) << bitCount;
+        bitCount += count;
+        while (bitCount >= 8) {
+            out += static_cast<char>(bitBuffer & 0xFF);
+            bitBuffer >>= 8;
+            bitCount -= 8;
+        }
+    }
+
+    void writeBlock(bool final, std::string& out) {
+        std::vector<uint32_t> lengthFrequencies(286, 0);
+        std::vector<uint32_t> distanceFrequencies(30, 0);
+        for (const Token& token : tokens) {
+            if (token.length == 0) {
+                lengthFrequencies[token.value]++;
+            }
+            else {
+                lengthFrequencies[lengthSymbol(token.length)]++;
+                distanceFrequencies[distanceSymbol(token.value)]++;
+            }
+        }
+        lengthFrequencies[256] = 1;
+        ensureTwoSymbols(lengthFrequencies);
+        ensureTwoSymbols(distanceFrequencies);
+
+        std::vector<uint8_t> lengthLengths = codeLengths(lengthFrequencies, 15);
+        std::vector<uint8_t> distanceLengths = codeLengths(distanceFrequencies, 15);
+        std::vector<uint16_t> lengthCodes = canonicalCodes(lengthLengths);
+        std::vector<uint16_t> distanceCodes = canonicalCodes(distanceLengths);
+
+        size_t lengthCount = 286;
+        while (lengthCount > 257 && lengthLengths[lengthCount - 1] == 0) {
+            lengthCount--;
+        }
+        size_t distanceCount = 30;
+        while (distanceCount > 1 && distanceLengths[distanceCount - 1] == 0) {
+            distanceCount--;
+        }
+
+        // Both code length tables, run-length coded with symbols 16-18.
+        std::vector<uint8_t> all(lengthLengths.begin(), lengthLengths.begin() + lengthCount);
+        all.insert(all.end(), distanceLengths.begin(), distanceLengths.begin() + distanceCount);
+        std::vector<std::pair<uint8_t, uint8_t>> runs;
+        for (size_t i = 0; i < all.size();) {
+            uint8_t length = all[i];
+            size_t run = 1;
+            while (i + run < all.size() && all[i + run] == length) {
+                run++;
+            }
+            i += run;
+
+            if (length == 0) {
+                while (run >= 11) {
+                    size_t repeat = std::min<size_t>(run, 138);
+                    runs.push_back({ 18, static_cast<uint8_t>(repeat - 11) });
+                    run -= repeat;
+                }
+                if (run >= 3) {
+                    runs.push_back({ 17, static_cast<uint8_t>(run - 3) });
+                    run = 0;
+                }
+            }
+            else {
+                runs.push_back({ length, 0 });
+                run--;
+                while (run >= 3) {
+                    size_t repeat = std::min<size_t>(run, 6);
+                    runs.push_back({ 16, static_cast<uint8_t>(repeat - 3) });
+                    run -= repeat;
+                }
+            }
+            for (; run > 0; run--) {
+                runs.push_back({ length, 0 });
+            }
+        }
+
+        std::vector<uint32_t> runFrequencies(19, 0);
+        for (const auto& [symbol, extra] : runs) {
+            runFrequencies[symbol]++;
+        }
+        ensureTwoSymbols(runFrequencies);
+        std::vector<uint8_t> runLengths = codeLengths(runFrequencies, 7);
+        std::vector<uint16_t> runCodes = canonicalCodes(runLengths);
+
+        size_t runLengthCount = 19;
+        while (runLengthCount > 4 && runLengths[CodeLengthOrder[runLengthCount - 1]] == 0) {
+            runLengthCount--;
+        }
+
+        putBits(final ? 1 : 0, 1, out);
+        putBits(2, 2, out);
+        putBits(static_cast<uint32_t>(lengthCount - 257), 5, out);
+        putBits(static_cast<uint32_t>(distanceCount - 1), 5, out);
+        putBits(static_cast<uint32_t>(runLengthCount - 4), 4, out);
+        for (size_t i = 0; i < runLengthCount; i++) {
+            putBits(runLengths[CodeLengthOrder[i]], 3, out);
+        }
+        for (const auto& [symbol, extra] : runs) {
+            putBits(runCodes[symbol], runLengths[symbol], out);
+            if (symbol == 16) {
+                putBits(extra, 2, out);
+            }
+            else if (symbol == 17) {
+                putBits(extra, 3, out);
+            }
+            else if (symbol == 18) {
+                putBits(extra, 7, out);
+            }
+        }
+
+        for (const Token& token : tokens) {
+            if (token.length == 0) {
+                putBits(lengthCodes[token.value], lengthLengths[token.value], out);
+                continue;
+            }
+            size_t symbol = lengthSymbol(token.length);
+            putBits(lengthCodes[symbol], lengthLengths[symbol], out);
+            putBits(static_cast<uint32_t>(token.length - LengthBase[symbol - 257]), LengthExtra[symbol - 257], out);
+            size_t distance = distanceSymbol(token.value);
+            putBits(distanceCodes[distance], distanceLengths[distance], out);
+            putBits(static_cast<uint32_t>(token.value - DistanceBase[distance]), DistanceExtra[distance], out);
+        }
+        putBits(lengthCodes[256], lengthLengths[256], out);
+        tokens.clear();
+    }
+
+    std::string window;
+    size_t position = 0;
+    size_t hashed = 0;
+    std::vector<uint32_t> head;
+    std::vector<uint32_t> previous;
+    std::vector<Token> tokens;
+    uint64_t bitBuffer = 0;
+    unsigned bitCount = 0;
+};
+
+GzipWriter::GzipWriter(const std::wstring& filePath)
+    : file{ std::filesystem::path(filePath), std::ios::binary }, encoder(std::make_unique<DeflateEncoder>()) {
+    if (!file.is_open()) {
+        throw std::runtime_error("Unable to open output file for writing");
+    }
+
+    // Magic, deflate, no flags or timestamp, unknown OS.
+    static const char header[10] = { '\x1f', '\x8b', 8, 0, 0, 0, 0, 0, 0, '\xff' };
+    file.write(header, sizeof(header));
+    pending.reserve(QueueBlockSize);
+    compressor = std::thread(&GzipWriter::compressorThread, this);
+}
+
+GzipWriter::~GzipWriter() {
+    try {
+        finish();
+    }
+    catch (const std::exception&) {
+    }
+}
+
+void GzipWriter::write(std::string_view data) {
+    while (!data.empty()) {
+        size_t take = std::min(data.size(), QueueBlockSize - pending.size());
+        pending.append(data.data(), take);
+        data.remove_prefix(take);
+        if (pending.size() >= QueueBlockSize) {
+            queuePending();
+        }
+    }
+}
+
+void GzipWriter::queuePending() {
+    std::unique_lock<std::mutex> lock(queueMutex);
+    queueChanged.wait(lock, [this]() { return queue.size() < MaxQueuedBlocks || failure; });
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+    queue.push_back(std::move(pending));
+    queueChanged.notify_all();
+    pending = std::string();
+    pending.reserve(QueueBlockSize);
+}
+
+void GzipWriter::finish() {
+    if (finished) {
+        return;
+    }
+    finished = true;
+
+    if (!pending.empty()) {
+        try {
+            queuePending();
+        }
+        catch (const std::exception&) {
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        closing = true;
+        queueChanged.notify_all();
+    }
+    compressor.join();
+    file.close();
+
+    if (failure) {
+        std::rethrow_exception(failure);
+    }
+}
+
+void GzipWriter::compressorThread() {
+    uint32_t crc = 0;
+    uint32_t size = 0;
+    std::string compressed;
+
+    try {
+        while (true) {
+            std::string block;
+            {
+                std::unique_lock<std::mutex> lock(queueMutex);
+                queueChanged.wait(lock, [this]() { return !queue.empty() || closing; });
+                if (queue.empty()) {
+                    break;
+                }
+                block = std::move(queue.front());
+                queue.pop_front();
+                queueChanged.notify_all();
+            }
+
+            crc = updateCrc(crc, block.data(), block.size());
+            size += static_cast<uint32_t>(block.size());
+            compressed.clear();
+            encoder->compress(block, compressed);
+            file.write(compressed.data(), static_cast<std::streamsize>(compressed.size()));
+            if (!file) {
+                throw std::runtime_error("Unable to write compressed output");
+            }
+        }
+
+        compressed.clear();
+        encoder->finish(compressed);
+        appendLittleEndian(compressed, crc);
+        appendLittleEndian(compressed, size);
+        file.write(compressed.data(), static_cast<std::streamsize>(compressed.size()));
+        file.flush();
+        if (!file) {
+            throw std::runtime_error("Unable to write compressed output");
+        }
+    }
+    catch (...) {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        failure = std::current_exception();
+        queue.clear();
+        queueChanged.notify_all();
+    }
+}
+
+GzipInputBuffer::GzipInputBuffer(std::streambuf& source) : source(source) {
+    readHeader();
+}
+
+bool GzipInputBuffer::detect(std::streambuf& source) {
+    char magic[2];
+    std::streamsize read = source.sgetn(magic, 2);
+    source.pubseekoff(-read, std::ios::cur, std::ios::in);
+    return read == 2 && magic[0] == '\x1f' && magic[1] == '\x8b';
+}
+
+unsigned char GzipInputBuffer::nextByte() {
+    int_type c = source.sbumpc();
+    if (traits_type::eq_int_type(c, traits_type::eof())) {
+        throw std::runtime_error("Truncated gzip stream");
+    }
+    return static_cast<unsigned char>(traits_type::to_char_type(c));
+}
+
+uint32_t GzipInputBuffer::bits(unsigned count) {
+    uint32_t value = bitBuffer;
+    while (bitCount < count) {
+        value |= static_cast<uint32_t>(nextByte()) << bitCount;
+        bitCount += 8;
+    }
+    bitBuffer = count < 32 ? value >> count : 0;
+    bitCount -= count;
+    return value & ((1u << count) - 1);
+}
+
+void GzipInputBuffer::readHeader() {
+    unsigned char header[10];
+    for (auto& byte : header) {
+        byte = nextByte();
+    }
+    if (header[0] != 0x1F || header[1] != 0x8B || header[2] != 8) {
+        throw std::runtime_error("Not a gzip stream");
+    }
+
+    unsigned flags = header[3];
+    if (flags & 4) {
+        unsigned extra = nextByte();
+        extra |= static_cast<unsigned>(nextByte()) << 8;
+        while (extra-- > 0) {
+            nextByte();
+        }
+    }
+    for (unsigned text : { 8u, 16u }) {
+        if (flags & text) {
+            while (nextByte() != 0) {
+            }
+        }
+    }
+    if (flags & 2) {
+        nextByte();
+        nextByte();
+    }
+}
+
+void GzipInputBuffer::updateChecksum() {
+    crc = updateCrc(crc, output.data() + checked, output.size() - checked);
+    size += static_cast<uint32_t>(output.size() - checked);
+    checked = output.size();
+}
+
+void GzipInputBuffer::readTrailer() {
+    updateChecksum();
+    bitBuffer = 0;
+    bitCount = 0;
+    uint32_t expectedCrc = bits(16);
+    expectedCrc |= bits(16) << 16;
+    uint32_t expectedSize = bits(16);
+    expectedSize |= bits(16) << 16;
+    if (expectedCrc != crc || expectedSize != size) {
+        throw std::runtime_error("Gzip checksum mismatch");
+    }
+}
+
+// Canonical decoding as in zlib's puff: codes are compared length by
+// length against the first code of each length.
+void GzipInputBuffer::build(Huffman& code, const uint8_t* lengths, size_t count) {
+    std::fill(std::begin(code.count), std::end(code.count), uint16_t(0));
+    for (size_t i = 0; i < count; i++) {
+        code.count[lengths[i]]++;
+    }
+
+    int left = 1;
+    for (int length = 1; length < 16; length++) {
+        left <<= 1;
+        left -= code.count[length];
+        if (left < 0) {
+            throw std::runtime_error("Invalid gzip stream");
+        }
+    }
+
+    uint16_t offsets[16] = {};
+    for (int length = 1; length < 15; length++) {
+        offsets[length + 1] = offsets[length] + code.count[length];
+    }
+    code.symbol.assign(count, 0);
+    for (size_t i = 0; i < count; i++) {
+        if (lengths[i] != 0) {
+            code.symbol[offsets[lengths[i]]++] = static_cast<uint16_t>(i);
+        }
+    }
+}
+
+int GzipInputBuffer::decode(const Huffman& code) {
+    int value = 0;
+    int first = 0;
+    int index = 0;
+    for (int length = 1; length < 16; length++) {
+        value |= static_cast<int>(bits(1));
+        int count = code.count[length];
+        if (value - count < first) {
+            return code.symbol[index + (value - first)];
+        }
+        index += count;
+        first = (first + count) << 1;
+        value <<= 1;
+    }
+    throw std::runtime_error("Invalid gzip stream");
+}
+
+void GzipInputBuffer::beginBlock() {
+    if (lastBlock) {
+        readTrailer();
+        state = BlockState::Done;
+        return;
+    }
+    lastBlock = bits(1) != 0;
+
+    switch (bits(2)) {
+    case 0: {
+        bitBuffer = 0;
+        bitCount = 0;
+        uint32_t length = bits(16);
+        uint32_t complement = bits(16);
+        if ((length ^ 0xFFFF) != complement) {
+            throw std::runtime_error("Invalid gzip stream");
+        }
+        storedRemaining = length;
+        state = BlockState::Stored;
+        break;
+    }
+
+    case 1: {
+        uint8_t lengths[288 + 30];
+        std::fill(lengths, lengths + 144, uint8_t(8));
+        std::fill(lengths + 144, lengths + 256, uint8_t(9));
+        std::fill(lengths + 256, lengths + 280, uint8_t(7));
+        std::fill(lengths + 280, lengths + 288, uint8_t(8));
+        std::fill(lengths + 288, lengths + 318, uint8_t(5));
+        build(lengthCode, lengths, 288);
+        build(distanceCode, lengths + 288, 30);
+        state = BlockState::Compressed;
+        break;
+    }
+
+    case 2: {
+        size_t lengthCount = bits(5) + 257;
+        size_t distanceCount = bits(5) + 1;
+        size_t runLengthCount = bits(4) + 4;
+        if (lengthCount > 286 || distanceCount > 30) {
+            throw std::runtime_error("Invalid gzip stream");
+        }
+
+        uint8_t runLengths[19] = {};
+        for (size_t i = 0; i < runLengthCount; i++) {
+            runLengths[CodeLengthOrder[i]] = static_cast<uint8_t>(bits(3));
+        }
+        Huffman runCode;
+        build(runCode, runLengths, 19);
+
+        uint8_t lengths[286 + 30] = {};
+        size_t total = lengthCount + distanceCount;
+        for (size_t i = 0; i < total;) {
+            int symbol = decode(runCode);
+            if (symbol < 16) {
+                lengths[i++] = static_cast<uint8_t>(symbol);
+                continue;
+            }
+
+            uint8_t value = 0;
+            size_t repeat;
+            if (symbol == 16) {
+                if (i == 0) {
+                    throw std::runtime_error("Invalid gzip stream");
+                }
+                value = lengths[i - 1];
+                repeat = 3 + bits(2);
+            }
+            else if (symbol == 17) {
+                repeat = 3 + bits(3);
+            }
+            else {
+                repeat = 11 + bits(7);
+            }
+            if (i + repeat > total) {
+                throw std::runtime_error("Invalid gzip stream");
+            }
+            while (repeat-- > 0) {
+                lengths[i++] = value;
+            }
+        }
+
+        build(lengthCode, lengths, lengthCount);
+        build(distanceCode, lengths + lengthCount, distanceCount);
+        state = BlockState::Compressed;
+        break;
+    }
+
+    default:
+        throw std::runtime_error("Invalid gzip stream");
+    }
+}
+
+void GzipInputBuffer::inflate(size_t target) {
+    while (output.size() < target && state != BlockState::Done) {
+        switch (state) {
+        case BlockState::Header:
+            beginBlock();
+            break;
+
+        case BlockState::Stored:
+            while (storedRemaining > 0 && output.size() < target) {
+                output.push_back(static_cast<char>(nextByte()));
+                storedRemaining--;
+            }
+            if (storedRemaining == 0) {
+                state = BlockState::Header;
+            }
+            break;
+
+        case BlockState::Compressed:
+            while (output.size() < target) {
+                int symbol = decode(lengthCode);
+                if (symbol < 256) {
+                    output.push_back(static_cast<char>(symbol));
+                    continue;
+                }
+                if (symbol == 256) {
+                    state = BlockState::Header;
+                    break;
+                }
+
+                symbol -= 257;
+                if (symbol >= 29) {
+                    throw std::runtime_error("Invalid gzip stream");
+                }
+                size_t length = LengthBase[symbol] + bits(LengthExtra[symbol]);
+                int distanceSymbol = decode(distanceCode);
+                if (distanceSymbol >= 30) {
+                    throw std::runtime_error("Invalid gzip stream");
+                }
+                size_t distance = DistanceBase[distanceSymbol] + bits(DistanceExtra[distanceSymbol]);
+                if (distance > output.size()) {
+                    throw std::runtime_error("Invalid gzip stream");
+                }
+                // Byte by byte: the copy may overlap what it produces.
+                size_t from = output.size() - distance;
+                for (size_t i = 0; i < length; i++) {
+                    output.push_back(output[from + i]);
+                }
+            }
+            break;
+
+        case BlockState::Done:
+            break;
+        }
+    }
+}
+
+GzipInputBuffer::int_type GzipInputBuffer::underflow() {
+    if (gptr() < egptr()) {
+        return traits_type::to_int_type(*gptr());
+    }
+
+    // Keep the last window as history for the matches to come.
+    if (output.size() > WindowSize) {
+        size_t drop = output.size() - WindowSize;
+        output.erase(output.begin(), output.begin() + static_cast<std::ptrdiff_t>(drop));
+        checked -= drop;
+    }
+    size_t start = output.size();
+    inflate(start + 4 * WindowSize);
+    if (output.size() == start) {
+        return traits_type::eof();
+    }
+    updateChecksum();
+
+    setg(output.data(), output.data() + start, output.data() + output.size());
+    return traits_type::to_int_type(*gptr());
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+class DeflateEncoder;
+
+// Writes a gzip (RFC 1952) file. write() only queues its input: a
+// dedicated thread deflates the queued blocks and writes them out, so the
+// caller keeps producing output while earlier blocks are compressed. When
+// the compressor falls behind by more than a few blocks, write() waits.
+class GzipWriter {
+public:
+    // Throws std::runtime_error if the file cannot be created.
+    explicit GzipWriter(const std::wstring& filePath);
+    // Finishes the stream if finish() was not called; errors are lost.
+    ~GzipWriter();
+
+    GzipWriter(const GzipWriter&) = delete;
+    GzipWriter& operator=(const GzipWriter&) = delete;
+
+    void write(std::string_view data);
+
+    // Compresses what is left, writes the trailer and closes the file.
+    // Throws std::runtime_error if any of the output could not be written.
+    void finish();
+
+private:
+    void compressorThread();
+    void queuePending();
+
+    std::ofstream file;
+    std::unique_ptr<DeflateEncoder> encoder;
+    std::string pending;
+
+    std::mutex queueMutex;
+    std::condition_variable queueChanged;
+    std::deque<std::string> queue;
+    bool closing = false;
+    std::exception_ptr failure;
+    std::thread compressor;
+    bool finished = false;
+};
+
+// Inflates a gzip stream read from source; pass it to a std::istream to
+// read the uncompressed text. Malformed or truncated input, or a checksum
+// mismatch, throws std::runtime_error from the reading call (istreams turn
+// that into badbit unless their exception mask includes it).
+class GzipInputBuffer : public std::streambuf {
+public:
+    explicit GzipInputBuffer(std::streambuf& source);
+
+    // True if the next bytes of source are a gzip header; consumes nothing.
+    static bool detect(std::streambuf& source);
+
+protected:
+    int_type underflow() override;
+
+private:
+    struct Huffman {
+        uint16_t count[16] = {};
+        std::vector<uint16_t> symbol;
+    };
+
+    enum class BlockState {
+        Header,
+        Stored,
+        Compressed,
+        Done
+    };
+
+    void readHeader();
+    void updateChecksum();
+    void readTrailer();
+    void beginBlock();
+    void inflate(size_t target);
+    unsigned char nextByte();
+    uint32_t bits(unsigned count);
+    int decode(const Huffman& code);
+    static void build(Huffman& code, const uint8_t* lengths, size_t count);
+
+    std::streambuf& source;
+    uint32_t bitBuffer = 0;
+    unsigned bitCount = 0;
+
+    BlockState state = BlockState::Header;
+    bool lastBlock = false;
+    size_t storedRemaining = 0;
+    Huffman lengthCode;
+    Huffman distanceCode;
+
+    // Inflated bytes: the window the next matches may reach back into,
+    // followed by the part the reader has not consumed yet.
+    std::vector<char> output;
+    // Start of the output not yet added to the checksum.
+    size_t checked = 0;
+    uint32_t crc = 0;
+    uint32_t size = 0;
+};
@@ -0,0 +1,347 @@
+#include "HandleResolver.h"
+#include "Metrics.h"
+#include "NameFolding.h"
+#include "ObjectTypeTable.h"
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <numeric>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+    // Objects per task handed to the pool.
+    const size_t ResolveChunkSize = 64;
+
+    // Stuck watchdog threads tolerated before risky name queries are skipped.
+    const size_t MaxAbandonedQueries = 16;
+
+    // Granted access of synchronous pipe handles whose name queries are known
+    // to block; these are skipped without spending a timeout on them.
+    const ACCESS_MASK BlockingFileAccess[] = { 0x0012019F, 0x001A019F, 0x00120189, 0x00100000 };
+
+    const OBJECT_INFORMATION_CLASS ObjectNameInformationClass = static_cast<OBJECT_INFORMATION_CLASS>(1);
+
+    bool isBlockingFileAccess(ACCESS_MASK access) {
+        return std::find(std::begin(BlockingFileAccess), std::end(BlockingFileAccess), access) !=
+            std::end(BlockingFileAccess);
+    }
+
+    // Queries a class whose result starts with a UNICODE_STRING (name or
+    // type), growing buffer until it fits.
+    NTSTATUS queryObjectString(NtApi& ntApi, HANDLE handle, OBJECT_INFORMATION_CLASS infoClass,
+        std::vector<BYTE>& buffer, std::wstring& value) {
+        value.clear();
+
+        NTSTATUS status = STATUS_INFO_LENGTH_MISMATCH;
+        for (int attempt = 0; attempt < 4; attempt++) {
+            ULONG returnLength = 0;
+            status = ntApi.queryObject(handle, infoClass, buffer.data(), static_cast<ULONG>(buffer.size()), &returnLength);
+            Metrics::instance().ntCall(NT_SUCCESS(status));
+
+            if (status != STATUS_INFO_LENGTH_MISMATCH && status != STATUS_BUFFER_TOO_SMALL) {
+                break;
+            }
+            buffer.resize(std::max<size_t>(returnLength, buffer.size() * 2));
+        }
+        if (!NT_SUCCESS(status)) {
+            return status;
+        }
+
+        const UNICODE_STRING& text = *reinterpret_cast<const UNICODE_STRING*>(buffer.data());
+        if (text.Buffer && text.Length > 0) {
+            value.assign(text.Buffer, text.Length / sizeof(WCHAR));
+        }
+        return status;
+    }
+}
+
+// Runs name queries one at a time on its own thread so the caller can give
+// up on one that hangs. A thread that misses its deadline is detached and
+// left to finish (or not) on its own; it owns the handle from then on and
+// closes it if the query ever returns.
+class HandleResolver::NameQueryThread {
+public:
+    explicit NameQueryThread(NtApi& ntApi) : state(std::make_shared<State>()) {
+        worker = std::thread(&NameQueryThread::run, std::ref(ntApi), state);
+    }
+
+    ~NameQueryThread() {
+        if (!worker.joinable()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->stop = true;
+        }
+        state->wakeup.notify_one();
+        worker.join();
+    }
+
+    NameQueryThread(const NameQueryThread&) = delete;
+    NameQueryThread& operator=(const NameQueryThread&) = delete;
+
+    // Returns false on timeout, after which this object must be discarded.
+    bool query(HANDLE handle, std::chrono::milliseconds timeout, NTSTATUS& status, std::wstring& name) {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        state->handle = handle;
+        state->pending = true;
+        state->wakeup.notify_one();
+
+        if (!state->finished.wait_for(lock, timeout, [this] { return !state->pending; })) {
+            state->abandoned = true;
+            lock.unlock();
+            worker.detach();
+            return false;
+        }
+
+        status = state->status;
+        name.swap(state->name);
+        return true;
+    }
+
+private:
+    struct State {
+        std::mutex mutex;
+        std::condition_variable wakeup;
+        std::condition_variable finished;
+        HANDLE handle = nullptr;
+        NTSTATUS status = STATUS_SUCCESS;
+        std::wstring name;
+        bool pending = false;
+        bool stop = false;
+        bool abandoned = false;
+    };
+
+    static void run(NtApi& ntApi, std::shared_ptr<State> state) {
+        std::vector<BYTE> buffer(2048);
+        std::wstring name;
+
+        std::unique_lock<std::mutex> lock(state->mutex);
+        while (true) {
+            state->wakeup.wait(lock, [&] { return state->pending || state->stop; });
+            if (!state->pending) {
+                return;
+            }
+
+            HANDLE handle = state->handle;
+            lock.unlock();
+            NTSTATUS status = queryObjectString(ntApi, handle, ObjectNameInformationClass, buffer, name);
+            lock.lock();
+
+            if (state->abandoned) {
+                lock.unlock();
+                ntApi.close(handle);
+                return;
+            }
+            state->status = status;
+            state->name.swap(name);
+            state->pending = false;
+            state->finished.notify_one();
+        }
+    }
+
+    std::shared_ptr<State> state;
+    std::thread worker;
+};
+
+NTSTATUS HandleTable::read(NtApi& ntApi) {
+    if (buffer.empty()) {
+        buffer.resize(1024 * 1024);
+    }
+
+    Metrics& metrics = Metrics::instance();
+    NTSTATUS status = STATUS_INFO_LENGTH_MISMATCH;
+    for (int attempt = 0; attempt < 8; attempt++) {
+        ULONG returnLength = 0;
+        status = ntApi.querySystemInformation(static_cast<SYSTEM_INFORMATION_CLASS>(SystemExtendedHandleInformation),
+            buffer.data(), static_cast<ULONG>(buffer.size()), &returnLength);
+        metrics.ntCall(NT_SUCCESS(status));
+
+        if (status != STATUS_INFO_LENGTH_MISMATCH) {
+            if (NT_SUCCESS(status)) {
+                metrics.add(MetricCounter::BytesBuffered, returnLength);
+            }
+            break;
+        }
+
+        // Handles keep being opened between calls, so leave some headroom.
+        buffer.resize(std::max<size_t>(returnLength + returnLength / 4, buffer.size() * 2));
+    }
+
+    if (!NT_SUCCESS(status)) {
+        // Never expose a partially written table.
+        reinterpret_cast<SYSTEM_HANDLE_INFORMATION_EX*>(buffer.data())->NumberOfHandles = 0;
+    }
+    return status;
+}
+
+HandleResolver::HandleResolver(NtApi& ntApi, ThreadPool& pool) : ntApi(ntApi), pool(pool) {
+}
+
+void HandleResolver::resolveObject(ResolvedObject& object, HANDLE process, const ResolvedHandle& source,
+    std::vector<BYTE>& buffer, std::unique_ptr<NameQueryThread>& watchdog) {
+    object.state = HandleNameState::Failed;
+
+    // With the type already known from the type table, hazardous handles
+    // are skipped before anything is duplicated.
+    auto mustSkip = [&] {
+        return equalsIgnoreCase(object.type, L"File") && (isBlockingFileAccess(source.grantedAccess) ||
+            abandonedCount.load(std::memory_order_relaxed) >= MaxAbandonedQueries);
+    };
+    if (mustSkip()) {
+        object.state = HandleNameState::Skipped;
+        return;
+    }
+
+    if (!process) {
+        object.status = STATUS_ACCESS_DENIED;
+        return;
+    }
+
+    HANDLE handle = nullptr;
+    object.status = ntApi.duplicateObject(process, reinterpret_cast<HANDLE>(source.handleValue), ntApi.currentProcess(),
+        &handle, 0, 0, DUPLICATE_SAME_ACCESS);
+    Metrics::instance().ntCall(NT_SUCCESS(object.status));
+    if (!NT_SUCCESS(object.status)) {
+        return;
+    }
+
+    // Only types registered after the table was loaded need a query.
+    if (object.type.empty()) {
+        object.status = queryObjectString(ntApi, handle, ObjectTypeInformation, buffer, object.type);
+        if (!NT_SUCCESS(object.status)) {
+            ntApi.close(handle);
+            return;
+        }
+        if (mustSkip()) {
+            object.state = HandleNameState::Skipped;
+            ntApi.close(handle);
+            return;
+        }
+    }
+
+    if (equalsIgnoreCase(object.type, L"File")) {
+
+        if (!watchdog) {
+            watchdog = std::make_unique<NameQueryThread>(ntApi);
+        }
+        if (!watchdog->query(handle, queryTimeout, object.status, object.name)) {
+            // The detached watchdog closes the handle if the query returns.
+            watchdog.reset();
+            abandonedCount.fetch_add(1, std::memory_order_relaxed);
+            Metrics::instance().add(MetricCounter::QueryTimeouts);
+            object.state = HandleNameState::TimedOut;
+            object.status = STATUS_IO_TIMEOUT;
+            return;
+        }
+    }
+    else {
+        object.status = queryObjectString(ntApi, handle, ObjectNameInformationClass, buffer, object.name);
+    }
+    ntApi.close(handle);
+
+    if (NT_SUCCESS(object.status)) {
+        object.state = object.name.empty() ? HandleNameState::Unnamed : HandleNameState::Resolved;
+    }
+}
+
+HandleSnapshot HandleResolver::resolve(DWORD processId) {
+    ScopedMetricTimer resolveTimer(MetricHistogram::HandleResolve);
+    HandleSnapshot snapshot;
+
+    snapshot.status = table.read(ntApi);
+    if (!NT_SUCCESS(snapshot.status)) {
+        return snapshot;
+    }
+
+    auto types = ObjectTypeTable::current(ntApi);
+
+    // Group handles by kernel object; the first handle seen for an object is
+    // the one duplicated to resolve it.
+    std::unordered_map<PVOID, uint32_t> objectsByAddress;
+    std::vector<size_t> representatives;
+    objectsByAddress.reserve(processId ? 1024 : table.size());
+    if (!processId) {
+        snapshot.handles.reserve(table.size());
+    }
+
+    for (const SYSTEM_HANDLE_TABLE_ENTRY_INFO_EX& entry : table) {
+        DWORD owner = static_cast<DWORD>(entry.UniqueProcessId);
+        if (processId && owner != processId) {
+            continue;
+        }
+
+        auto [it, inserted] = objectsByAddress.try_emplace(entry.Object, static_cast<uint32_t>(snapshot.objects.size()));
+        if (inserted) {
+            snapshot.objects.push_back({ entry.Object, entry.ObjectTypeIndex, HandleNameState::Failed, STATUS_SUCCESS,
+                types->name(entry.ObjectTypeIndex), {}, 0 });
+            representatives.push_back(snapshot.handles.size());
+        }
+        snapshot.objects[it->second].handleCount++;
+        snapshot.handles.push_back({ owner, entry.HandleValue, entry.GrantedAccess, it->second });
+    }
+
+    // Duplicate in per-process batches: each owning process is opened once
+    // and its objects are handed to the pool next to each other.
+    std::vector<uint32_t> order(snapshot.objects.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return snapshot.handles[representatives[a]].processId < snapshot.handles[representatives[b]].processId;
+    });
+
+    std::vector<HANDLE> sourceProcess(snapshot.objects.size(), nullptr);
+    std::vector<HANDLE> openedProcesses;
+    DWORD currentOwner = 0;
+    HANDLE currentProcess = nullptr;
+    for (size_t k = 0; k < order.size(); k++) {
+        DWORD owner = snapshot.handles[representatives[order[k]]].processId;
+        if (k == 0 || owner != currentOwner) {
+            currentOwner = owner;
+            currentProcess = ntApi.openProcess(PROCESS_DUP_HANDLE, owner);
+            if (currentProcess) {
+                openedProcesses.push_back(currentProcess);
+                snapshot.processesOpened++;
+            }
+            else {
+                snapshot.processesDenied++;
+            }
+        }
+        sourceProcess[order[k]] = currentProcess;
+    }
+
+    pool.parallelFor(order.size(), ResolveChunkSize, [&](size_t begin, size_t end) {
+        std::vector<BYTE> buffer(2048);
+        std::unique_ptr<NameQueryThread> watchdog;
+        for (size_t k = begin; k < end; k++) {
+            uint32_t index = order[k];
+            resolveObject(snapshot.objects[index], sourceProcess[index], snapshot.handles[representatives[index]],
+                buffer, watchdog);
+        }
+    });
+
+    for (HANDLE process : openedProcesses) {
+        ntApi.close(process);
+    }
+
+    for (const auto& object : snapshot.objects) {
+        if (object.state == HandleNameState::TimedOut) {
+            snapshot.timedOut++;
+        }
+        else if (object.state == HandleNameState::Skipped) {
+            snapshot.skipped++;
+        }
+    }
+    return snapshot;
+}
+
+std::vector<HandleInfo> HandleResolver::toHandleInfo(const HandleSnapshot& snapshot) {
+    std::vector<HandleInfo> result;
+    result.reserve(snapshot.handles.size());
+
+    for (const auto& handle : snapshot.handles) {
+        const ResolvedObject& object = snapshot.objects[handle.objectIndex];
+        result.push_back({ handle.processId, static_cast<DWORD>(handle.handleValue), object.type, object.name });
+    }
+    return result;
+}
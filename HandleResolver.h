@@ -0,0 +1,112 @@
+#pragma once
+#include "NtApi.h"
+#include "ThreadPool.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct HandleInfo {
+    DWORD processId;
+    DWORD handleValue;
+    std::wstring objectType;
+    std::wstring objectName;
+};
+
+enum class HandleNameState {
+    Resolved,
+    Unnamed,
+    Failed,
+    TimedOut,
+    Skipped
+};
+
+// One kernel object, resolved once no matter how many handles refer to it.
+struct ResolvedObject {
+    PVOID object;
+    USHORT typeIndex;
+    HandleNameState state;
+    // Status of the duplication or query that failed when state is Failed.
+    NTSTATUS status;
+    std::wstring type;
+    std::wstring name;
+    size_t handleCount;
+};
+
+struct ResolvedHandle {
+    DWORD processId;
+    ULONG_PTR handleValue;
+    ACCESS_MASK grantedAccess;
+    // Index into HandleSnapshot::objects.
+    uint32_t objectIndex;
+};
+
+struct HandleSnapshot {
+    // Status of reading the handle table.
+    NTSTATUS status = STATUS_SUCCESS;
+    std::vector<ResolvedObject> objects;
+    std::vector<ResolvedHandle> handles;
+    size_t processesOpened = 0;
+    size_t processesDenied = 0;
+    size_t timedOut = 0;
+    size_t skipped = 0;
+};
+
+// Reusable buffer holding a snapshot of the system handle table
+// (SystemExtendedHandleInformation), grown as the table grows.
+class HandleTable {
+public:
+    NTSTATUS read(NtApi& ntApi);
+
+    const SYSTEM_HANDLE_TABLE_ENTRY_INFO_EX* begin() const { return entries(); }
+    const SYSTEM_HANDLE_TABLE_ENTRY_INFO_EX* end() const { return entries() + size(); }
+    size_t size() const {
+        return buffer.empty() ? 0 : static_cast<size_t>(reinterpret_cast<const SYSTEM_HANDLE_INFORMATION_EX*>(buffer.data())->NumberOfHandles);
+    }
+
+private:
+    const SYSTEM_HANDLE_TABLE_ENTRY_INFO_EX* entries() const {
+        return reinterpret_cast<const SYSTEM_HANDLE_INFORMATION_EX*>(buffer.data())->Handles;
+    }
+
+    std::vector<BYTE> buffer;
+};
+
+// Resolves type and name for every handle in the system handle table.
+// Handles are grouped by kernel object address so each object is duplicated
+// and queried once, duplications are batched per owning process (one
+// process open each), and the queries run on the worker pool.
+//
+// ObjectNameInformation can block forever on some File handles (synchronous
+// pipes), so those name queries run on a watchdog thread and are abandoned
+// after the query timeout.
+class HandleResolver {
+public:
+    explicit HandleResolver(NtApi& ntApi = NtApi::system(), ThreadPool& pool = ThreadPool::shared());
+
+    void setQueryTimeout(std::chrono::milliseconds timeout) { queryTimeout = timeout; }
+
+    // processId 0 resolves the handles of every process.
+    HandleSnapshot resolve(DWORD processId = 0);
+
+    // One HandleInfo per handle, in handle table order.
+    static std::vector<HandleInfo> toHandleInfo(const HandleSnapshot& snapshot);
+
+    // Watchdog threads still stuck in a query. Past a limit further risky
+    // queries are skipped instead of leaking more threads.
+    size_t abandonedQueries() const { return abandonedCount.load(std::memory_order_relaxed); }
+
+private:
+    class NameQueryThread;
+
+    void resolveObject(ResolvedObject& object, HANDLE process, const ResolvedHandle& source,
+        std::vector<BYTE>& buffer, std::unique_ptr<NameQueryThread>& watchdog);
+
+    NtApi& ntApi;
+    ThreadPool& pool;
+    std::chrono::milliseconds queryTimeout{ 200 };
+    std::atomic<size_t> abandonedCount{ 0 };
+    HandleTable table;
+};
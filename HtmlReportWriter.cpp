@@ -0,0 +1,359 @@
+#include "HtmlReportWriter.h"
+#include <filesystem>
+#include <stdexcept>
+
+namespace {
+    void appendHex4(std::wstring& out, unsigned value) {
+        const wchar_t* digits = L"0123456789abcdef";
+        out += L"\\u";
+        for (int shift = 12; shift >= 0; shift -= 4) {
+            out += digits[(value >> shift) & 0xF];
+        }
+    }
+
+    // JSON string literal that is also safe inside a <script> element.
+    void appendJsonString(std::wstring& out, std::wstring_view value) {
+        out += L'"';
+        for (size_t i = 0; i < value.size(); i++) {
+            wchar_t c = value[i];
+            if (c == L'"' || c == L'\\') {
+                out += L'\\';
+                out += c;
+            }
+            else if (static_cast<unsigned>(c) < 0x20 || c == L'<') {
+                appendHex4(out, static_cast<unsigned>(c));
+            }
+            else if (c >= 0xD800 && c <= 0xDFFF) {
+                // Pairs pass through; a lone surrogate cannot be encoded as
+                // UTF-8 and is escaped instead.
+                bool paired = c <= 0xDBFF && i + 1 < value.size() && value[i + 1] >= 0xDC00 && value[i + 1] <= 0xDFFF;
+                if (paired) {
+                    out += c;
+                    out += value[++i];
+                }
+                else {
+                    appendHex4(out, static_cast<unsigned>(c));
+                }
+            }
+            else {
+                out += c;
+            }
+        }
+        out += L'"';
+    }
+
+    const wchar_t* columnKindName(ReportColumnKind kind) {
+        switch (kind) {
+        case ReportColumnKind::Dictionary: return L"dict";
+        case ReportColumnKind::Number: return L"number";
+        case ReportColumnKind::Text:
+        default: return L"text";
+        }
+    }
+
+    const wchar_t* PageHead =
+        L"<!DOCTYPE html>\n<html>\n<head>\n<meta charset=\"utf-8\">\n<title>";
+
+    const wchar_t* PageStyle =
+        L"</title>\n<style>\n"
+        L"body { font-family: Arial, sans-serif; margin: 40px; }\n"
+        L"h1 { color: #333; }\n"
+        L"pre { background-color: #f5f5f5; padding: 10px; }\n"
+        L".table { margin-bottom: 32px; }\n"
+        L".bar { margin: 8px 0; }\n"
+        L".viewport { height: 480px; overflow-y: auto; position: relative; border: 1px solid #ccc; }\n"
+        L".rows { position: absolute; left: 0; right: 0; }\n"
+        L".row, .head { display: flex; height: 22px; line-height: 22px; }\n"
+        L".head { font-weight: bold; background: #eee; cursor: pointer; border: 1px solid #ccc; border-bottom: none; }\n"
+        L".row:nth-child(odd) { background: #f9f9f9; }\n"
+        L".cell { flex: 1; overflow: hidden; white-space: nowrap; text-overflow: ellipsis; padding: 0 6px; }\n"
+        L".cell:first-child { flex: 3; }\n"
+        L"</style>\n</head>\n<body>\n"
+        L"<h1>Windows Object Manager Report</h1>\n"
+        L"<pre id=\"summary\"></pre>\n<div id=\"tables\"></div>\n";
+
+    // Rows are fetched a chunk at a time as they scroll into view; sorting
+    // and filtering first load every chunk of the table.
+    const wchar_t* PageScript =
+        L"<script>\n(function () {\n"
+        L"var M = JSON.parse(document.getElementById('manifest').textContent);\n"
+        L"var ROW = 22, VISIBLE = 24;\n"
+        L"document.getElementById('summary').textContent = M.summary;\n"
+        L"var tables = M.tables.map(function (t) {\n"
+        L"  return { meta: t, rows: new Array(t.rows), loaded: [], waiting: {}, view: null, sortColumn: -1, ascending: true };\n"
+        L"});\n"
+        L"window.reportChunk = function (t, n, rows) {\n"
+        L"  var s = tables[t], base = n * M.chunkRows;\n"
+        L"  for (var i = 0; i < rows.length; i++) s.rows[base + i] = rows[i];\n"
+        L"  s.loaded[n] = true;\n"
+        L"  (s.waiting[n] || []).forEach(function (done) { done(); });\n"
+        L"  delete s.waiting[n];\n"
+        L"};\n"
+        L"function loadChunk(t, n) {\n"
+        L"  var s = tables[t];\n"
+        L"  if (s.loaded[n]) return Promise.resolve();\n"
+        L"  return new Promise(function (done) {\n"
+        L"    if (s.waiting[n]) { s.waiting[n].push(done); return; }\n"
+        L"    s.waiting[n] = [done];\n"
+        L"    if (M.dataDirectory) {\n"
+        L"      var script = document.createElement('script');\n"
+        L"      script.src = M.dataDirectory + '/' + t + '-' + n + '.js';\n"
+        L"      document.body.appendChild(script);\n"
+        L"    } else {\n"
+        L"      window.reportChunk(t, n, JSON.parse(document.getElementById('c' + t + '-' + n).textContent));\n"
+        L"    }\n"
+        L"  });\n"
+        L"}\n"
+        L"function loadAll(t, progress) {\n"
+        L"  var n = 0, count = tables[t].meta.chunks;\n"
+        L"  function next() {\n"
+        L"    if (n >= count) return Promise.resolve();\n"
+        L"    progress(n, count);\n"
+        L"    return loadChunk(t, n++).then(next);\n"
+        L"  }\n"
+        L"  return next();\n"
+        L"}\n"
+        L"function cell(s, row, c) {\n"
+        L"  var v = row[c], kind = s.meta.columns[c].kind;\n"
+        L"  return kind === 'dict' ? s.meta.dictionaries[c][v] : v;\n"
+        L"}\n";
+
+    const wchar_t* PageScriptView =
+        L"function build(t) {\n"
+        L"  var s = tables[t], root = document.createElement('div');\n"
+        L"  root.className = 'table';\n"
+        L"  root.innerHTML = '<h2></h2><div class=\"bar\"><input placeholder=\"Filter\"> <span></span></div>'\n"
+        L"    + '<div class=\"head\"></div><div class=\"viewport\"><div class=\"spacer\"></div><div class=\"rows\"></div></div>';\n"
+        L"  root.querySelector('h2').textContent = s.meta.title + ' (' + s.meta.rows + ')';\n"
+        L"  var head = root.querySelector('.head'), viewport = root.querySelector('.viewport');\n"
+        L"  var spacer = root.querySelector('.spacer'), rowsDiv = root.querySelector('.rows');\n"
+        L"  var filter = root.querySelector('input'), status = root.querySelector('span');\n"
+        L"  s.meta.columns.forEach(function (column, c) {\n"
+        L"    var h = document.createElement('div');\n"
+        L"    h.className = 'cell';\n"
+        L"    h.textContent = column.title;\n"
+        L"    h.onclick = function () {\n"
+        L"      s.ascending = s.sortColumn === c ? !s.ascending : true;\n"
+        L"      s.sortColumn = c;\n"
+        L"      refresh();\n"
+        L"    };\n"
+        L"    head.appendChild(h);\n"
+        L"  });\n"
+        L"  function size() { return s.view ? s.view.length : s.meta.rows; }\n"
+        L"  function draw() {\n"
+        L"    spacer.style.height = size() * ROW + 'px';\n"
+        L"    var first = Math.floor(viewport.scrollTop / ROW), last = Math.min(size(), first + VISIBLE), missing = {};\n"
+        L"    rowsDiv.style.top = first * ROW + 'px';\n"
+        L"    rowsDiv.textContent = '';\n"
+        L"    for (var v = first; v < last; v++) {\n"
+        L"      var index = s.view ? s.view[v] : v, row = s.rows[index], line = document.createElement('div');\n"
+        L"      line.className = 'row';\n"
+        L"      if (!row) missing[Math.floor(index / M.chunkRows)] = true;\n"
+        L"      s.meta.columns.forEach(function (column, c) {\n"
+        L"        var d = document.createElement('div');\n"
+        L"        d.className = 'cell';\n"
+        L"        d.textContent = row ? cell(s, row, c) : '\\u2026';\n"
+        L"        line.appendChild(d);\n"
+        L"      });\n"
+        L"      rowsDiv.appendChild(line);\n"
+        L"    }\n"
+        L"    Object.keys(missing).forEach(function (n) { loadChunk(t, +n).then(draw); });\n"
+        L"  }\n"
+        L"  function refresh() {\n"
+        L"    var query = filter.value.toLowerCase();\n"
+        L"    if (!query && s.sortColumn < 0) { s.view = null; status.textContent = ''; draw(); return; }\n"
+        L"    loadAll(t, function (n, count) { status.textContent = 'Loading ' + n + '/' + count; }).then(function () {\n"
+        L"      var view = [];\n"
+        L"      for (var i = 0; i < s.rows.length; i++) {\n"
+        L"        if (!query || s.meta.columns.some(function (column, c) {\n"
+        L"          return String(cell(s, s.rows[i], c)).toLowerCase().indexOf(query) >= 0; })) view.push(i);\n"
+        L"      }\n"
+        L"      var c = s.sortColumn;\n"
+        L"      if (c >= 0) {\n"
+        L"        var numeric = s.meta.columns[c].kind === 'number', sign = s.ascending ? 1 : -1;\n"
+        L"        view.sort(function (a, b) {\n"
+        L"          var x = cell(s, s.rows[a], c), y = cell(s, s.rows[b], c);\n"
+        L"          return sign * (numeric ? x - y : (x < y ? -1 : x > y ? 1 : 0));\n"
+        L"        });\n"
+        L"      }\n"
+        L"      s.view = view;\n"
+        L"      status.textContent = view.length + ' matching';\n"
+        L"      viewport.scrollTop = 0;\n"
+        L"      draw();\n"
+        L"    });\n"
+        L"  }\n"
+        L"  var timer = null;\n"
+        L"  filter.oninput = function () { clearTimeout(timer); timer = setTimeout(refresh, 250); };\n"
+        L"  viewport.onscroll = function () { requestAnimationFrame(draw); };\n"
+        L"  document.getElementById('tables').appendChild(root);\n"
+        L"  draw();\n"
+        L"}\n"
+        L"tables.forEach(function (s, t) { build(t); });\n"
+        L"})();\n</script>\n</body>\n</html>\n";
+}
+
+HtmlReportWriter::HtmlReportWriter(const std::wstring& htmlPath, const std::wstring& title, bool sidecarChunks,
+    size_t chunkRows)
+    : sidecar(sidecarChunks), chunkRows(chunkRows > 0 ? chunkRows : DefaultChunkRows) {
+    if (sidecar) {
+        std::filesystem::path dataPath(htmlPath);
+        dataPath.replace_extension();
+        dataPath += L"_data";
+        std::error_code error;
+        std::filesystem::create_directories(dataPath, error);
+        if (error) {
+            throw std::runtime_error("Unable to create the report data directory");
+        }
+        dataDirectory = dataPath.wstring();
+        dataDirectoryName = dataPath.filename().wstring();
+    }
+
+    page = OutputSink::open(htmlPath, OutputFormat::Human);
+    std::wstring head = PageHead;
+    for (wchar_t c : title) {
+        if (c == L'<') head += L"&lt;";
+        else if (c == L'&') head += L"&amp;";
+        else head += c;
+    }
+    page->writeText(head);
+    page->writeText(PageStyle);
+}
+
+HtmlReportWriter::~HtmlReportWriter() {
+    if (!finished) {
+        try {
+            finish();
+        }
+        catch (...) {
+        }
+    }
+}
+
+void HtmlReportWriter::addSummary(std::wstring_view text) {
+    summary += text;
+}
+
+size_t HtmlReportWriter::addTable(const std::wstring& title, std::vector<ReportColumn> columns) {
+    Table table;
+    table.title = title;
+    table.dictionaryIndex.resize(columns.size());
+    table.dictionaries.resize(columns.size());
+    table.columns = std::move(columns);
+    tables.push_back(std::move(table));
+    return tables.size() - 1;
+}
+
+void HtmlReportWriter::addRow(size_t tableIndex, std::initializer_list<std::wstring_view> values) {
+    Table& table = tables[tableIndex];
+    std::wstring& chunk = table.chunk;
+    chunk += table.chunkRowCount == 0 ? L"[[" : L",[";
+
+    size_t column = 0;
+    for (std::wstring_view value : values) {
+        if (column > 0) {
+            chunk += L',';
+        }
+        ReportColumnKind kind = column < table.columns.size() ? table.columns[column].kind : ReportColumnKind::Text;
+
+        if (kind == ReportColumnKind::Dictionary) {
+            auto& index = table.dictionaryIndex[column];
+            auto it = index.find(std::wstring(value));
+            if (it == index.end()) {
+                it = index.emplace(std::wstring(value), index.size()).first;
+                table.dictionaries[column].push_back(it->first);
+            }
+            chunk += std::to_wstring(it->second);
+        }
+        else if (kind == ReportColumnKind::Number && !value.empty()) {
+            chunk += value;
+        }
+        else {
+            appendJsonString(chunk, value);
+        }
+        column++;
+    }
+    chunk += L']';
+
+    table.rows++;
+    if (++table.chunkRowCount == chunkRows) {
+        flushChunk(tableIndex);
+    }
+}
+
+void HtmlReportWriter::flushChunk(size_t tableIndex) {
+    Table& table = tables[tableIndex];
+    if (table.chunkRowCount == 0) {
+        return;
+    }
+    table.chunk += L']';
+
+    std::wstring id = std::to_wstring(tableIndex) + L"-" + std::to_wstring(table.chunks);
+    if (sidecar) {
+        auto file = OutputSink::open(dataDirectory + L"/" + id + L".js", OutputFormat::Human);
+        file->writeText(L"reportChunk(" + std::to_wstring(tableIndex) + L"," + std::to_wstring(table.chunks) + L",");
+        file->writeText(table.chunk);
+        file->writeText(L");\n");
+        file->flush();
+    }
+    else {
+        page->writeText(L"<script type=\"application/json\" id=\"c" + id + L"\">");
+        page->writeText(table.chunk);
+        page->writeText(L"</script>\n");
+    }
+
+    table.chunks++;
+    table.chunk.clear();
+    table.chunkRowCount = 0;
+}
+
+void HtmlReportWriter::finish() {
+    if (finished) {
+        return;
+    }
+    finished = true;
+
+    for (size_t i = 0; i < tables.size(); i++) {
+        flushChunk(i);
+    }
+
+    std::wstring manifest = L"<script type=\"application/json\" id=\"manifest\">{\"summary\":";
+    appendJsonString(manifest, summary);
+    manifest += L",\"chunkRows\":" + std::to_wstring(chunkRows) + L",\"dataDirectory\":";
+    appendJsonString(manifest, dataDirectoryName);
+    manifest += L",\"tables\":[";
+
+    for (size_t i = 0; i < tables.size(); i++) {
+        const Table& table = tables[i];
+        manifest += i == 0 ? L"{\"title\":" : L",{\"title\":";
+        appendJsonString(manifest, table.title);
+        manifest += L",\"rows\":" + std::to_wstring(table.rows) + L",\"chunks\":" + std::to_wstring(table.chunks);
+
+        manifest += L",\"columns\":[";
+        for (size_t c = 0; c < table.columns.size(); c++) {
+            manifest += c == 0 ? L"{\"title\":" : L",{\"title\":";
+            appendJsonString(manifest, table.columns[c].title);
+            manifest += L",\"kind\":\"";
+            manifest += columnKindName(table.columns[c].kind);
+            manifest += L"\"}";
+        }
+
+        manifest += L"],\"dictionaries\":[";
+        for (size_t c = 0; c < table.dictionaries.size(); c++) {
+            manifest += c == 0 ? L"[" : L",[";
+            for (size_t v = 0; v < table.dictionaries[c].size(); v++) {
+                if (v > 0) {
+                    manifest += L',';
+                }
+                appendJsonString(manifest, table.dictionaries[c][v]);
+            }
+            manifest += L']';
+        }
+        manifest += L"]}";
+    }
+    manifest += L"]}</script>\n";
+
+    page->writeText(manifest);
+    page->writeText(PageScript);
+    page->writeText(PageScriptView);
+    page->flush();
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include "OutputSink.h"
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+enum class ReportColumnKind {
+    Text,
+    // Repeated values (types, kinds) stored once per table and referenced
+    // by index from the rows.
+    Dictionary,
+    // Rendered and sorted as a number; the value must be numeric text.
+    Number
+};
+
+struct ReportColumn {
+    std::wstring title;
+    ReportColumnKind kind = ReportColumnKind::Text;
+};
+
+// Streams an interactive HTML report: tables of any size are written as
+// compact JSON chunks of a fixed row count while rows arrive, and the page
+// renders them in virtualized tables that only draw the visible rows.
+// Chunks go either inline as inert application/json scripts or, for very
+// large reports, to sidecar .js files loaded on demand, so the page itself
+// stays small. Sorting and filtering run in the page.
+class HtmlReportWriter {
+public:
+    static constexpr size_t DefaultChunkRows = 20000;
+
+    // Throws std::runtime_error if the page or the data directory cannot be
+    // created. Sidecar chunks go to "<page without extension>_data".
+    HtmlReportWriter(const std::wstring& htmlPath, const std::wstring& title, bool sidecarChunks,
+        size_t chunkRows = DefaultChunkRows);
+    ~HtmlReportWriter();
+
+    HtmlReportWriter(const HtmlReportWriter&) = delete;
+    HtmlReportWriter& operator=(const HtmlReportWriter&) = delete;
+
+    // Preformatted text shown above the tables.
+    void addSummary(std::wstring_view text);
+
+    size_t addTable(const std::wstring& title, std::vector<ReportColumn> columns);
+    // values[i] belongs to column i.
+    void addRow(size_t table, std::initializer_list<std::wstring_view> values);
+
+    // Writes the remaining chunks, the manifest and the page script.
+    void finish();
+
+private:
+    struct Table {
+        std::wstring title;
+        std::vector<ReportColumn> columns;
+        std::vector<std::unordered_map<std::wstring, size_t>> dictionaryIndex;
+        std::vector<std::vector<std::wstring_view>> dictionaries;
+        std::wstring chunk;
+        size_t chunkRowCount = 0;
+        size_t chunks = 0;
+        size_t rows = 0;
+    };
+
+    void flushChunk(size_t table);
+
+    std::unique_ptr<OutputSink> page;
+    std::wstring dataDirectory;
+    std::wstring dataDirectoryName;
+    bool sidecar;
+    size_t chunkRows;
+    std::wstring summary;
+    std::vector<Table> tables;
+    bool finished = false;
+};
@@ -0,0 +1,201 @@
+#include "Metrics.h"
+#include "OutputSink.h"
+#include <sstream>
+#include <iomanip>
+
+namespace {
+    const wchar_t* counterNames[] = {
+        L"entries_enumerated",
+        L"nt_calls_issued",
+        L"nt_calls_failed",
+        L"bytes_buffered",
+        L"allocations",
+        L"change_events",
+        L"query_timeouts",
+        L"transient_objects",
+        L"directory_handles_reused",
+    };
+
+    const wchar_t* histogramNames[] = {
+        L"directory_scan",
+        L"monitor_tick",
+        L"monitor_diff",
+        L"monitor_callback",
+        L"report_type_statistics",
+        L"report_dependencies",
+        L"report_statistics",
+        L"report_save",
+        L"object_info_batch",
+        L"handle_resolve",
+        L"monitor_revalidate",
+        L"monitor_slice",
+    };
+
+    static_assert(sizeof(counterNames) / sizeof(counterNames[0]) == static_cast<size_t>(MetricCounter::Count),
+        "counterNames out of sync with MetricCounter");
+    static_assert(sizeof(histogramNames) / sizeof(histogramNames[0]) == static_cast<size_t>(MetricHistogram::Count),
+        "histogramNames out of sync with MetricHistogram");
+
+    size_t bucketIndex(uint64_t micros) {
+        size_t index = 0;
+        uint64_t bound = 1;
+        while (index < Metrics::BucketCount && micros > bound) {
+            bound <<= 1;
+            index++;
+        }
+        return index;
+    }
+
+    double bucketBoundSeconds(size_t index) {
+        return static_cast<double>(1ULL << index) / 1e6;
+    }
+}
+
+Metrics& Metrics::instance() {
+    static Metrics metrics;
+    return metrics;
+}
+
+Metrics::~Metrics() {
+    stopPeriodicDump();
+}
+
+void Metrics::record(MetricHistogram histogram, std::chrono::nanoseconds duration) {
+    HistogramData& data = histograms[static_cast<size_t>(histogram)];
+    uint64_t nanos = duration.count() > 0 ? static_cast<uint64_t>(duration.count()) : 0;
+
+    data.buckets[bucketIndex(nanos / 1000)].fetch_add(1, std::memory_order_relaxed);
+    data.count.fetch_add(1, std::memory_order_relaxed);
+    data.sumNanoseconds.fetch_add(nanos, std::memory_order_relaxed);
+}
+
+uint64_t Metrics::counterValue(MetricCounter counter) const {
+    return counters[static_cast<size_t>(counter)].load(std::memory_order_relaxed);
+}
+
+uint64_t Metrics::histogramCount(MetricHistogram histogram) const {
+    return histograms[static_cast<size_t>(histogram)].count.load(std::memory_order_relaxed);
+}
+
+std::wstring Metrics::exportText(MetricsFormat format) const {
+    switch (format) {
+    case MetricsFormat::Json:
+        return exportJson();
+    case MetricsFormat::Prometheus:
+    default:
+        return exportPrometheus();
+    }
+}
+
+std::wstring Metrics::exportPrometheus() const {
+    std::wstringstream ss;
+
+    for (size_t i = 0; i < static_cast<size_t>(MetricCounter::Count); i++) {
+        ss << L"# TYPE objmgr_" << counterNames[i] << L"_total counter\n"
+            << L"objmgr_" << counterNames[i] << L"_total "
+            << counters[i].load(std::memory_order_relaxed) << L"\n";
+    }
+
+    for (size_t i = 0; i < static_cast<size_t>(MetricHistogram::Count); i++) {
+        const HistogramData& data = histograms[i];
+        std::wstring name = std::wstring(L"objmgr_") + histogramNames[i] + L"_seconds";
+
+        ss << L"# TYPE " << name << L" histogram\n";
+
+        uint64_t cumulative = 0;
+        for (size_t b = 0; b < BucketCount; b++) {
+            cumulative += data.buckets[b].load(std::memory_order_relaxed);
+            ss << name << L"_bucket{le=\"" << bucketBoundSeconds(b) << L"\"} " << cumulative << L"\n";
+        }
+        cumulative += data.buckets[BucketCount].load(std::memory_order_relaxed);
+        ss << name << L"_bucket{le=\"+Inf\"} " << cumulative << L"\n"
+            << name << L"_sum " << std::fixed << std::setprecision(6)
+            << data.sumNanoseconds.load(std::memory_order_relaxed) / 1e9 << L"\n"
+            << std::defaultfloat
+            << name << L"_count " << data.count.load(std::memory_order_relaxed) << L"\n";
+    }
+
+    return ss.str();
+}
+
+std::wstring Metrics::exportJson() const {
+    std::wstringstream ss;
+    ss << L"{\n  \"counters\": {";
+
+    for (size_t i = 0; i < static_cast<size_t>(MetricCounter::Count); i++) {
+        ss << (i ? L"," : L"") << L"\n    \"" << counterNames[i] << L"\": "
+            << counters[i].load(std::memory_order_relaxed);
+    }
+
+    ss << L"\n  },\n  \"histograms\": {";
+
+    for (size_t i = 0; i < static_cast<size_t>(MetricHistogram::Count); i++) {
+        const HistogramData& data = histograms[i];
+        ss << (i ? L"," : L"") << L"\n    \"" << histogramNames[i] << L"\": {"
+            << L"\"count\": " << data.count.load(std::memory_order_relaxed)
+            << L", \"sum_us\": " << data.sumNanoseconds.load(std::memory_order_relaxed) / 1000
+            << L", \"buckets_us\": [";
+
+        for (size_t b = 0; b <= BucketCount; b++) {
+            ss << (b ? L", " : L"") << data.buckets[b].load(std::memory_order_relaxed);
+        }
+        ss << L"]}";
+    }
+
+    ss << L"\n  }\n}\n";
+    return ss.str();
+}
+
+void Metrics::exportToFile(const std::wstring& filePath, MetricsFormat format) const {
+    auto output = OutputSink::open(filePath, OutputFormat::Human);
+    output->writeText(exportText(format));
+    output->close();
+}
+
+void Metrics::startPeriodicDump(const std::wstring& filePath, MetricsFormat format, std::chrono::seconds interval) {
+    stopPeriodicDump();
+
+    std::lock_guard<std::mutex> lock(dumperMutex);
+    dumperRunning = true;
+    dumper = std::thread(&Metrics::dumpThread, this, filePath, format, interval);
+}
+
+void Metrics::stopPeriodicDump() {
+    {
+        std::lock_guard<std::mutex> lock(dumperMutex);
+        dumperRunning = false;
+    }
+    dumperWakeup.notify_all();
+
+    if (dumper.joinable()) {
+        dumper.join();
+    }
+}
+
+void Metrics::dumpThread(std::wstring filePath, MetricsFormat format, std::chrono::seconds interval) {
+    std::unique_lock<std::mutex> lock(dumperMutex);
+    while (dumperRunning) {
+        lock.unlock();
+        try {
+            exportToFile(filePath, format);
+        }
+        catch (const std::exception&) {
+            // Keep dumping; the target may become writable again.
+        }
+        lock.lock();
+        dumperWakeup.wait_for(lock, interval, [this] { return !dumperRunning; });
+    }
+}
+
+void Metrics::reset() {
+    for (auto& counter : counters) {
+        counter.store(0, std::memory_order_relaxed);
+    }
+    for (auto& data : histograms) {
+        for (auto& bucket : data.buckets) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        data.count.store(0, std::memory_order_relaxed);
+        data.sumNanoseconds.store(0, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,134 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Hot-path counters. Keep in sync with counterNames in Metrics.cpp.
+enum class MetricCounter {
+    EntriesEnumerated,
+    NtCallsIssued,
+    NtCallsFailed,
+    BytesBuffered,
+    // Heap allocations made on scan and monitor paths, counted where they
+    // happen: arena blocks, container nodes and growth, and strings too
+    // long for the small-string buffer.
+    Allocations,
+    ChangeEvents,
+    QueryTimeouts,
+    TransientObjects,
+    DirectoryHandlesReused,
+    Count
+};
+
+// Latency histograms. Keep in sync with histogramNames in Metrics.cpp.
+enum class MetricHistogram {
+    DirectoryScan,
+    MonitorTick,
+    MonitorDiff,
+    MonitorCallback,
+    ReportTypeStatistics,
+    ReportDependencies,
+    ReportStatistics,
+    ReportSave,
+    ObjectInfoBatch,
+    HandleResolve,
+    MonitorRevalidate,
+    MonitorSlice,
+    Count
+};
+
+enum class MetricsFormat {
+    Prometheus,
+    Json
+};
+
+// Process-wide metrics registry. Every update is a single relaxed atomic
+// add, so it is cheap enough to stay enabled permanently.
+class Metrics {
+public:
+    // Bucket upper bounds are powers of two in microseconds: 1us .. ~34s.
+    static constexpr size_t BucketCount = 26;
+
+    static Metrics& instance();
+
+    void add(MetricCounter counter, uint64_t value = 1) {
+        counters[static_cast<size_t>(counter)].fetch_add(value, std::memory_order_relaxed);
+    }
+
+    // Counts the allocation a std::wstring of this length makes; one that
+    // fits the small-string buffer makes none.
+    void stringAllocated(size_t length) {
+        static const size_t inlineCapacity = std::wstring().capacity();
+        if (length > inlineCapacity) {
+            add(MetricCounter::Allocations);
+        }
+    }
+
+    void ntCall(bool succeeded) {
+        add(MetricCounter::NtCallsIssued);
+        if (!succeeded) {
+            add(MetricCounter::NtCallsFailed);
+        }
+    }
+
+    void record(MetricHistogram histogram, std::chrono::nanoseconds duration);
+
+    uint64_t counterValue(MetricCounter counter) const;
+    uint64_t histogramCount(MetricHistogram histogram) const;
+
+    std::wstring exportText(MetricsFormat format) const;
+    void exportToFile(const std::wstring& filePath, MetricsFormat format) const;
+
+    // Rewrites filePath every interval until stopPeriodicDump() is called.
+    void startPeriodicDump(const std::wstring& filePath, MetricsFormat format, std::chrono::seconds interval);
+    void stopPeriodicDump();
+
+    void reset();
+
+private:
+    Metrics() = default;
+    ~Metrics();
+    Metrics(const Metrics&) = delete;
+    Metrics& operator=(const Metrics&) = delete;
+
+    struct HistogramData {
+        std::atomic<uint64_t> buckets[BucketCount + 1] = {};
+        std::atomic<uint64_t> count{ 0 };
+        std::atomic<uint64_t> sumNanoseconds{ 0 };
+    };
+
+    std::wstring exportPrometheus() const;
+    std::wstring exportJson() const;
+    void dumpThread(std::wstring filePath, MetricsFormat format, std::chrono::seconds interval);
+
+    std::atomic<uint64_t> counters[static_cast<size_t>(MetricCounter::Count)] = {};
+    HistogramData histograms[static_cast<size_t>(MetricHistogram::Count)];
+
+    std::thread dumper;
+    std::mutex dumperMutex;
+    std::condition_variable dumperWakeup;
+    bool dumperRunning = false;
+};
+
+// Records the lifetime of the enclosing scope into a histogram.
+class ScopedMetricTimer {
+public:
+    explicit ScopedMetricTimer(MetricHistogram histogram)
+        : histogram(histogram), start(std::chrono::steady_clock::now()) {
+    }
+
+    ~ScopedMetricTimer() {
+        Metrics::instance().record(histogram, std::chrono::steady_clock::now() - start);
+    }
+
+    ScopedMetricTimer(const ScopedMetricTimer&) = delete;
+    ScopedMetricTimer& operator=(const ScopedMetricTimer&) = delete;
+
+private:
+    MetricHistogram histogram;
+    std::chrono::steady_clock::time_point start;
+};
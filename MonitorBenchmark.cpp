@@ -0,0 +1,289 @@
+#include "MonitorBenchmark.h"
+#include "OutputSink.h"
+#include "SimulatedNtApi.h"
+#include "Timestamp.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cwchar>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <thread>
+
+namespace {
+    const wchar_t BenchPrefix[] = L"Bench_";
+
+    // Uniform in [0, 1). mt19937_64's output is fixed by the standard,
+    // unlike the library distributions, so schedules match across builds.
+    double nextUniform(std::mt19937_64& random) {
+        return static_cast<double>(random() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    std::chrono::nanoseconds percentile(std::vector<std::chrono::nanoseconds>& values, double fraction) {
+        if (values.empty()) {
+            return std::chrono::nanoseconds(0);
+        }
+        size_t rank = static_cast<size_t>(std::ceil(fraction * values.size()));
+        size_t index = rank > 0 ? rank - 1 : 0;
+        std::nth_element(values.begin(), values.begin() + index, values.end());
+        return values[index];
+    }
+
+    double toMillis(std::chrono::nanoseconds value) {
+        return std::chrono::duration<double, std::milli>(value).count();
+    }
+}
+
+double MonitorBenchmarkResult::missedEventRate() const {
+    if (created == 0) {
+        return 0.0;
+    }
+    return static_cast<double>(missed * 2 + missedDeletes) / static_cast<double>(created * 2);
+}
+
+std::vector<MonitorProfile> MonitorBenchmarkConfig::defaultProfiles() {
+    std::vector<MonitorProfile> profiles;
+    profiles.push_back({ L"poll-1000", std::chrono::milliseconds(1000), {} });
+    profiles.push_back({ L"poll-250", std::chrono::milliseconds(250), {} });
+    profiles.push_back({ L"poll-100", std::chrono::milliseconds(100), {} });
+
+    MonitorProfile sliced{ L"poll-250-sliced", std::chrono::milliseconds(250), {} };
+    sliced.slicing.maxEntries = 1024;
+    profiles.push_back(sliced);
+    return profiles;
+}
+
+MonitorBenchmark::MonitorBenchmark(MonitorBenchmarkConfig config) : config(std::move(config)) {
+    if (this->config.profiles.empty()) {
+        this->config.profiles = MonitorBenchmarkConfig::defaultProfiles();
+    }
+    buildSchedule();
+}
+
+void MonitorBenchmark::buildSchedule() {
+    schedule.clear();
+    if (config.createsPerSecond == 0) {
+        return;
+    }
+
+    std::mt19937_64 random(config.seed);
+    const double end = std::chrono::duration<double>(config.duration).count();
+    const double minLog = std::log(static_cast<double>(std::max<int64_t>(config.minLifetime.count(), 1)));
+    const double maxLog = std::log(static_cast<double>(std::max(config.maxLifetime, config.minLifetime).count()));
+
+    double at = 0.0;
+    while (true) {
+        at += -std::log(1.0 - nextUniform(random)) / config.createsPerSecond;
+        if (at >= end) {
+            break;
+        }
+        double lifetimeMillis = std::exp(minLog + nextUniform(random) * (maxLog - minLog));
+        schedule.push_back({ std::chrono::nanoseconds(static_cast<int64_t>(at * 1e9)),
+            std::chrono::nanoseconds(static_cast<int64_t>(lifetimeMillis * 1e6)) });
+    }
+}
+
+std::vector<MonitorBenchmarkResult> MonitorBenchmark::run() {
+    std::vector<MonitorBenchmarkResult> results;
+    for (const MonitorProfile& profile : config.profiles) {
+        std::wcout << L"Running profile " << profile.name << L"...\n";
+        results.push_back(runProfile(profile));
+    }
+    return results;
+}
+
+MonitorBenchmarkResult MonitorBenchmark::runProfile(const MonitorProfile& profile) {
+    using Clock = std::chrono::steady_clock;
+
+    SimulatedNtApi ntApi;
+    ntApi.populateDefaultNamespace();
+    ntApi.createDirectory(config.directory);
+    ntApi.populate(config.directory, L"Event", L"Background_", config.backgroundObjects);
+
+    std::wstring prefix = config.directory;
+    if (prefix.back() != L'\\') {
+        prefix += L'\\';
+    }
+    prefix += BenchPrefix;
+
+    // Workload ticks are written by this thread and detection ticks by the
+    // monitor thread; both are read only once the monitor has stopped.
+    const size_t count = schedule.size();
+    std::vector<EventTick> createdAt(count, 0);
+    std::vector<EventTick> deletedAt(count, 0);
+    std::vector<EventTick> createSeen(count, 0);
+    std::vector<EventTick> deleteSeen(count, 0);
+    std::vector<std::chrono::nanoseconds> tickCpu;
+    std::vector<std::chrono::nanoseconds> tickWall;
+    std::atomic<size_t> ticks{ 0 };
+
+    ObjectMonitor monitor(ntApi);
+    monitor.setChangeCallback([&](const ObjectChangeInfo& change) {
+        const size_t prefixLength = sizeof(BenchPrefix) / sizeof(wchar_t) - 1;
+        if (change.objectName.compare(0, prefixLength, BenchPrefix) != 0) {
+            return;
+        }
+        size_t index = std::wcstoul(change.objectName.c_str() + prefixLength, nullptr, 10);
+        if (index >= count) {
+            return;
+        }
+        if (change.changeType == ChangeType::Created && createSeen[index] == 0) {
+            createSeen[index] = currentTick();
+        }
+        else if (change.changeType == ChangeType::Deleted && deleteSeen[index] == 0) {
+            deleteSeen[index] = currentTick();
+        }
+    });
+    monitor.setScanSlicing(profile.slicing);
+    monitor.setPollInterval(profile.pollInterval, [&](const MonitorTickReport& tick) {
+        tickCpu.push_back(tick.cpuTime);
+        tickWall.push_back(tick.duration);
+        ticks.fetch_add(1, std::memory_order_release);
+    });
+
+    auto monitorStart = Clock::now();
+    monitor.startMonitoring(config.directory);
+
+    // Objects created before the first scan would land in its baseline
+    // and never be reported.
+    while (ticks.load(std::memory_order_acquire) == 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    struct Operation {
+        std::chrono::nanoseconds at;
+        size_t index;
+        bool create;
+    };
+    std::vector<Operation> operations;
+    operations.reserve(count * 2);
+    for (size_t i = 0; i < count; i++) {
+        operations.push_back({ schedule[i].createAt, i, true });
+        operations.push_back({ schedule[i].createAt + schedule[i].lifetime, i, false });
+    }
+    std::stable_sort(operations.begin(), operations.end(),
+        [](const Operation& a, const Operation& b) { return a.at < b.at; });
+
+    std::wstring path;
+    auto workloadStart = Clock::now();
+    for (const Operation& operation : operations) {
+        std::this_thread::sleep_until(workloadStart + operation.at);
+        path = prefix;
+        path += std::to_wstring(operation.index);
+        if (operation.create) {
+            createdAt[operation.index] = currentTick();
+            ntApi.createObject(path, L"Event");
+        }
+        else {
+            deletedAt[operation.index] = currentTick();
+            ntApi.deleteObject(path);
+        }
+    }
+
+    // Two full ticks after the last deletion, counting the pauses between
+    // slices of a sliced pass.
+    std::chrono::nanoseconds pass = std::chrono::milliseconds(0);
+    if (profile.slicing.maxEntries > 0) {
+        size_t entries = config.backgroundObjects + count + 1024;
+        pass = profile.slicing.pause * (entries / profile.slicing.maxEntries + 1);
+    }
+    std::this_thread::sleep_for(2 * (profile.pollInterval + pass) + std::chrono::milliseconds(100));
+
+    monitor.stopMonitoring();
+    auto wall = Clock::now() - monitorStart;
+
+    MonitorBenchmarkResult result;
+    result.profile = profile;
+    result.created = count;
+
+    std::vector<std::chrono::nanoseconds> createLatency;
+    std::vector<std::chrono::nanoseconds> deleteLatency;
+    for (size_t i = 0; i < count; i++) {
+        bool shortLived = schedule[i].lifetime < profile.pollInterval;
+        result.shortLived += shortLived;
+        if (createSeen[i] == 0) {
+            result.missed++;
+            result.shortLivedMissed += shortLived;
+            continue;
+        }
+        createLatency.emplace_back(createSeen[i] > createdAt[i] ? createSeen[i] - createdAt[i] : 0);
+        if (deleteSeen[i] == 0) {
+            result.missedDeletes++;
+        }
+        else {
+            deleteLatency.emplace_back(deleteSeen[i] > deletedAt[i] ? deleteSeen[i] - deletedAt[i] : 0);
+        }
+    }
+    result.createP50 = percentile(createLatency, 0.50);
+    result.createP99 = percentile(createLatency, 0.99);
+    result.deleteP50 = percentile(deleteLatency, 0.50);
+    result.deleteP99 = percentile(deleteLatency, 0.99);
+
+    result.ticks = tickCpu.size();
+    std::chrono::nanoseconds cpuTotal{ 0 };
+    std::chrono::nanoseconds wallTotal{ 0 };
+    for (size_t i = 0; i < tickCpu.size(); i++) {
+        cpuTotal += tickCpu[i];
+        wallTotal += tickWall[i];
+    }
+    if (result.ticks > 0) {
+        result.cpuPerTickMean = cpuTotal / result.ticks;
+        result.wallPerTickMean = wallTotal / result.ticks;
+    }
+    result.cpuPerTickP99 = percentile(tickCpu, 0.99);
+    result.cpuShare = wall.count() > 0 ? static_cast<double>(cpuTotal.count()) / std::chrono::nanoseconds(wall).count() : 0.0;
+    return result;
+}
+
+std::wstring MonitorBenchmark::renderReport(const std::vector<MonitorBenchmarkResult>& results) const {
+    std::wostringstream out;
+    out << std::fixed << std::setprecision(1);
+    out << L"Monitor change-detection benchmark\n"
+        << L"Directory: " << config.directory << L"\n"
+        << L"Background objects: " << config.backgroundObjects << L"\n"
+        << L"Workload: " << config.createsPerSecond << L" creates/s for " << config.duration.count()
+        << L" s, lifetimes " << config.minLifetime.count() << L"-" << config.maxLifetime.count()
+        << L" ms log-uniform, " << schedule.size() << L" objects\n"
+        << L"Seed: " << config.seed << L"\n"
+        << L"The workload is fixed by the settings above; timings depend on the host.\n\n";
+
+    out << std::left << std::setw(18) << L"Profile" << std::right
+        << std::setw(8) << L"Poll ms" << std::setw(8) << L"Slice"
+        << std::setw(9) << L"Created" << std::setw(8) << L"Missed" << std::setw(9) << L"Lost %"
+        << std::setw(12) << L"Short miss"
+        << std::setw(11) << L"Create p50" << std::setw(11) << L"Create p99"
+        << std::setw(11) << L"Delete p50" << std::setw(11) << L"Delete p99"
+        << std::setw(7) << L"Ticks" << std::setw(10) << L"CPU/tick" << std::setw(10) << L"CPU p99"
+        << std::setw(10) << L"Wall/tick" << std::setw(7) << L"CPU %" << L"\n";
+
+    for (const MonitorBenchmarkResult& result : results) {
+        std::wstring shortMissed = std::to_wstring(result.shortLivedMissed) + L"/" + std::to_wstring(result.shortLived);
+        out << std::left << std::setw(18) << result.profile.name << std::right
+            << std::setw(8) << result.profile.pollInterval.count()
+            << std::setw(8) << result.profile.slicing.maxEntries
+            << std::setw(9) << result.created << std::setw(8) << result.missed
+            << std::setw(9) << result.missedEventRate() * 100.0
+            << std::setw(12) << shortMissed
+            << std::setw(11) << toMillis(result.createP50) << std::setw(11) << toMillis(result.createP99)
+            << std::setw(11) << toMillis(result.deleteP50) << std::setw(11) << toMillis(result.deleteP99)
+            << std::setw(7) << result.ticks
+            << std::setprecision(3)
+            << std::setw(10) << toMillis(result.cpuPerTickMean) << std::setw(10) << toMillis(result.cpuPerTickP99)
+            << std::setw(10) << toMillis(result.wallPerTickMean)
+            << std::setprecision(1)
+            << std::setw(7) << result.cpuShare * 100.0 << L"\n";
+    }
+
+    out << L"\nLatencies and per-tick times are in milliseconds. Lost % counts the Created and\n"
+        << L"Deleted events the monitor never reported; Short miss is missed objects that\n"
+        << L"lived shorter than the poll interval, out of all such objects.\n";
+    return out.str();
+}
+
+void MonitorBenchmark::saveReport(const std::vector<MonitorBenchmarkResult>& results, const std::wstring& filePath) const {
+    auto output = OutputSink::open(filePath, OutputFormat::Human);
+    output->writeText(renderReport(results));
+    output->close();
+}
@@ -0,0 +1,95 @@
+#pragma once
+#include "ObjectMonitor.h"
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One polling configuration of the monitor to measure.
+struct MonitorProfile {
+    std::wstring name;
+    std::chrono::milliseconds pollInterval{ 1000 };
+    ScanSlicing slicing;
+};
+
+// A create/delete workload driven against the monitor on a simulated
+// namespace. The schedule of creations and lifetimes is drawn from seed
+// alone, so every profile, and every run with the same settings, sees the
+// same workload.
+struct MonitorBenchmarkConfig {
+    std::wstring directory = L"\\BaseNamedObjects";
+    // Long-lived objects already in directory, which every scan has to read.
+    size_t backgroundObjects = 10000;
+    // Mean rate; creations arrive as a Poisson process.
+    unsigned createsPerSecond = 200;
+    // Lifetimes are log-uniform over this range, so short-lived objects
+    // are as common as long-lived ones.
+    std::chrono::milliseconds minLifetime{ 20 };
+    std::chrono::milliseconds maxLifetime{ 5000 };
+    // Creations stop after this long; the run lasts until the last object
+    // is deleted and the monitor has had two ticks to notice.
+    std::chrono::seconds duration{ 10 };
+    uint64_t seed = 1;
+    std::vector<MonitorProfile> profiles;
+
+    // 1000, 250 and 100 ms polls, plus a 250 ms poll sliced into reads of
+    // 1024 entries.
+    static std::vector<MonitorProfile> defaultProfiles();
+};
+
+// Detection latency is from the workload creating or deleting an object to
+// the monitor's change callback reporting it.
+struct MonitorBenchmarkResult {
+    MonitorProfile profile;
+    size_t created = 0;
+    // Objects never reported as Created; lost with them are their Deleted
+    // events.
+    size_t missed = 0;
+    // Of those, objects that lived shorter than the poll interval, which
+    // polling cannot be expected to see.
+    size_t shortLived = 0;
+    size_t shortLivedMissed = 0;
+    // Reported creations whose deletion was never reported.
+    size_t missedDeletes = 0;
+    std::chrono::nanoseconds createP50{ 0 };
+    std::chrono::nanoseconds createP99{ 0 };
+    std::chrono::nanoseconds deleteP50{ 0 };
+    std::chrono::nanoseconds deleteP99{ 0 };
+    size_t ticks = 0;
+    std::chrono::nanoseconds cpuPerTickMean{ 0 };
+    std::chrono::nanoseconds cpuPerTickP99{ 0 };
+    std::chrono::nanoseconds wallPerTickMean{ 0 };
+    // Monitor thread CPU over the run's wall time.
+    double cpuShare = 0.0;
+
+    // Lost events over all Created and Deleted events the workload caused.
+    double missedEventRate() const;
+};
+
+// Runs each profile against a fresh SimulatedNtApi in turn. A run takes
+// roughly duration plus maxLifetime of wall time per profile.
+class MonitorBenchmark {
+public:
+    explicit MonitorBenchmark(MonitorBenchmarkConfig config);
+
+    // Progress lines go to std::wcout.
+    std::vector<MonitorBenchmarkResult> run();
+
+    // Plain text: the settings needed to repeat the run, then one row per
+    // profile.
+    std::wstring renderReport(const std::vector<MonitorBenchmarkResult>& results) const;
+    // Throws std::runtime_error if filePath cannot be written.
+    void saveReport(const std::vector<MonitorBenchmarkResult>& results, const std::wstring& filePath) const;
+
+private:
+    struct ScheduledObject {
+        std::chrono::nanoseconds createAt;
+        std::chrono::nanoseconds lifetime;
+    };
+
+    void buildSchedule();
+    MonitorBenchmarkResult runProfile(const MonitorProfile& profile);
+
+    MonitorBenchmarkConfig config;
+    std::vector<ScheduledObject> schedule;
+};
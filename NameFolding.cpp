@@ -0,0 +1,45 @@
+#include "NameFolding.h"
+#include "NtTypes.h"
+#include <locale>
+#include <stdexcept>
+#include <vector>
+
+#ifdef _WIN32
+extern "C" WCHAR NTAPI RtlUpcaseUnicodeChar(WCHAR SourceCharacter);
+#endif
+
+namespace {
+    std::vector<char16_t> buildUpcaseTable() {
+        std::vector<char16_t> table(0x10000);
+#ifdef _WIN32
+        for (uint32_t c = 0; c < table.size(); c++) {
+            table[c] = static_cast<char16_t>(RtlUpcaseUnicodeChar(static_cast<WCHAR>(c)));
+        }
+#else
+        // A fixed locale rather than the global one, so folding does not
+        // change when the program switches locales.
+        std::locale locale = std::locale::classic();
+        try {
+            locale = std::locale("C.UTF-8");
+        }
+        catch (const std::runtime_error&) {
+        }
+        const auto& ctype = std::use_facet<std::ctype<wchar_t>>(locale);
+        for (uint32_t c = 0; c < table.size(); c++) {
+            // Surrogates are code units, not characters.
+            if (c >= 0xD800 && c <= 0xDFFF) {
+                table[c] = static_cast<char16_t>(c);
+                continue;
+            }
+            uint32_t upper = static_cast<uint32_t>(ctype.toupper(static_cast<wchar_t>(c)));
+            table[c] = static_cast<char16_t>(upper <= 0xFFFF ? upper : c);
+        }
+#endif
+        return table;
+    }
+}
+
+const char16_t* upcaseTable() {
+    static const std::vector<char16_t> table = buildUpcaseTable();
+    return table.data();
+}
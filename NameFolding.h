@@ -0,0 +1,159 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Case-insensitive comparison helpers for Object Manager names, which are
+// matched without regard to case. Each takes wide or UTF-16 names; the two
+// must not be mixed in one call.
+//
+// Folding follows the NT upcase table: one UTF-16 unit maps to one, with
+// no dependence on the process locale. Characters outside the BMP are not
+// folded.
+
+// 65536 entries, built on first use.
+const char16_t* upcaseTable();
+
+inline wchar_t foldChar(wchar_t c) {
+    if (c < 0x80) {
+        return (c >= L'a' && c <= L'z') ? static_cast<wchar_t>(c - (L'a' - L'A')) : c;
+    }
+    uint32_t unit = static_cast<uint32_t>(c);
+    return unit <= 0xFFFF ? static_cast<wchar_t>(upcaseTable()[unit]) : c;
+}
+
+inline char16_t foldChar(char16_t c) {
+    if (c < 0x80) {
+        return (c >= u'a' && c <= u'z') ? static_cast<char16_t>(c - (u'a' - u'A')) : c;
+    }
+    return upcaseTable()[c];
+}
+
+namespace folding {
+    template <typename Char>
+    bool equals(std::basic_string_view<Char> a, std::basic_string_view<Char> b) {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); i++) {
+            if (a[i] != b[i] && foldChar(a[i]) != foldChar(b[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    template <typename Char>
+    int compare(std::basic_string_view<Char> a, std::basic_string_view<Char> b) {
+        size_t length = a.size() < b.size() ? a.size() : b.size();
+        for (size_t i = 0; i < length; i++) {
+            if (a[i] == b[i]) {
+                continue;
+            }
+            Char x = foldChar(a[i]);
+            Char y = foldChar(b[i]);
+            if (x != y) {
+                return x < y ? -1 : 1;
+            }
+        }
+        return a.size() == b.size() ? 0 : (a.size() < b.size() ? -1 : 1);
+    }
+
+    // FNV-1a over the folded characters.
+    template <typename Char>
+    uint64_t hash(std::basic_string_view<Char> text, uint64_t seed) {
+        uint64_t value = seed;
+        for (Char c : text) {
+            value ^= static_cast<uint64_t>(foldChar(c));
+            value *= 1099511628211ULL;
+        }
+        return value;
+    }
+}
+
+// text must hold at least folded.size() characters; folded is already folded.
+inline bool equalsFolded(const wchar_t* text, std::wstring_view folded) {
+    for (size_t i = 0; i < folded.size(); i++) {
+        if (foldChar(text[i]) != folded[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+inline bool equalsIgnoreCase(std::wstring_view a, std::wstring_view b) {
+    return folding::equals(a, b);
+}
+
+inline bool equalsIgnoreCase(std::u16string_view a, std::u16string_view b) {
+    return folding::equals(a, b);
+}
+
+inline int compareIgnoreCase(std::wstring_view a, std::wstring_view b) {
+    return folding::compare(a, b);
+}
+
+inline int compareIgnoreCase(std::u16string_view a, std::u16string_view b) {
+    return folding::compare(a, b);
+}
+
+inline bool startsWithIgnoreCase(std::wstring_view text, std::wstring_view prefix) {
+    return text.size() >= prefix.size() && equalsIgnoreCase(text.substr(0, prefix.size()), prefix);
+}
+
+inline bool startsWithIgnoreCase(std::u16string_view text, std::u16string_view prefix) {
+    return text.size() >= prefix.size() && equalsIgnoreCase(text.substr(0, prefix.size()), prefix);
+}
+
+inline uint64_t hashIgnoreCase(std::wstring_view text, uint64_t seed = 14695981039346656037ULL) {
+    return folding::hash(text, seed);
+}
+
+inline uint64_t hashIgnoreCase(std::u16string_view text, uint64_t seed = 14695981039346656037ULL) {
+    return folding::hash(text, seed);
+}
+
+// FNV-1a over characters that are already folded; equal to hashIgnoreCase
+// of the original name.
+inline uint64_t hashFolded(std::wstring_view folded, uint64_t seed = 14695981039346656037ULL) {
+    uint64_t value = seed;
+    for (wchar_t c : folded) {
+        value ^= static_cast<uint64_t>(c);
+        value *= 1099511628211ULL;
+    }
+    return value;
+}
+
+// A name folded once, with its hash. Equality, ordering, prefix tests and
+// hash lookups on keys are plain ordinal operations, so names compared
+// many times are not folded again on every compare.
+struct FoldedName {
+    std::wstring key;
+    uint64_t hash = 0;
+
+    FoldedName() = default;
+    explicit FoldedName(std::wstring_view name) { assign(name); }
+
+    void assign(std::wstring_view name) {
+        key.resize(name.size());
+        for (size_t i = 0; i < name.size(); i++) {
+            key[i] = foldChar(name[i]);
+        }
+        hash = hashFolded(key);
+    }
+
+    // Whether other is this name or lies under it as a path.
+    bool isPathPrefixOf(const FoldedName& other) const {
+        return other.key.size() >= key.size() && other.key.compare(0, key.size(), key) == 0 &&
+            (other.key.size() == key.size() || key.empty() || key.back() == L'\\' || other.key[key.size()] == L'\\');
+    }
+
+    bool operator==(const FoldedName& other) const { return hash == other.hash && key == other.key; }
+    bool operator!=(const FoldedName& other) const { return !(*this == other); }
+    bool operator<(const FoldedName& other) const { return key < other.key; }
+};
+
+struct FoldedNameHash {
+    size_t operator()(const FoldedName& name) const { return static_cast<size_t>(name.hash); }
+};
@@ -0,0 +1,549 @@
+#include "NamespaceIndex.h"
+#include "Metrics.h"
+#include "NameFolding.h"
+#include "Utf8.h"
+#include <algorithm>
+
+namespace {
+    uint64_t childKey(uint32_t parent, std::u16string_view name) {
+        return hashIgnoreCase(name, 14695981039346656037ULL ^ (static_cast<uint64_t>(parent) * 0x9E3779B97F4A7C15ULL));
+    }
+
+    // Splits off the first path component, skipping separators.
+    std::u16string_view nextComponent(std::u16string_view& path) {
+        size_t start = path.find_first_not_of(u'\\');
+        if (start == std::u16string_view::npos) {
+            path = std::u16string_view();
+            return std::u16string_view();
+        }
+
+        size_t end = path.find(u'\\', start);
+        std::u16string_view component = path.substr(start, end == std::u16string_view::npos ? std::u16string_view::npos : end - start);
+        path = end == std::u16string_view::npos ? std::u16string_view() : path.substr(end);
+        return component;
+    }
+
+    std::u16string toUtf16(std::wstring_view text) {
+        std::u16string converted;
+        appendUtf16(converted, text);
+        return converted;
+    }
+}
+
+NamespaceIndex::NamespaceIndex(NtApi& ntApi) : ntApi(ntApi) {
+    childrenByKey.keyedByParent = true;
+    clearLocked();
+}
+
+uint64_t NamespaceIndex::hashNode(const NodeTable& table, uint32_t node) const {
+    return table.keyedByParent ? childKey(nodes[node].parent, nameOf(node)) : hashIgnoreCase(nameOf(node));
+}
+
+template <typename Visitor>
+void NamespaceIndex::tableProbe(const NodeTable& table, uint64_t hash, Visitor visit) const {
+    if (table.slots.empty()) {
+        return;
+    }
+
+    size_t mask = table.slots.size() - 1;
+    for (size_t i = static_cast<size_t>(hash) & mask; table.slots[i] != EmptySlot; i = (i + 1) & mask) {
+        if (table.slots[i] != DeletedSlot && !visit(table.slots[i])) {
+            return;
+        }
+    }
+}
+
+void NamespaceIndex::tableInsert(NodeTable& table, uint32_t node) {
+    // Grow (and drop tombstones) at 3/4 occupancy.
+    if ((table.used + 1) * 4 > table.slots.size() * 3) {
+        std::vector<uint32_t> old;
+        old.swap(table.slots);
+        size_t capacity = 1024;
+        while (capacity < (liveNodes + 1) * 2) {
+            capacity *= 2;
+        }
+
+        table.slots.assign(capacity, EmptySlot);
+        table.used = 0;
+        for (uint32_t entry : old) {
+            if (entry != EmptySlot && entry != DeletedSlot) {
+                tableInsert(table, entry);
+            }
+        }
+    }
+
+    size_t mask = table.slots.size() - 1;
+    size_t i = static_cast<size_t>(hashNode(table, node)) & mask;
+    while (table.slots[i] != EmptySlot && table.slots[i] != DeletedSlot) {
+        i = (i + 1) & mask;
+    }
+
+    if (table.slots[i] == EmptySlot) {
+        table.used++;
+    }
+    table.slots[i] = node;
+}
+
+void NamespaceIndex::tableErase(NodeTable& table, uint32_t node) {
+    size_t mask = table.slots.size() - 1;
+    for (size_t i = static_cast<size_t>(hashNode(table, node)) & mask; table.slots[i] != EmptySlot; i = (i + 1) & mask) {
+        if (table.slots[i] == node) {
+            table.slots[i] = DeletedSlot;
+            return;
+        }
+    }
+}
+
+void NamespaceIndex::clearLocked() {
+    nodes.clear();
+    freeNodes.clear();
+    directories.clear();
+    freeDirectories.clear();
+    namePool.clear();
+    typeNames.clear();
+    childrenByKey.slots.clear();
+    childrenByKey.used = 0;
+    nodesByName.slots.clear();
+    nodesByName.used = 0;
+    deadNameChars = 0;
+    liveNodes = 0;
+
+    internType(L"Directory");
+    nodes.push_back({ InvalidIndex, 0, 0, 0, 0, true });
+    directories.emplace_back();
+    directories.back().owner = RootNode;
+}
+
+size_t NamespaceIndex::build(const std::wstring& root) {
+    Metrics& metrics = Metrics::instance();
+    ScopedMetricTimer scanTimer(MetricHistogram::DirectoryScan);
+    std::lock_guard<std::mutex> lock(indexLock);
+
+    clearLocked();
+
+    // Directories still to scan, as (index node, absolute path).
+    std::vector<std::pair<uint32_t, std::wstring>> pending;
+    pending.emplace_back(resolveLocked(toUtf16(root), true), root);
+
+    std::vector<BYTE> buffer(64 * 1024);
+    std::u16string name16;
+
+    while (!pending.empty()) {
+        auto [directoryNode, directoryPath] = std::move(pending.back());
+        pending.pop_back();
+
+        HANDLE hDirectory = nullptr;
+        OBJECT_ATTRIBUTES objAttributes = { 0 };
+        UNICODE_STRING uniPath = { 0 };
+
+        RtlInitUnicodeString(&uniPath, directoryPath.c_str());
+        InitializeObjectAttributes(&objAttributes, &uniPath, OBJ_CASE_INSENSITIVE, NULL, NULL);
+
+        NTSTATUS status = ntApi.openDirectoryObject(&hDirectory, DIRECTORY_QUERY, &objAttributes);
+        metrics.ntCall(NT_SUCCESS(status));
+        if (!NT_SUCCESS(status)) {
+            continue;
+        }
+
+        if (directoryPath.empty() || directoryPath.back() != L'\\') {
+            directoryPath += L'\\';
+        }
+
+        ULONG context = 0;
+        ULONG returnLength;
+        BOOLEAN restart = TRUE;
+
+        while (true) {
+            status = ntApi.queryDirectoryObject(hDirectory, buffer.data(), static_cast<ULONG>(buffer.size()),
+                FALSE, restart, &context, &returnLength);
+            metrics.ntCall(NT_SUCCESS(status) || status == STATUS_NO_MORE_ENTRIES);
+
+            if (!NT_SUCCESS(status)) {
+                break;
+            }
+            metrics.add(MetricCounter::BytesBuffered, returnLength);
+
+            POBJECT_DIRECTORY_INFORMATION dirInfo = reinterpret_cast<POBJECT_DIRECTORY_INFORMATION>(buffer.data());
+            while (dirInfo->Name.Length > 0) {
+                std::wstring_view name(dirInfo->Name.Buffer, dirInfo->Name.Length / sizeof(WCHAR));
+                std::wstring_view type(dirInfo->TypeName.Buffer, dirInfo->TypeName.Length / sizeof(WCHAR));
+                metrics.add(MetricCounter::EntriesEnumerated);
+
+                name16.clear();
+                appendUtf16(name16, name);
+                uint32_t node = insertChildLocked(directoryNode, name16, type);
+                if (type == L"Directory" && node != InvalidIndex) {
+                    pending.emplace_back(node, directoryPath + std::wstring(name));
+                }
+
+                dirInfo++;
+            }
+
+            restart = FALSE;
+        }
+
+        ntApi.close(hDirectory);
+    }
+
+    for (uint32_t directory = 0; directory < directories.size(); directory++) {
+        sortChildrenLocked(directory);
+    }
+    nodes.shrink_to_fit();
+    namePool.shrink_to_fit();
+
+    return liveNodes;
+}
+
+void NamespaceIndex::insert(std::wstring_view directory, std::wstring_view name, std::wstring_view type) {
+    std::u16string directory16 = toUtf16(directory);
+    std::u16string name16 = toUtf16(name);
+    std::lock_guard<std::mutex> lock(indexLock);
+    uint32_t parent = resolveLocked(directory16, true);
+    if (parent != InvalidIndex) {
+        insertChildLocked(parent, name16, type);
+    }
+}
+
+void NamespaceIndex::erase(std::wstring_view directory, std::wstring_view name) {
+    std::u16string directory16 = toUtf16(directory);
+    std::u16string name16 = toUtf16(name);
+    std::lock_guard<std::mutex> lock(indexLock);
+    uint32_t parent = resolveLocked(directory16, false);
+    if (parent == InvalidIndex) {
+        return;
+    }
+
+    uint32_t node = findChildLocked(parent, name16);
+    if (node != InvalidIndex) {
+        eraseLocked(node);
+    }
+    compactNamesLocked();
+}
+
+bool NamespaceIndex::lookup(std::wstring_view path, NamespaceEntry& entry) {
+    std::u16string path16 = toUtf16(path);
+    std::lock_guard<std::mutex> lock(indexLock);
+    uint32_t node = resolveLocked(path16, false);
+    if (node == InvalidIndex || node == RootNode) {
+        return false;
+    }
+
+    entry = entryLocked(node);
+    return true;
+}
+
+std::vector<NamespaceEntry> NamespaceIndex::findPrefix(std::wstring_view prefix, size_t limit) {
+    std::vector<NamespaceEntry> results;
+    std::u16string prefix16 = toUtf16(prefix);
+    std::lock_guard<std::mutex> lock(indexLock);
+
+    std::u16string_view query = prefix16;
+    size_t split = query.rfind(u'\\');
+    std::u16string_view directoryPath = split == std::u16string_view::npos ? std::u16string_view() : query.substr(0, split);
+    std::u16string_view partial = split == std::u16string_view::npos ? query : query.substr(split + 1);
+
+    uint32_t parent = resolveLocked(directoryPath, false);
+    if (parent == InvalidIndex || nodes[parent].directory == InvalidIndex) {
+        return results;
+    }
+
+    uint32_t directory = nodes[parent].directory;
+    sortChildrenLocked(directory);
+    const std::vector<uint32_t>& children = directories[directory].children;
+
+    // Children are sorted case-insensitively, so the matches are contiguous.
+    auto first = std::lower_bound(children.begin(), children.end(), partial,
+        [this](uint32_t child, std::u16string_view value) {
+            return compareIgnoreCase(nameOf(child).substr(0, value.size()), value) < 0;
+        });
+
+    for (auto it = first; it != children.end() && results.size() < limit; ++it) {
+        if (!startsWithIgnoreCase(nameOf(*it), partial)) {
+            break;
+        }
+        collectLocked(*it, results, limit);
+    }
+
+    return results;
+}
+
+std::vector<NamespaceEntry> NamespaceIndex::findName(std::wstring_view name, size_t limit) {
+    std::vector<NamespaceEntry> results;
+    std::u16string name16 = toUtf16(name);
+    std::lock_guard<std::mutex> lock(indexLock);
+
+    tableProbe(nodesByName, hashIgnoreCase(std::u16string_view(name16)), [&](uint32_t node) {
+        if (equalsIgnoreCase(nameOf(node), name16)) {
+            results.push_back(entryLocked(node));
+        }
+        return results.size() < limit;
+    });
+
+    std::sort(results.begin(), results.end(), [](const NamespaceEntry& a, const NamespaceEntry& b) {
+        return compareIgnoreCase(a.path, b.path) < 0;
+    });
+    return results;
+}
+
+size_t NamespaceIndex::size() const {
+    std::lock_guard<std::mutex> lock(indexLock);
+    return liveNodes;
+}
+
+size_t NamespaceIndex::memoryUsage() const {
+    std::lock_guard<std::mutex> lock(indexLock);
+
+    size_t bytes = nodes.capacity() * sizeof(Node)
+        + freeNodes.capacity() * sizeof(uint32_t)
+        + directories.capacity() * sizeof(Directory)
+        + namePool.capacity() * sizeof(char16_t)
+        + (childrenByKey.slots.capacity() + nodesByName.slots.capacity()) * sizeof(uint32_t);
+
+    for (const auto& directory : directories) {
+        bytes += (directory.children.capacity() + directory.pending.capacity() + directory.retired.capacity()) * sizeof(uint32_t);
+    }
+    return bytes;
+}
+
+std::u16string_view NamespaceIndex::nameOf(uint32_t node) const {
+    return std::u16string_view(namePool.data() + nodes[node].nameOffset, nodes[node].nameLength);
+}
+
+uint16_t NamespaceIndex::internType(std::wstring_view type) {
+    for (size_t i = 0; i < typeNames.size(); i++) {
+        if (typeNames[i] == type) {
+            return static_cast<uint16_t>(i);
+        }
+    }
+
+    typeNames.emplace_back(type);
+    return static_cast<uint16_t>(typeNames.size() - 1);
+}
+
+uint32_t NamespaceIndex::findChildLocked(uint32_t parent, std::u16string_view name) const {
+    uint32_t found = InvalidIndex;
+    tableProbe(childrenByKey, childKey(parent, name), [&](uint32_t node) {
+        if (nodes[node].parent == parent && equalsIgnoreCase(nameOf(node), name)) {
+            found = node;
+            return false;
+        }
+        return true;
+    });
+    return found;
+}
+
+uint32_t NamespaceIndex::insertChildLocked(uint32_t parent, std::u16string_view name, std::wstring_view type) {
+    if (name.empty() || name.size() > UINT16_MAX || nodes[parent].directory == InvalidIndex) {
+        return InvalidIndex;
+    }
+
+    uint16_t typeIndex = internType(type);
+    bool isDirectory = type == L"Directory";
+
+    uint32_t existing = findChildLocked(parent, name);
+    if (existing != InvalidIndex) {
+        if (nodes[existing].typeIndex == typeIndex) {
+            return existing;
+        }
+        // Same name, new object of a different type: replace it.
+        eraseLocked(existing);
+    }
+
+    uint32_t index;
+    if (!freeNodes.empty()) {
+        index = freeNodes.back();
+        freeNodes.pop_back();
+    }
+    else {
+        index = static_cast<uint32_t>(nodes.size());
+        nodes.emplace_back();
+    }
+
+    Node& node = nodes[index];
+    node.parent = parent;
+    node.nameOffset = static_cast<uint32_t>(namePool.size());
+    node.nameLength = static_cast<uint16_t>(name.size());
+    node.typeIndex = typeIndex;
+    node.directory = InvalidIndex;
+    node.live = true;
+    namePool.insert(namePool.end(), name.begin(), name.end());
+
+    if (isDirectory) {
+        if (!freeDirectories.empty()) {
+            node.directory = freeDirectories.back();
+            freeDirectories.pop_back();
+        }
+        else {
+            node.directory = static_cast<uint32_t>(directories.size());
+            directories.emplace_back();
+        }
+        directories[node.directory].owner = index;
+    }
+
+    directories[nodes[parent].directory].pending.push_back(index);
+
+    liveNodes++;
+    tableInsert(childrenByKey, index);
+    tableInsert(nodesByName, index);
+    return index;
+}
+
+uint32_t NamespaceIndex::resolveLocked(std::u16string_view path, bool create) {
+    uint32_t node = RootNode;
+
+    while (!path.empty()) {
+        std::u16string_view component = nextComponent(path);
+        if (component.empty()) {
+            break;
+        }
+
+        uint32_t child = findChildLocked(node, component);
+        if (child == InvalidIndex) {
+            if (!create) {
+                return InvalidIndex;
+            }
+            child = insertChildLocked(node, component, L"Directory");
+            if (child == InvalidIndex) {
+                return InvalidIndex;
+            }
+        }
+        node = child;
+    }
+
+    return node;
+}
+
+void NamespaceIndex::eraseLocked(uint32_t index) {
+    Node& node = nodes[index];
+    if (!node.live || index == RootNode) {
+        return;
+    }
+
+    if (node.directory != InvalidIndex) {
+        uint32_t directory = node.directory;
+        // Erasing children only marks them dead, so iterating by copy is safe.
+        std::vector<uint32_t> children = directories[directory].children;
+        children.insert(children.end(), directories[directory].pending.begin(), directories[directory].pending.end());
+        for (uint32_t child : children) {
+            if (nodes[child].live && nodes[child].parent == index) {
+                eraseLocked(child);
+            }
+        }
+        // The lists go away with the directory, so its slots are free now.
+        const std::vector<uint32_t>& retired = directories[directory].retired;
+        freeNodes.insert(freeNodes.end(), retired.begin(), retired.end());
+        directories[directory] = Directory();
+        freeDirectories.push_back(directory);
+    }
+
+    tableErase(childrenByKey, index);
+    tableErase(nodesByName, index);
+
+    node.live = false;
+    node.directory = InvalidIndex;
+    deadNameChars += node.nameLength;
+    liveNodes--;
+
+    // The parent's lists still hold the slot; it is freed on their next sort.
+    uint32_t parentDirectory = nodes[node.parent].directory;
+    directories[parentDirectory].retired.push_back(index);
+    if (directories[parentDirectory].retired.size() >= 4096) {
+        sortChildrenLocked(parentDirectory);
+    }
+}
+
+void NamespaceIndex::sortChildrenLocked(uint32_t directory) {
+    Directory& entry = directories[directory];
+    if (entry.pending.empty() && entry.retired.empty()) {
+        return;
+    }
+
+    // Retired slots are not reused before this, so dead means gone.
+    auto isGone = [this](uint32_t child) {
+        return !nodes[child].live;
+    };
+    auto byName = [this](uint32_t a, uint32_t b) {
+        return compareIgnoreCase(nameOf(a), nameOf(b)) < 0;
+    };
+
+    auto& children = entry.children;
+    auto& pending = entry.pending;
+    if (!entry.retired.empty()) {
+        children.erase(std::remove_if(children.begin(), children.end(), isGone), children.end());
+        pending.erase(std::remove_if(pending.begin(), pending.end(), isGone), pending.end());
+        freeNodes.insert(freeNodes.end(), entry.retired.begin(), entry.retired.end());
+        entry.retired.clear();
+        entry.retired.shrink_to_fit();
+    }
+
+    std::sort(pending.begin(), pending.end(), byName);
+    size_t middle = children.size();
+    children.insert(children.end(), pending.begin(), pending.end());
+    std::inplace_merge(children.begin(), children.begin() + middle, children.end(), byName);
+
+    pending.clear();
+    pending.shrink_to_fit();
+}
+
+void NamespaceIndex::collectLocked(uint32_t index, std::vector<NamespaceEntry>& results, size_t limit) {
+    if (results.size() >= limit) {
+        return;
+    }
+
+    results.push_back(entryLocked(index));
+
+    uint32_t directory = nodes[index].directory;
+    if (directory == InvalidIndex) {
+        return;
+    }
+
+    sortChildrenLocked(directory);
+    for (uint32_t child : directories[directory].children) {
+        if (results.size() >= limit) {
+            return;
+        }
+        collectLocked(child, results, limit);
+    }
+}
+
+NamespaceEntry NamespaceIndex::entryLocked(uint32_t index) const {
+    size_t length = 0;
+    for (uint32_t node = index; node != RootNode; node = nodes[node].parent) {
+        length += nodes[node].nameLength + 1;
+    }
+
+    std::u16string path(length, u'\\');
+    size_t position = length;
+    for (uint32_t node = index; node != RootNode; node = nodes[node].parent) {
+        std::u16string_view name = nameOf(node);
+        position -= name.size();
+        std::copy(name.begin(), name.end(), path.begin() + position);
+        position--;
+    }
+
+    NamespaceEntry entry;
+    appendWide(entry.path, path);
+    entry.type = typeNames[nodes[index].typeIndex];
+    return entry;
+}
+
+void NamespaceIndex::compactNamesLocked() {
+    // Rewrite the pool once deleted names make up most of it.
+    if (deadNameChars < 64 * 1024 || deadNameChars * 2 < namePool.size()) {
+        return;
+    }
+
+    std::vector<char16_t> compacted;
+    compacted.reserve(namePool.size() - deadNameChars);
+    for (auto& node : nodes) {
+        if (node.live && node.nameLength > 0) {
+            uint32_t offset = static_cast<uint32_t>(compacted.size());
+            compacted.insert(compacted.end(), namePool.begin() + node.nameOffset,
+                namePool.begin() + node.nameOffset + node.nameLength);
+            node.nameOffset = offset;
+        }
+    }
+
+    namePool.swap(compacted);
+    deadNameChars = 0;
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include "NtApi.h"
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct NamespaceEntry {
+    std::wstring path;
+    std::wstring type;
+};
+
+// In-memory index of the Object Manager namespace. Each node stores one path
+// component and its parent, so every path prefix is stored once; component
+// names share a single UTF-16 character pool. Lookups are case-insensitive.
+//
+// build() fills the index from a recursive scan; insert()/erase() apply the
+// deltas the monitor reports, so the index stays current without rescanning.
+class NamespaceIndex {
+public:
+    explicit NamespaceIndex(NtApi& ntApi = NtApi::system());
+
+    // Replaces the index contents with a recursive scan of root. Returns the
+    // number of objects indexed.
+    size_t build(const std::wstring& root = L"\\");
+
+    void insert(std::wstring_view directory, std::wstring_view name, std::wstring_view type);
+    void erase(std::wstring_view directory, std::wstring_view name);
+
+    // Exact, full-path lookup.
+    bool lookup(std::wstring_view path, NamespaceEntry& entry);
+
+    // Objects whose full path starts with prefix, in sorted order. A prefix
+    // ending in '\' returns everything below that directory.
+    std::vector<NamespaceEntry> findPrefix(std::wstring_view prefix, size_t limit = 1000);
+
+    // Objects with the given name in any directory.
+    std::vector<NamespaceEntry> findName(std::wstring_view name, size_t limit = 1000);
+
+    size_t size() const;
+    bool empty() const { return size() == 0; }
+    size_t memoryUsage() const;
+
+private:
+    static constexpr uint32_t InvalidIndex = UINT32_MAX;
+    static constexpr uint32_t RootNode = 0;
+
+    struct Node {
+        uint32_t parent;
+        uint32_t nameOffset;
+        uint16_t nameLength;
+        uint16_t typeIndex;
+        uint32_t directory;
+        bool live;
+    };
+
+    // children is kept sorted by name. New children go to pending and
+    // deleted ones to retired, so monitor updates are O(1); the next prefix
+    // query sorts pending and merges it in linear time. A retired slot is
+    // only reused once it has been dropped from children and pending, so a
+    // stale entry can never point at a live node.
+    struct Directory {
+        uint32_t owner = InvalidIndex;
+        std::vector<uint32_t> children;
+        std::vector<uint32_t> pending;
+        std::vector<uint32_t> retired;
+    };
+
+    // Open-addressing set of node indices. Keys are not stored: the hash is
+    // recomputed from the node, so each entry costs four bytes.
+    struct NodeTable {
+        std::vector<uint32_t> slots;
+        size_t used = 0;
+        bool keyedByParent = false;
+    };
+
+    static constexpr uint32_t EmptySlot = UINT32_MAX;
+    static constexpr uint32_t DeletedSlot = UINT32_MAX - 1;
+
+    uint64_t hashNode(const NodeTable& table, uint32_t node) const;
+    void tableInsert(NodeTable& table, uint32_t node);
+    void tableErase(NodeTable& table, uint32_t node);
+    template <typename Visitor>
+    void tableProbe(const NodeTable& table, uint64_t hash, Visitor visit) const;
+
+    void clearLocked();
+    std::u16string_view nameOf(uint32_t node) const;
+    uint16_t internType(std::wstring_view type);
+    uint32_t findChildLocked(uint32_t parent, std::u16string_view name) const;
+    uint32_t insertChildLocked(uint32_t parent, std::u16string_view name, std::wstring_view type);
+    uint32_t resolveLocked(std::u16string_view path, bool create);
+    void eraseLocked(uint32_t node);
+    void sortChildrenLocked(uint32_t directory);
+    void collectLocked(uint32_t node, std::vector<NamespaceEntry>& results, size_t limit);
+    NamespaceEntry entryLocked(uint32_t node) const;
+    void compactNamesLocked();
+
+    NtApi& ntApi;
+    mutable std::mutex indexLock;
+    std::vector<Node> nodes;
+    std::vector<uint32_t> freeNodes;
+    std::vector<Directory> directories;
+    std::vector<uint32_t> freeDirectories;
+    std::vector<char16_t> namePool;
+    size_t deadNameChars = 0;
+    size_t liveNodes = 0;
+    std::vector<std::wstring> typeNames;
+    NodeTable childrenByKey;
+    NodeTable nodesByName;
+};
@@ -0,0 +1,19 @@
+#include "NtApi.h"
+
+#ifdef _WIN32
+#include "WinNtApi.h"
+#else
+#include "SimulatedNtApi.h"
+#endif
+
+NtApi& NtApi::system() {
+#ifdef _WIN32
+    static WinNtApi api;
+#else
+    // No kernel to talk to: serve a small simulated namespace instead.
+    static SimulatedNtApi api;
+    static bool populated = (api.populateDefaultNamespace(), true);
+    (void)populated;
+#endif
+    return api;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include "NtTypes.h"
+#include <vector>
+
+// Abstraction over the native calls the explorer, monitor, analyzer and
+// report generator issue. WinNtApi forwards to ntdll; SimulatedNtApi serves
+// an in-memory Object Manager namespace for load testing.
+class NtApi {
+public:
+    virtual ~NtApi() = default;
+
+    virtual NTSTATUS openDirectoryObject(PHANDLE directoryHandle, ACCESS_MASK desiredAccess, POBJECT_ATTRIBUTES objectAttributes) = 0;
+    virtual NTSTATUS queryDirectoryObject(
+        HANDLE directoryHandle,
+        PVOID buffer,
+        ULONG length,
+        BOOLEAN returnSingleEntry,
+        BOOLEAN restartScan,
+        PULONG context,
+        PULONG returnLength
+    ) = 0;
+
+    virtual NTSTATUS openSymbolicLinkObject(PHANDLE linkHandle, ACCESS_MASK desiredAccess, POBJECT_ATTRIBUTES objectAttributes) = 0;
+    virtual NTSTATUS querySymbolicLinkObject(HANDLE linkHandle, PUNICODE_STRING linkTarget, PULONG returnedLength) = 0;
+
+    virtual NTSTATUS openEvent(PHANDLE eventHandle, ACCESS_MASK desiredAccess, POBJECT_ATTRIBUTES objectAttributes) = 0;
+    virtual NTSTATUS openSection(PHANDLE sectionHandle, ACCESS_MASK desiredAccess, POBJECT_ATTRIBUTES objectAttributes) = 0;
+    virtual NTSTATUS openMutant(PHANDLE mutantHandle, ACCESS_MASK desiredAccess, POBJECT_ATTRIBUTES objectAttributes) = 0;
+    virtual NTSTATUS openSemaphore(PHANDLE semaphoreHandle, ACCESS_MASK desiredAccess, POBJECT_ATTRIBUTES objectAttributes) = 0;
+    virtual NTSTATUS openTimer(PHANDLE timerHandle, ACCESS_MASK desiredAccess, POBJECT_ATTRIBUTES objectAttributes) = 0;
+    virtual NTSTATUS openFile(
+        PHANDLE fileHandle,
+        ACCESS_MASK desiredAccess,
+        POBJECT_ATTRIBUTES objectAttributes,
+        PIO_STATUS_BLOCK ioStatusBlock,
+        ULONG shareAccess,
+        ULONG openOptions
+    ) = 0;
+
+    virtual NTSTATUS queryObject(
+        HANDLE handle,
+        OBJECT_INFORMATION_CLASS objectInformationClass,
+        PVOID objectInformation,
+        ULONG objectInformationLength,
+        PULONG returnLength
+    ) = 0;
+
+    virtual NTSTATUS querySystemInformation(
+        SYSTEM_INFORMATION_CLASS systemInformationClass,
+        PVOID systemInformation,
+        ULONG systemInformationLength,
+        PULONG returnLength
+    ) = 0;
+
+    virtual NTSTATUS duplicateObject(
+        HANDLE sourceProcessHandle,
+        HANDLE sourceHandle,
+        HANDLE targetProcessHandle,
+        PHANDLE targetHandle,
+        ACCESS_MASK desiredAccess,
+        ULONG handleAttributes,
+        ULONG options
+    ) = 0;
+
+    virtual NTSTATUS close(HANDLE handle) = 0;
+
+    // Process helpers used by dependency analysis and handle duplication.
+    virtual bool enumerateProcesses(std::vector<DWORD>& processIds) = 0;
+    virtual HANDLE openProcess(ACCESS_MASK desiredAccess, DWORD processId) = 0;
+    virtual HANDLE currentProcess() = 0;
+    virtual DWORD currentProcessId() = 0;
+
+    // Production backend on Windows; a simulated namespace elsewhere.
+    static NtApi& system();
+};
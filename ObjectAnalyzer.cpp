@@ -1,135 +1,201 @@
 #include "ObjectAnalyzer.h"
+#include "DirectoryHandlePool.h"
+#include "Metrics.h"
+#include "NameFolding.h"
+#include "ObjectTypeTable.h"
+#include <algorithm>
 #include <memory>
 #include <queue>
 #include <set>
-#include <stdexcept>    
-#include <winternl.h>
-#include <psapi.h>
-
-// Required for NtQueryDirectoryObject
-#pragma comment(lib, "ntdll.lib")
-
-#define DIRECTORY_QUERY                 0x0001
-#define SYMBOLIC_LINK_QUERY            0x0001
-#define STATUS_NO_MORE_ENTRIES         ((NTSTATUS)0x8000001AL)
-#define STATUS_INFO_LENGTH_MISMATCH    ((NTSTATUS)0xC0000004L)
-#define SystemExtendedHandleInformation 64
-
-
-extern "C" NTSTATUS NTAPI NtOpenDirectoryObject(
-    PHANDLE DirectoryHandle,
-    ACCESS_MASK DesiredAccess,
-    POBJECT_ATTRIBUTES ObjectAttributes
-);
-
-extern "C" NTSTATUS NTAPI NtQueryDirectoryObject(
-    HANDLE DirectoryHandle,
-    PVOID Buffer,
-    ULONG Length,
-    BOOLEAN ReturnSingleEntry,
-    BOOLEAN RestartScan,
-    PULONG Context,
-    PULONG ReturnLength
-);
-
-typedef struct _OBJECT_DIRECTORY_INFORMATION {
-    UNICODE_STRING Name;
-    UNICODE_STRING TypeName;
-} OBJECT_DIRECTORY_INFORMATION, * POBJECT_DIRECTORY_INFORMATION;
-
-typedef struct _SYSTEM_HANDLE_TABLE_ENTRY_INFO_EX {
-    PVOID Object;
-    ULONG_PTR UniqueProcessId;
-    ULONG_PTR HandleValue;
-    ULONG GrantedAccess;
-    USHORT CreatorBackTraceIndex;
-    USHORT ObjectTypeIndex;
-    ULONG HandleAttributes;
-    ULONG Reserved;
-} SYSTEM_HANDLE_TABLE_ENTRY_INFO_EX, * PSYSTEM_HANDLE_TABLE_ENTRY_INFO_EX;
-
-typedef struct _SYSTEM_HANDLE_INFORMATION_EX {
-    ULONG_PTR NumberOfHandles;
-    ULONG_PTR Reserved;
-    SYSTEM_HANDLE_TABLE_ENTRY_INFO_EX Handles[1];
-} SYSTEM_HANDLE_INFORMATION_EX, * PSYSTEM_HANDLE_INFORMATION_EX;
-
-typedef struct _OBJECT_TYPE_INFORMATION {
-    UNICODE_STRING TypeName;
-    ULONG TotalNumberOfHandles;
-    ULONG TotalNumberOfObjects;
-} OBJECT_TYPE_INFORMATION, * POBJECT_TYPE_INFORMATION;
-
-extern "C" {
-    NTSTATUS NTAPI NtDuplicateObject(
-        HANDLE SourceProcessHandle,
-        HANDLE SourceHandle,
-        HANDLE TargetProcessHandle,
-        PHANDLE TargetHandle,
-        ACCESS_MASK DesiredAccess,
-        ULONG HandleAttributes,
-        ULONG Options
-    );
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+    // Objects opened at once per handle table pass.
+    const size_t AnalysisBatchSize = 4096;
+
+    // Objects per task handed to the pool.
+    const size_t AnalysisChunkSize = 64;
+
+    bool cancelled(const std::atomic<bool>* cancel) {
+        return cancel && cancel->load(std::memory_order_relaxed);
+    }
+
+    // Calls visit(index, entry) for every handle table entry that refers to
+    // the same kernel object as handles[index], other than that handle
+    // itself. The handles must have been open when the table was read.
+    template <typename Visitor>
+    void forEachHolder(const HandleTable& table, const std::vector<HANDLE>& handles, DWORD self, Visitor visit) {
+        std::unordered_map<ULONG_PTR, uint32_t> ownHandles;
+        ownHandles.reserve(handles.size());
+        for (size_t i = 0; i < handles.size(); i++) {
+            if (handles[i]) {
+                ownHandles.emplace(reinterpret_cast<ULONG_PTR>(handles[i]), static_cast<uint32_t>(i));
+            }
+        }
+
+        // First pass: the kernel address behind each of our handles.
+        std::unordered_map<PVOID, uint32_t> objectsByAddress;
+        objectsByAddress.reserve(ownHandles.size());
+        for (const auto& entry : table) {
+            if (static_cast<DWORD>(entry.UniqueProcessId) == self) {
+                auto own = ownHandles.find(entry.HandleValue);
+                if (own != ownHandles.end()) {
+                    objectsByAddress.emplace(entry.Object, own->second);
+                }
+            }
+        }
+
+        // Second pass: everyone else's handles to the same objects.
+        for (const auto& entry : table) {
+            auto object = objectsByAddress.find(entry.Object);
+            if (object == objectsByAddress.end()) {
+                continue;
+            }
+            if (static_cast<DWORD>(entry.UniqueProcessId) == self && ownHandles.count(entry.HandleValue)) {
+                continue;
+            }
+            visit(object->second, entry);
+        }
+    }
 }
 
-extern "C" {
-    NTSTATUS NTAPI NtQuerySymbolicLinkObject(
-        HANDLE LinkHandle,
-        PUNICODE_STRING LinkTarget,
-        PULONG ReturnedLength
-    );
+ObjectAnalyzer::ObjectAnalyzer(NtApi& ntApi, ThreadPool& pool) : ntApi(ntApi), pool(pool), inspector(ntApi, pool) {}
+ObjectAnalyzer::~ObjectAnalyzer() {}
+
+NTSTATUS ObjectAnalyzer::analyzeObjectRelations(const std::wstring& objectName) {
+    if (!analysisCallback) {
+        return STATUS_SUCCESS;
+    }
+
+    std::vector<NamespaceEntry> objects;
+    NTSTATUS status = inspector.listDirectory(objectName, objects);
+    if (status == STATUS_OBJECT_TYPE_MISMATCH) {
+        // Not a directory: analyze the object itself.
+        NamespaceEntry entry;
+        entry.path = objectName;
+        analyzeBatch(&entry, 1);
+        return batchResults.front().status;
+    }
+    if (!NT_SUCCESS(status)) {
+        return status;
+    }
+
+    for (size_t begin = 0; begin < objects.size(); begin += AnalysisBatchSize) {
+        analyzeBatch(objects.data() + begin, std::min(AnalysisBatchSize, objects.size() - begin));
+    }
+    return STATUS_SUCCESS;
 }
 
-extern "C" NTSTATUS NTAPI NtOpenSymbolicLinkObject(
-    PHANDLE LinkHandle,
-    ACCESS_MASK DesiredAccess,
-    POBJECT_ATTRIBUTES ObjectAttributes
-);
+void ObjectAnalyzer::analyzeBatch(const NamespaceEntry* objects, size_t count) {
+    batchResults.clear();
+    batchResults.resize(count);
+    std::vector<HANDLE> handles(count, nullptr);
+
+    // Every object stays open until the handle table has been read, so the
+    // table shows which kernel object each of our handles refers to.
+    pool.parallelFor(count, AnalysisChunkSize, [&](size_t begin, size_t end) {
+        std::vector<WCHAR> linkBuffer(MAX_PATH);
+
+        for (size_t i = begin; i < end; i++) {
+            ObjectAnalysis& result = batchResults[i];
+            result.objectName = objects[i].path;
+            result.objectType = objects[i].type;
+
+            result.status = inspector.open(objects[i].path, objects[i].type, handles[i],
+                objects[i].type.empty() ? &result.objectType : nullptr);
+            if (!NT_SUCCESS(result.status)) {
+                handles[i] = nullptr;
+                continue;
+            }
 
-#define NT_SUCCESS(Status) (((NTSTATUS)(Status)) >= 0)
-#define STATUS_INFO_LENGTH_MISMATCH ((NTSTATUS)0xC0000004L)
-#define SystemExtendedHandleInformation 64
+            OBJECT_BASIC_INFORMATION basicInfo = {};
+            ULONG returnLength = 0;
+            result.status = ntApi.queryObject(handles[i], ObjectBasicInformation, &basicInfo, sizeof(basicInfo), &returnLength);
+            Metrics::instance().ntCall(NT_SUCCESS(result.status));
+            if (NT_SUCCESS(result.status)) {
+                result.handleCount = basicInfo.HandleCount > 0 ? basicInfo.HandleCount - 1 : 0;
+                result.referenceCount = basicInfo.PointerCount > 0 ? basicInfo.PointerCount - 1 : 0;
+            }
 
-extern "C" NTSTATUS NTAPI NtOpenSection(
-    PHANDLE SectionHandle,
-    ACCESS_MASK DesiredAccess,
-    POBJECT_ATTRIBUTES ObjectAttributes
-);
+            if (equalsIgnoreCase(result.objectType, L"SymbolicLink")) {
+                inspector.queryLinkTarget(handles[i], linkBuffer, result.linkTarget);
+            }
+        }
+    });
 
-typedef struct _OBJECT_NAME_INFORMATION {
-    UNICODE_STRING Name;
-} OBJECT_NAME_INFORMATION, * POBJECT_NAME_INFORMATION;
+    collectHandleHolders(handles);
 
-ObjectAnalyzer::ObjectAnalyzer() {}
-ObjectAnalyzer::~ObjectAnalyzer() {}
+    for (HANDLE handle : handles) {
+        if (handle) {
+            ntApi.close(handle);
+        }
+    }
+
+    analysisCallback(AnalysisBatch(batchResults.data(), batchResults.size()));
+}
+
+void ObjectAnalyzer::collectHandleHolders(const std::vector<HANDLE>& handles) {
+    batchProcesses.clear();
+    for (auto& result : batchResults) {
+        result.processIds = nullptr;
+        result.processCount = 0;
+    }
+
+    if (!NT_SUCCESS(handleTable.read(ntApi))) {
+        return;
+    }
+
+    std::vector<std::pair<uint32_t, DWORD>> holders;
+    forEachHolder(handleTable, handles, ntApi.currentProcessId(),
+        [&](uint32_t index, const SYSTEM_HANDLE_TABLE_ENTRY_INFO_EX& entry) {
+            holders.emplace_back(index, static_cast<DWORD>(entry.UniqueProcessId));
+            batchResults[index].accessMask |= entry.GrantedAccess;
+        });
 
-std::vector<ObjectDependency> ObjectAnalyzer::buildDependencyGraph(const std::wstring& rootObject) {
+    std::sort(holders.begin(), holders.end());
+    holders.erase(std::unique(holders.begin(), holders.end()), holders.end());
+
+    batchProcesses.reserve(holders.size());
+    for (const auto& [index, owner] : holders) {
+        batchProcesses.push_back(owner);
+    }
+    for (size_t k = 0; k < holders.size(); k++) {
+        ObjectAnalysis& result = batchResults[holders[k].first];
+        if (!result.processIds) {
+            result.processIds = batchProcesses.data() + k;
+        }
+        result.processCount++;
+    }
+}
+
+std::vector<ObjectDependency> ObjectAnalyzer::buildDependencyGraph(const std::wstring& rootObject,
+    const std::atomic<bool>* cancel) {
     std::vector<ObjectDependency> dependencies;
     std::queue<std::wstring> objectQueue;
     std::set<std::wstring> visitedObjects;
-    HANDLE hRootDir = nullptr;
+    Metrics& metrics = Metrics::instance();
 
     bool isDirectory = (rootObject.find(L"\\BaseNamedObjects") != std::wstring::npos) ||
         (rootObject == L"\\");
 
     if (isDirectory) {
-        UNICODE_STRING uniRootPath;
-        OBJECT_ATTRIBUTES objAttributes = { sizeof(OBJECT_ATTRIBUTES) };
-        RtlInitUnicodeString(&uniRootPath, rootObject.c_str());
-        InitializeObjectAttributes(&objAttributes, &uniRootPath, OBJ_CASE_INSENSITIVE, NULL, NULL);
-
-        NTSTATUS status = NtOpenDirectoryObject(&hRootDir, DIRECTORY_QUERY, &objAttributes);
+        DirectoryHandlePool::Lease rootDirectory;
+        NTSTATUS status = DirectoryHandlePool::of(ntApi).acquire(rootObject, rootDirectory);
         if (!NT_SUCCESS(status)) {
             return dependencies;
         }
+        HANDLE hRootDir = rootDirectory.get();
+        // Resolved against the handle table once the directory is read.
+        std::vector<std::wstring> sections;
 
         BYTE buffer[8192];
         ULONG context = 0;
         ULONG returnLength;
         BOOLEAN restart = TRUE;
 
-        while (TRUE) {
-            status = NtQueryDirectoryObject(
+        while (!cancelled(cancel)) {
+            status = ntApi.queryDirectoryObject(
                 hRootDir,
                 buffer,
                 sizeof(buffer),
@@ -138,23 +204,31 @@ std::vector<ObjectDependency> ObjectAnalyzer::buildDependencyGraph(const std::ws
                 &context,
                 &returnLength
             );
+            metrics.ntCall(NT_SUCCESS(status) || status == STATUS_NO_MORE_ENTRIES);
 
             if (!NT_SUCCESS(status) || status == STATUS_NO_MORE_ENTRIES) {
                 break;
             }
+            metrics.add(MetricCounter::BytesBuffered, returnLength);
 
             POBJECT_DIRECTORY_INFORMATION dirInfo =
                 reinterpret_cast<POBJECT_DIRECTORY_INFORMATION>(buffer);
 
-            while (dirInfo->Name.Length != 0) {
-                std::wstring objName(dirInfo->Name.Buffer,
+            while (dirInfo->Name.Length != 0 && !cancelled(cancel)) {
+                std::wstring_view objName(dirInfo->Name.Buffer,
                     dirInfo->Name.Length / sizeof(WCHAR));
-                std::wstring objType(dirInfo->TypeName.Buffer,
+                std::wstring_view objType(dirInfo->TypeName.Buffer,
                     dirInfo->TypeName.Length / sizeof(WCHAR));
+                metrics.add(MetricCounter::EntriesEnumerated);
 
-                std::wstring fullPath = rootObject;
+                // Sized up front, so the path is allocated at most once.
+                size_t pathLength = rootObject.size() + 1 + objName.size();
+                std::wstring fullPath;
+                fullPath.reserve(pathLength);
+                fullPath = rootObject;
                 if (fullPath.back() != L'\\') fullPath += L"\\";
                 fullPath += objName;
+                metrics.stringAllocated(pathLength);
 
                 if (objType == L"SymbolicLink") {
                     ObjectDependency dep;
@@ -167,53 +241,28 @@ std::vector<ObjectDependency> ObjectAnalyzer::buildDependencyGraph(const std::ws
                         OBJ_CASE_INSENSITIVE, NULL, NULL);
 
                     HANDLE hLink;
-                    if (NT_SUCCESS(NtOpenSymbolicLinkObject(&hLink, SYMBOLIC_LINK_QUERY,
-                        &linkAttr))) {
+                    NTSTATUS linkStatus = ntApi.openSymbolicLinkObject(&hLink, SYMBOLIC_LINK_QUERY, &linkAttr);
+                    metrics.ntCall(NT_SUCCESS(linkStatus));
+                    if (NT_SUCCESS(linkStatus)) {
                         UNICODE_STRING target;
                         WCHAR targetBuffer[MAX_PATH];
                         target.Buffer = targetBuffer;
                         target.Length = 0;
                         target.MaximumLength = MAX_PATH * sizeof(WCHAR);
 
-                        if (NT_SUCCESS(NtQuerySymbolicLinkObject(hLink, &target, NULL))) {
+                        NTSTATUS queryStatus = ntApi.querySymbolicLinkObject(hLink, &target, NULL);
+                        metrics.ntCall(NT_SUCCESS(queryStatus));
+                        if (NT_SUCCESS(queryStatus)) {
                             dep.targetObject = std::wstring(target.Buffer,
                                 target.Length / sizeof(WCHAR));
                             dep.dependencyType = L"SymbolicLink";
                             dependencies.push_back(dep);
                         }
-                        NtClose(hLink);
+                        ntApi.close(hLink);
                     }
                 }
                 else if (objType == L"Section") {
-                    HANDLE hProcesses[1024];
-                    ULONG cbNeeded;
-                    if (EnumProcesses((DWORD*)hProcesses, sizeof(hProcesses), &cbNeeded)) {
-                        DWORD numProcesses = cbNeeded / sizeof(DWORD);
-                        for (DWORD i = 0; i < numProcesses; i++) {
-                            if (HANDLE hProcess = OpenProcess(PROCESS_QUERY_INFORMATION,
-                                FALSE, (DWORD)hProcesses[i])) {
-                                HANDLE hSection;
-                                UNICODE_STRING sectionName;
-                                RtlInitUnicodeString(&sectionName, fullPath.c_str());
-                                OBJECT_ATTRIBUTES sectionAttr = { sizeof(OBJECT_ATTRIBUTES) };
-                                InitializeObjectAttributes(&sectionAttr, &sectionName,
-                                    OBJ_CASE_INSENSITIVE, NULL, NULL);
-
-                                
-                                if (NT_SUCCESS(NtOpenSection(&hSection, SECTION_QUERY,
-                                    &sectionAttr))) {
-                                    ObjectDependency dep;
-                                    dep.sourceObject = fullPath;
-                                    dep.targetObject = L"Process:" +
-                                        std::to_wstring((DWORD)hProcesses[i]);
-                                    dep.dependencyType = L"SharedMemory";
-                                    dependencies.push_back(dep);
-                                    NtClose(hSection);
-                                }
-                                CloseHandle(hProcess);
-                            }
-                        }
-                    }
+                    sections.push_back(std::move(fullPath));
                 }
 
                 dirInfo++;
@@ -221,8 +270,8 @@ std::vector<ObjectDependency> ObjectAnalyzer::buildDependencyGraph(const std::ws
             restart = FALSE;
         }
 
-        if (hRootDir) {
-            NtClose(hRootDir);
+        if (!sections.empty() && !cancelled(cancel)) {
+            addSectionHolders(sections, dependencies, cancel);
         }
     }
     else {
@@ -233,19 +282,21 @@ std::vector<ObjectDependency> ObjectAnalyzer::buildDependencyGraph(const std::ws
         InitializeObjectAttributes(&objAttr, &objName, OBJ_CASE_INSENSITIVE, NULL, NULL);
 
         IO_STATUS_BLOCK ioStatusBlock;
-        if (NT_SUCCESS(NtOpenFile(&hObject, FILE_READ_ATTRIBUTES | FILE_READ_DATA,
+        if (NT_SUCCESS(ntApi.openFile(&hObject, FILE_READ_ATTRIBUTES | FILE_READ_DATA,
             &objAttr, &ioStatusBlock, FILE_SHARE_READ, FILE_OPEN_FOR_BACKUP_INTENT))) {
             std::vector<BYTE> buffer(1024 * 1024);
             ULONG returnLength = 0;
 
-            NTSTATUS status = NtQuerySystemInformation(
+            NTSTATUS status = ntApi.querySystemInformation(
                 (SYSTEM_INFORMATION_CLASS)SystemExtendedHandleInformation,
                 buffer.data(),
                 static_cast<ULONG>(buffer.size()),
                 &returnLength
             );
+            metrics.ntCall(NT_SUCCESS(status));
 
             if (NT_SUCCESS(status)) {
+                metrics.add(MetricCounter::BytesBuffered, returnLength);
                 PSYSTEM_HANDLE_INFORMATION_EX handleInfo =
                     reinterpret_cast<PSYSTEM_HANDLE_INFORMATION_EX>(buffer.data());
 
@@ -258,33 +309,72 @@ std::vector<ObjectDependency> ObjectAnalyzer::buildDependencyGraph(const std::ws
                     dependencies.push_back(dep);
                 }
             }
-            NtClose(hObject);
+            ntApi.close(hObject);
         }
     }
 
     return dependencies;
 }
 
-std::map<std::wstring, size_t> ObjectAnalyzer::getTypeStatistics(const std::wstring& targetDirectory) {
-    std::map<std::wstring, size_t> statistics;
-    HANDLE hDirectory = nullptr;
-    UNICODE_STRING uniPath;
-    OBJECT_ATTRIBUTES objAttributes = { sizeof(OBJECT_ATTRIBUTES) };
+void ObjectAnalyzer::addSectionHolders(const std::vector<std::wstring>& sections,
+    std::vector<ObjectDependency>& dependencies, const std::atomic<bool>* cancel) {
+    // Every section stays open until the handle table has been read, so our
+    // own entry gives its kernel address and the other entries at that
+    // address are the processes holding it.
+    std::vector<HANDLE> handles(sections.size(), nullptr);
+    bool anyOpen = false;
+    for (size_t i = 0; i < sections.size() && !cancelled(cancel); i++) {
+        if (NT_SUCCESS(inspector.open(sections[i], L"Section", handles[i]))) {
+            anyOpen = true;
+        }
+        else {
+            handles[i] = nullptr;
+        }
+    }
+
+    HandleTable table;
+    if (anyOpen && !cancelled(cancel) && NT_SUCCESS(table.read(ntApi))) {
+        std::vector<std::pair<uint32_t, DWORD>> holders;
+        forEachHolder(table, handles, ntApi.currentProcessId(),
+            [&](uint32_t index, const SYSTEM_HANDLE_TABLE_ENTRY_INFO_EX& entry) {
+                holders.emplace_back(index, static_cast<DWORD>(entry.UniqueProcessId));
+            });
+        std::sort(holders.begin(), holders.end());
+        holders.erase(std::unique(holders.begin(), holders.end()), holders.end());
+
+        for (const auto& [index, processId] : holders) {
+            ObjectDependency dep;
+            dep.sourceObject = sections[index];
+            dep.targetObject = L"Process:" + std::to_wstring(processId);
+            dep.dependencyType = L"SharedMemory";
+            dependencies.push_back(std::move(dep));
+        }
+    }
+
+    for (HANDLE handle : handles) {
+        if (handle) {
+            ntApi.close(handle);
+        }
+    }
+}
 
-    // Use passed directory path
-    RtlInitUnicodeString(&uniPath, targetDirectory.c_str());
-    InitializeObjectAttributes(&objAttributes, &uniPath, 0, NULL, NULL);
+std::map<std::wstring, size_t> ObjectAnalyzer::getTypeStatistics(const std::wstring& targetDirectory,
+    const std::atomic<bool>* cancel) {
+    std::map<std::wstring, size_t> statistics;
 
-    NTSTATUS status = NtOpenDirectoryObject(&hDirectory, DIRECTORY_QUERY, &objAttributes);
+    DirectoryHandlePool::Lease directory;
+    NTSTATUS status = DirectoryHandlePool::of(ntApi).acquire(targetDirectory, directory);
+    Metrics& metrics = Metrics::instance();
     if (NT_SUCCESS(status)) {
+        HANDLE hDirectory = directory.get();
         const ULONG bufferSize = 8192;
         BYTE buffer[bufferSize];
         ULONG context = 0;
         ULONG returnLength;
         BOOLEAN restart = TRUE;
 
-        while (true) {
-            status = NtQueryDirectoryObject(
+        while (!cancelled(cancel)) {
+            status = ntApi.queryDirectoryObject(
                 hDirectory,
                 buffer,
                 bufferSize,
@@ -293,28 +383,80 @@ std::map<std::wstring, size_t> ObjectAnalyzer::getTypeStatistics(const std::wstr
                 &context,
                 &returnLength
             );
+            metrics.ntCall(NT_SUCCESS(status) || status == STATUS_NO_MORE_ENTRIES);
 
             if (!NT_SUCCESS(status) || status == STATUS_NO_MORE_ENTRIES) {
                 break;
             }
+            metrics.add(MetricCounter::BytesBuffered, returnLength);
 
             POBJECT_DIRECTORY_INFORMATION dirInfo =
                 reinterpret_cast<POBJECT_DIRECTORY_INFORMATION>(buffer);
 
             while (dirInfo->Name.Length != 0) {
+                metrics.add(MetricCounter::EntriesEnumerated);
                 std::wstring typeName(
                     dirInfo->TypeName.Buffer,
                     dirInfo->TypeName.Length / sizeof(WCHAR)
                 );
-                statistics[typeName]++;
+                metrics.stringAllocated(typeName.size());
+                auto [it, inserted] = statistics.try_emplace(std::move(typeName), 0);
+                if (inserted) {
+                    metrics.add(MetricCounter::Allocations);
+                }
+                it->second++;
                 dirInfo++;
             }
 
             restart = FALSE;
         }
+    }
 
-        CloseHandle(hDirectory);
+    return statistics;
+}
+
+std::vector<HandleTypeStatistics> ObjectAnalyzer::getHandleTypeStatistics(DWORD processId) {
+    std::vector<HandleTypeStatistics> statistics;
+
+    // Reloaded rather than cached so the system-wide totals are current;
+    // it is still a single call.
+    auto types = ObjectTypeTable::reload(ntApi);
+    if (!NT_SUCCESS(handleTable.read(ntApi))) {
+        return statistics;
+    }
+
+    std::vector<size_t> counts(std::max<size_t>(types->indexLimit(), 1), 0);
+    for (const auto& entry : handleTable) {
+        if (processId && static_cast<DWORD>(entry.UniqueProcessId) != processId) {
+            continue;
+        }
+        if (entry.ObjectTypeIndex >= counts.size()) {
+            counts.resize(entry.ObjectTypeIndex + 1, 0);
+        }
+        counts[entry.ObjectTypeIndex]++;
+    }
+
+    for (size_t typeIndex = 0; typeIndex < counts.size(); typeIndex++) {
+        const ObjectTypeEntry* type = types->find(static_cast<USHORT>(typeIndex));
+        if (!counts[typeIndex] && !type) {
+            continue;
+        }
+
+        HandleTypeStatistics entry = {};
+        entry.handles = counts[typeIndex];
+        if (type) {
+            entry.typeName = type->name;
+            entry.totalObjects = type->totalObjects;
+            entry.totalHandles = type->totalHandles;
+        }
+        else {
+            entry.typeName = L"Type #" + std::to_wstring(typeIndex);
+        }
+        statistics.push_back(std::move(entry));
     }
 
+    std::stable_sort(statistics.begin(), statistics.end(), [](const HandleTypeStatistics& a, const HandleTypeStatistics& b) {
+        return a.handles > b.handles;
+    });
     return statistics;
 }
@@ -1,6 +1,9 @@
 #pragma once
-#include <windows.h>
-#include <winternl.h>
+#include "HandleResolver.h"
+#include "NtApi.h"
+#include "ObjectInspector.h"
+#include "ThreadPool.h"
+#include <atomic>
 #include <string>
 #include <vector>
 #include <map>
@@ -11,11 +14,13 @@ typedef enum _OBJECT_INFO_CLASS {
     ObjectTypeInfo = 2
 } OBJECT_INFO_CLASS;
 
-struct HandleInfo {
-    DWORD processId;
-    DWORD handleValue;
-    std::wstring objectType;
-    std::wstring objectName;
+struct HandleTypeStatistics {
+    std::wstring typeName;
+    // Handle table entries of this type (in the requested process).
+    size_t handles;
+    // System-wide totals reported by ObjectTypesInformation.
+    ULONG totalObjects;
+    ULONG totalHandles;
 };
 
 struct ObjectDependency {
@@ -24,28 +29,84 @@ struct ObjectDependency {
     std::wstring dependencyType;
 };
 
-using AnalysisCallback = std::function<void(
-    const std::wstring& objectName,
-    const std::wstring& objectType,
-    ULONG handleCount,
-    ULONG referenceCount,
-    const std::vector<std::wstring>& linkedObjects,
-    ACCESS_MASK accessMask
-    )>;
+// Relations of one object as collected by analyzeObjectRelations.
+struct ObjectAnalysis {
+    std::wstring objectName;
+    std::wstring objectType;
+    // Status of opening and querying the object; the rest is zero or empty
+    // when it failed.
+    NTSTATUS status;
+    // Not counting the analyzer's own handle.
+    ULONG handleCount;
+    ULONG referenceCount;
+    // Combined access granted to the handles other processes hold.
+    ACCESS_MASK accessMask;
+    // Target of a symbolic link, empty for other types.
+    std::wstring linkTarget;
+    // Processes holding a handle to the object, sorted. Points into storage
+    // owned by the batch.
+    const DWORD* processIds;
+    size_t processCount;
+};
+
+// A run of results handed to the analysis callback. Only valid for the
+// duration of the call.
+class AnalysisBatch {
+public:
+    AnalysisBatch(const ObjectAnalysis* first, size_t count) : first(first), count(count) {}
+
+    const ObjectAnalysis* begin() const { return first; }
+    const ObjectAnalysis* end() const { return first + count; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const ObjectAnalysis& operator[](size_t index) const { return first[index]; }
+
+private:
+    const ObjectAnalysis* first;
+    size_t count;
+};
+
+using AnalysisCallback = std::function<void(const AnalysisBatch& batch)>;
 
 class ObjectAnalyzer {
 public:
-    ObjectAnalyzer();
+    explicit ObjectAnalyzer(NtApi& ntApi = NtApi::system(), ThreadPool& pool = ThreadPool::shared());
     ~ObjectAnalyzer();
 
-    std::vector<ObjectDependency> buildDependencyGraph(const std::wstring& rootObject);
-    std::map<std::wstring, size_t> getTypeStatistics(const std::wstring& targetDirectory);
+    // Both stop between NT calls once *cancel is set and return what they
+    // have gathered so far.
+    std::vector<ObjectDependency> buildDependencyGraph(const std::wstring& rootObject,
+        const std::atomic<bool>* cancel = nullptr);
+    std::map<std::wstring, size_t> getTypeStatistics(const std::wstring& targetDirectory,
+        const std::atomic<bool>* cancel = nullptr);
+    // Classifies the system handle table (or one process's part of it,
+    // processId 0 meaning all) by ObjectTypeIndex, most handles first.
+    std::vector<HandleTypeStatistics> getHandleTypeStatistics(DWORD processId = 0);
 
     void setAnalysisCallback(AnalysisCallback callback) {
         analysisCallback = callback;
     }
-    void analyzeObjectRelations(const std::wstring& objectName);
+
+    // Analyzes objectName, or every object in it when it is a directory, and
+    // hands the results to the analysis callback in batches. Returns the
+    // status of opening the object or directory.
+    NTSTATUS analyzeObjectRelations(const std::wstring& objectName);
 
 private:
+    void analyzeBatch(const NamespaceEntry* objects, size_t count);
+    void collectHandleHolders(const std::vector<HANDLE>& handles);
+    // Adds a SharedMemory edge from each section to every process holding
+    // a handle to it.
+    void addSectionHolders(const std::vector<std::wstring>& sections,
+        std::vector<ObjectDependency>& dependencies, const std::atomic<bool>* cancel);
+
+    NtApi& ntApi;
+    ThreadPool& pool;
+    ObjectInspector inspector;
     AnalysisCallback analysisCallback;
+
+    // Reused from batch to batch.
+    HandleTable handleTable;
+    std::vector<ObjectAnalysis> batchResults;
+    std::vector<DWORD> batchProcesses;
 };
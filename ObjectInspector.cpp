@@ -0,0 +1,214 @@
+#include "ObjectInspector.h"
+#include "DirectoryHandlePool.h"
+#include "Metrics.h"
+#include "NameFolding.h"
+#include <algorithm>
+
+namespace {
+    // One entry per object type that can be opened by name. The access masks
+    // are the narrowest each type accepts; ObjectBasicInformation needs none.
+    // SymbolicLink comes first: every other open follows a link in the last
+    // path component, so probing them first would report a link as the
+    // type of its target.
+    struct ObjectOpener {
+        const wchar_t* typeName;
+        ACCESS_MASK access;
+        NTSTATUS (NtApi::*open)(PHANDLE, ACCESS_MASK, POBJECT_ATTRIBUTES);
+    };
+
+    const ObjectOpener objectOpeners[] = {
+        { L"SymbolicLink", SYMBOLIC_LINK_QUERY, &NtApi::openSymbolicLinkObject },
+        { L"Event", EVENT_QUERY_STATE, &NtApi::openEvent },
+        { L"Mutant", MUTANT_QUERY_STATE, &NtApi::openMutant },
+        { L"Semaphore", SEMAPHORE_QUERY_STATE, &NtApi::openSemaphore },
+        { L"Timer", TIMER_QUERY_STATE, &NtApi::openTimer },
+        { L"Section", SECTION_QUERY, &NtApi::openSection },
+        { L"Directory", DIRECTORY_QUERY, &NtApi::openDirectoryObject },
+    };
+
+    const ObjectOpener* findOpener(std::wstring_view type) {
+        for (const auto& opener : objectOpeners) {
+            if (equalsIgnoreCase(type, opener.typeName)) {
+                return &opener;
+            }
+        }
+        return nullptr;
+    }
+
+    // Objects per task handed to the pool.
+    const size_t BatchChunkSize = 64;
+}
+
+ObjectInspector::ObjectInspector(NtApi& ntApi, ThreadPool& pool) : ntApi(ntApi), pool(pool) {
+}
+
+bool ObjectInspector::isSupportedType(std::wstring_view type) {
+    return findOpener(type) != nullptr;
+}
+
+NTSTATUS ObjectInspector::open(const std::wstring& path, std::wstring_view type, HANDLE& handle, std::wstring* resolvedType) {
+    UNICODE_STRING uniPath;
+    OBJECT_ATTRIBUTES objAttributes;
+
+    RtlInitUnicodeString(&uniPath, path.c_str());
+    InitializeObjectAttributes(&objAttributes, &uniPath, OBJ_CASE_INSENSITIVE, NULL, NULL);
+
+    Metrics& metrics = Metrics::instance();
+    handle = nullptr;
+
+    if (!type.empty()) {
+        const ObjectOpener* opener = findOpener(type);
+        if (!opener) {
+            return STATUS_OBJECT_TYPE_MISMATCH;
+        }
+
+        NTSTATUS status = (ntApi.*opener->open)(&handle, opener->access, &objAttributes);
+        metrics.ntCall(NT_SUCCESS(status));
+        if (NT_SUCCESS(status) && resolvedType) {
+            *resolvedType = opener->typeName;
+        }
+        return status;
+    }
+
+    // Unknown type: a wrong opener fails with STATUS_OBJECT_TYPE_MISMATCH,
+    // anything else (success, not found, access denied) is the answer.
+    NTSTATUS status = STATUS_OBJECT_TYPE_MISMATCH;
+    for (const auto& opener : objectOpeners) {
+        status = (ntApi.*opener.open)(&handle, opener.access, &objAttributes);
+        metrics.ntCall(NT_SUCCESS(status));
+
+        if (status != STATUS_OBJECT_TYPE_MISMATCH) {
+            if (NT_SUCCESS(status) && resolvedType) {
+                *resolvedType = opener.typeName;
+            }
+            break;
+        }
+    }
+    return status;
+}
+
+ObjectInfoResult ObjectInspector::queryBasicInformation(const std::wstring& path, std::wstring_view type,
+    std::wstring* resolvedType) {
+    ObjectInfoResult result = {};
+
+    HANDLE handle;
+    result.status = open(path, type, handle, resolvedType);
+    if (!NT_SUCCESS(result.status)) {
+        return result;
+    }
+
+    ULONG returnLength = 0;
+    result.status = ntApi.queryObject(handle, ObjectBasicInformation, &result.basicInfo,
+        sizeof(result.basicInfo), &returnLength);
+    Metrics::instance().ntCall(NT_SUCCESS(result.status));
+
+    ntApi.close(handle);
+    return result;
+}
+
+std::vector<ObjectInfoResult> ObjectInspector::queryBasicInformation(const std::vector<NamespaceEntry>& objects) {
+    ScopedMetricTimer batchTimer(MetricHistogram::ObjectInfoBatch);
+    std::vector<ObjectInfoResult> results(objects.size());
+
+    pool.parallelFor(objects.size(), BatchChunkSize, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            results[i] = queryBasicInformation(objects[i].path, objects[i].type);
+        }
+    });
+
+    return results;
+}
+
+NTSTATUS ObjectInspector::queryLinkTarget(HANDLE link, std::vector<WCHAR>& buffer, std::wstring& target) {
+    if (buffer.empty()) {
+        buffer.resize(MAX_PATH);
+    }
+
+    NTSTATUS status = STATUS_BUFFER_TOO_SMALL;
+    for (int attempt = 0; attempt < 3; attempt++) {
+        UNICODE_STRING text;
+        text.Buffer = buffer.data();
+        text.Length = 0;
+        text.MaximumLength = static_cast<USHORT>(std::min<size_t>(buffer.size() * sizeof(WCHAR), 0xFFFE));
+
+        ULONG returnedLength = 0;
+        status = ntApi.querySymbolicLinkObject(link, &text, &returnedLength);
+        Metrics::instance().ntCall(NT_SUCCESS(status));
+        if (NT_SUCCESS(status)) {
+            target.assign(text.Buffer, text.Length / sizeof(WCHAR));
+            break;
+        }
+        if (status != STATUS_BUFFER_TOO_SMALL || returnedLength <= text.MaximumLength) {
+            break;
+        }
+        buffer.resize(returnedLength / sizeof(WCHAR) + 1);
+    }
+    return status;
+}
+
+NTSTATUS ObjectInspector::listDirectory(const std::wstring& path, std::vector<NamespaceEntry>& objects) {
+    objects.clear();
+
+    Metrics& metrics = Metrics::instance();
+    DirectoryHandlePool::Lease directory;
+    NTSTATUS status = DirectoryHandlePool::of(ntApi).acquire(path, directory);
+    if (!NT_SUCCESS(status)) {
+        return status;
+    }
+    HANDLE hDirectory = directory.get();
+
+    std::wstring prefix = path;
+    if (prefix.empty() || prefix.back() != L'\\') {
+        prefix += L'\\';
+    }
+
+    std::vector<BYTE> buffer(64 * 1024);
+    ULONG context = 0;
+    ULONG returnLength;
+    BOOLEAN restart = TRUE;
+
+    while (true) {
+        status = ntApi.queryDirectoryObject(hDirectory, buffer.data(), static_cast<ULONG>(buffer.size()),
+            FALSE, restart, &context, &returnLength);
+        metrics.ntCall(NT_SUCCESS(status) || status == STATUS_NO_MORE_ENTRIES);
+
+        if (!NT_SUCCESS(status)) {
+            break;
+        }
+        metrics.add(MetricCounter::BytesBuffered, returnLength);
+
+        POBJECT_DIRECTORY_INFORMATION dirInfo = reinterpret_cast<POBJECT_DIRECTORY_INFORMATION>(buffer.data());
+        while (dirInfo->Name.Length > 0) {
+            NamespaceEntry entry;
+            size_t pathLength = prefix.size() + dirInfo->Name.Length / sizeof(WCHAR);
+            entry.path.reserve(pathLength);
+            entry.path = prefix;
+            entry.path.append(dirInfo->Name.Buffer, dirInfo->Name.Length / sizeof(WCHAR));
+            entry.type.assign(dirInfo->TypeName.Buffer, dirInfo->TypeName.Length / sizeof(WCHAR));
+            if (objects.size() == objects.capacity()) {
+                metrics.add(MetricCounter::Allocations);
+            }
+            objects.push_back(std::move(entry));
+
+            metrics.add(MetricCounter::EntriesEnumerated);
+            metrics.stringAllocated(pathLength);
+            metrics.stringAllocated(dirInfo->TypeName.Length / sizeof(WCHAR));
+            dirInfo++;
+        }
+
+        restart = FALSE;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS ObjectInspector::queryDirectory(const std::wstring& path, std::vector<NamespaceEntry>& objects,
+    std::vector<ObjectInfoResult>& results) {
+    results.clear();
+
+    NTSTATUS status = listDirectory(path, objects);
+    if (NT_SUCCESS(status)) {
+        results = queryBasicInformation(objects);
+    }
+    return status;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "NamespaceIndex.h"
+#include "NtApi.h"
+#include "ThreadPool.h"
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct ObjectInfoResult {
+    NTSTATUS status;
+    OBJECT_BASIC_INFORMATION basicInfo;
+};
+
+// Opens objects with the NtOpen* routine that matches their type and queries
+// OBJECT_BASIC_INFORMATION, one at a time or in batches spread over a
+// worker pool.
+class ObjectInspector {
+public:
+    explicit ObjectInspector(NtApi& ntApi = NtApi::system(), ThreadPool& pool = ThreadPool::shared());
+
+    // Opens path with the least access its type needs. With an empty type
+    // every known opener is tried until one accepts the object; the type
+    // found is stored in resolvedType when given.
+    NTSTATUS open(const std::wstring& path, std::wstring_view type, HANDLE& handle, std::wstring* resolvedType = nullptr);
+
+    ObjectInfoResult queryBasicInformation(const std::wstring& path, std::wstring_view type = {},
+        std::wstring* resolvedType = nullptr);
+
+    // results[i] belongs to objects[i].
+    std::vector<ObjectInfoResult> queryBasicInformation(const std::vector<NamespaceEntry>& objects);
+
+    // Reads the target of an open symbolic link, growing buffer as needed.
+    NTSTATUS queryLinkTarget(HANDLE link, std::vector<WCHAR>& buffer, std::wstring& target);
+
+    // Lists path (non-recursively) into objects. Returns the status of
+    // opening the directory.
+    NTSTATUS listDirectory(const std::wstring& path, std::vector<NamespaceEntry>& objects);
+
+    // Lists path (non-recursively) into objects and queries all of them.
+    // Returns the status of opening the directory.
+    NTSTATUS queryDirectory(const std::wstring& path, std::vector<NamespaceEntry>& objects,
+        std::vector<ObjectInfoResult>& results);
+
+    static bool isSupportedType(std::wstring_view type);
+
+private:
+    NtApi& ntApi;
+    ThreadPool& pool;
+};
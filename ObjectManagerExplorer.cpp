@@ -1,335 +1,263 @@
 #include "ObjectManagerExplorer.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <cwchar>
 #include <iostream>
+#include <memory>
 #include <vector>
-#include <shlobj.h> 
 #include <thread>
-#pragma comment(lib, "shell32.lib")
-
-#pragma comment(lib, "ntdll.lib")
-
-extern "C" NTSTATUS NTAPI RtlGetLastNtStatus(void);
-
-// Structure definitions
-typedef struct _OBJECT_BASIC_INFORMATION {
-    ULONG Attributes;
-    ACCESS_MASK DesiredAccess;
-    ULONG HandleCount;
-    ULONG PointerCount;
-    ULONG PagedPoolUsage;
-    ULONG NonPagedPoolUsage;
-    ULONG Reserved[3];
-    ULONG NameInformationLength;
-    ULONG TypeInformationLength;
-    ULONG SecurityDescriptorLength;
-    LARGE_INTEGER CreationTime;
-} OBJECT_BASIC_INFORMATION, * POBJECT_BASIC_INFORMATION;
-
-typedef struct _OBJECT_DIRECTORY_INFORMATION {
-    UNICODE_STRING Name;
-    UNICODE_STRING TypeName;
-} OBJECT_DIRECTORY_INFORMATION, * POBJECT_DIRECTORY_INFORMATION;
-
-// NT API function declarations
-extern "C" {
-    NTSTATUS NTAPI NtOpenDirectoryObject(
-        OUT PHANDLE DirectoryHandle,
-        IN ACCESS_MASK DesiredAccess,
-        IN POBJECT_ATTRIBUTES ObjectAttributes
-    );
-
-    NTSTATUS NTAPI NtQueryDirectoryObject(
-        IN HANDLE DirectoryHandle,
-        OUT PVOID Buffer,
-        IN ULONG Length,
-        IN BOOLEAN ReturnSingleEntry,
-        IN BOOLEAN RestartScan,
-        IN OUT PULONG Context,
-        OUT PULONG ReturnLength OPTIONAL
-    );
-
-    NTSTATUS NTAPI NtOpenEvent(
-        OUT PHANDLE EventHandle,
-        IN ACCESS_MASK DesiredAccess,
-        IN POBJECT_ATTRIBUTES ObjectAttributes
-    );
-
-    NTSTATUS NTAPI NtQueryObject(
-        IN HANDLE Handle OPTIONAL,
-        IN OBJECT_INFORMATION_CLASS ObjectInformationClass,
-        OUT PVOID ObjectInformation OPTIONAL,
-        IN ULONG ObjectInformationLength,
-        OUT PULONG ReturnLength OPTIONAL
-    );
-}
-
-#define DIRECTORY_QUERY 0x0001
-#define STATUS_NO_MORE_ENTRIES ((NTSTATUS)0x8000001A)
-#define EVENT_QUERY_STATE 0x0001
-
-ObjectManagerExplorer::ObjectManagerExplorer() {}
-ObjectManagerExplorer::~ObjectManagerExplorer() {}
-
-std::wstring ObjectManagerExplorer::getErrorMessage(DWORD errorCode) {
-    LPWSTR errorText = nullptr;
-    FormatMessageW(
-        FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_IGNORE_INSERTS,
-        nullptr,
-        errorCode,
-        MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
-        (LPWSTR)&errorText,
-        0,
-        nullptr
-    );
-
-    std::wstring errorMsg = errorText ? errorText : L"Unknown error";
-    LocalFree(errorText);
-    return errorMsg;
-}
-
-typedef BOOL(WINAPI* LPFN_ISUSERANADMIN)(void);
-BOOL IsUserAnAdminWrapper() {
-    LPFN_ISUSERANADMIN lpfnIsUserAnAdmin = (LPFN_ISUSERANADMIN)GetProcAddress(
-        GetModuleHandle(L"shell32.dll"),
-        "IsUserAnAdmin");
-
-    if (lpfnIsUserAnAdmin == NULL)
-        return FALSE;
 
-    return lpfnIsUserAnAdmin();
+ObjectManagerExplorer::ObjectManagerExplorer(NtApi& ntApi) : ntApi(ntApi), inspector(ntApi) {
+    // The privilege check is made once here rather than on every failure.
+    processPrivileges();
 }
+ObjectManagerExplorer::~ObjectManagerExplorer() {}
 
-
-void ObjectManagerExplorer::logDetailedError(const std::wstring& operation, const std::wstring& path) {
-    DWORD error = GetLastError();
-    LPWSTR messageBuffer = nullptr;
-
-    FormatMessageW(
-        FORMAT_MESSAGE_ALLOCATE_BUFFER |
-        FORMAT_MESSAGE_FROM_SYSTEM |
-        FORMAT_MESSAGE_IGNORE_INSERTS,
-        NULL,
-        error,
-        MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
-        (LPWSTR)&messageBuffer,
-        0, NULL
-    );
-
+void ObjectManagerExplorer::logDetailedError(const std::wstring& operation, const std::wstring& path, NTSTATUS status) {
     std::wcerr << L"Operation: " << operation
         << L"\nPath: " << path
-        << L"\nError Code: " << error
-        << L"\nNtStatus: 0x" << std::hex << RtlGetLastNtStatus()
-        << L"\nDetailed Error: " << (messageBuffer ? messageBuffer : L"Unknown error")
-        << L"\nProcess Privileges: " << (IsUserAnAdmin() ? L"Admin" : L"Non-Admin")
+        << L"\nNtStatus: 0x" << std::hex << static_cast<ULONG>(status) << std::dec
+        << L"\nDetailed Error: " << statusMessage(status)
+        << L"\nProcess Privileges: " << processPrivileges()
         << std::endl;
-
-    if (messageBuffer) {
-        LocalFree(messageBuffer);
-    }
 }
 
-
-
-HANDLE ObjectManagerExplorer::safeOpenDirectory(const std::wstring& path) {
-    HANDLE hDirectory = nullptr;
-    OBJECT_ATTRIBUTES objAttributes = { sizeof(OBJECT_ATTRIBUTES) };
-    UNICODE_STRING uniPath;
-
-    // Normalize path
-    std::wstring normalizedPath = path;
-    if (!normalizedPath.empty() && normalizedPath.back() == L'\\') {
-        normalizedPath.pop_back();
+void ObjectManagerExplorer::exploreNamespace(const std::wstring& path, bool recursive, const std::wstring& query,
+    OutputSink* output) {
+    ObjectQuery compiled = ObjectQuery::compile(query);
+    std::unique_ptr<OutputSink> console;
+    if (!output) {
+        console = OutputSink::console();
+        output = console.get();
     }
 
-    RtlInitUnicodeString(&uniPath, normalizedPath.c_str());
-    InitializeObjectAttributes(&objAttributes, &uniPath, OBJ_CASE_INSENSITIVE, NULL, NULL);
+    output->writeText(L"Exploring namespace at: " + path + L"\n");
+    listObjects(path, compiled, recursive, output);
+}
 
-    NTSTATUS status = NtOpenDirectoryObject(&hDirectory, DIRECTORY_QUERY, &objAttributes);
+void ObjectManagerExplorer::listObjects(const std::wstring& path, const std::wstring& filterType, bool recursive) {
+    listObjects(path, ObjectQuery::ofType(filterType), recursive);
+}
 
-    if (!NT_SUCCESS(status)) {
-        logDetailedError(L"NtOpenDirectoryObject", normalizedPath);
-        SetLastError(RtlNtStatusToDosError(status));
-        return nullptr;
+void ObjectManagerExplorer::listObjects(const std::wstring& path, const ObjectQuery& query, bool recursive,
+    OutputSink* output) {
+    std::unique_ptr<OutputSink> console;
+    if (!output) {
+        console = OutputSink::console();
+        output = console.get();
     }
-
-    return hDirectory;
+    walkNamespace(path, query, recursive, true, nullptr, output);
 }
 
-
-void ObjectManagerExplorer::exploreNamespace(const std::wstring& path, bool recursive) {
-    std::wcout << L"Exploring namespace at: " << path.c_str() << std::endl;
-    listObjects(path, L"", recursive);
+void ObjectManagerExplorer::collectObjects(const std::wstring& path, OutputSink& output, const std::atomic<bool>* cancel) {
+    walkNamespace(path, ObjectQuery(), true, false, cancel, &output);
 }
 
-void ObjectManagerExplorer::listObjects(const std::wstring& path, const std::wstring& filterType, bool recursive) {
-    HANDLE hDirectory = nullptr;
-    OBJECT_ATTRIBUTES objAttributes = { sizeof(OBJECT_ATTRIBUTES) };
-    UNICODE_STRING uniPath;
-
-    try {
-        RtlInitUnicodeString(&uniPath, path.c_str());
-        InitializeObjectAttributes(&objAttributes, &uniPath, OBJ_CASE_INSENSITIVE, NULL, NULL);
+void ObjectManagerExplorer::walkNamespace(const std::wstring& path, const ObjectQuery& query, bool recursive,
+    bool printableOnly, const std::atomic<bool>* cancel, OutputSink* output) {
+    auto cancelled = [cancel] { return cancel && cancel->load(std::memory_order_relaxed); };
 
-        NTSTATUS status = NtOpenDirectoryObject(&hDirectory, DIRECTORY_QUERY, &objAttributes);
-        if (!NT_SUCCESS(status)) {
-            std::wcerr << L"Failed to open directory: " << path << std::endl;
-            return;
-        }
+    ScopedMetricTimer scanTimer(MetricHistogram::DirectoryScan);
+    const int maxDepth = query.maxDepth();
 
-        std::vector<BYTE> buffer(8192);
-        ULONG context = 0;
-        ULONG returnLength;
-        BOOLEAN restart = TRUE;
-
-        while (true) {
-            status = NtQueryDirectoryObject(
-                hDirectory,
-                buffer.data(),
-                static_cast<ULONG>(buffer.size()),
-                FALSE,
-                restart,
-                &context,
-                &returnLength
-            );
-
-            if (status == STATUS_NO_MORE_ENTRIES) {
-                break;
+    try {
+        scanArena.reset();
+
+        // Directories still to visit. Subdirectories are queued after their
+        // parent has been read, so only one directory handle is open at a time.
+        // Depth counts the levels descended below path.
+        std::pmr::vector<std::pair<std::wstring_view, int>> pending(&scanArena);
+        pending.emplace_back(scanArena.copy(path), 0);
+
+        std::pmr::wstring fullPath(&scanArena);
+        DirectoryEnumerator directory(ntApi, 8192);
+
+        while (!pending.empty() && !cancelled()) {
+            auto [directoryPath, depth] = pending.back();
+            pending.pop_back();
+            size_t firstChild = pending.size();
+
+            fullPath.assign(directoryPath);
+            bool opened = false;
+            if (!openFailures.knownDenied(fullPath)) {
+                NTSTATUS status = directory.open(fullPath);
+                opened = NT_SUCCESS(status);
+                if (!opened) {
+                    openFailures.recordFailure(fullPath, status);
+                }
+            }
+            if (!opened) {
+                if (depth == 0) {
+                    std::wcerr << L"Failed to open directory: " << path << std::endl;
+                }
+                continue;
             }
 
-            POBJECT_DIRECTORY_INFORMATION dirInfo = reinterpret_cast<POBJECT_DIRECTORY_INFORMATION>(buffer.data());
-
-            while (dirInfo->Name.Length > 0) {
-                std::wstring objName(dirInfo->Name.Buffer, dirInfo->Name.Length / sizeof(WCHAR));
-                std::wstring objType(dirInfo->TypeName.Buffer, dirInfo->TypeName.Length / sizeof(WCHAR));
+            if (fullPath.empty() || fullPath.back() != L'\\') fullPath += L'\\';
+            const size_t prefixLength = fullPath.size();
 
-                if (filterType.empty() || objType == filterType) {
-                    std::wstring fullPath = path;
-                    if (fullPath.back() != L'\\') fullPath += L'\\';
-                    fullPath += objName;
+            while (!cancelled()) {
+                const OBJECT_DIRECTORY_INFORMATION* entry = directory.next();
+                if (!entry) {
+                    break;
+                }
+                // Skip problematic objects containing certain characters
+                if (printableOnly && !ObjectQuery::isPrintableName(entry->Name)) {
+                    continue;
+                }
 
-                    // Skip problematic objects containing certain characters
-                    if (objName.find(L":") == std::wstring::npos &&
-                        objName.find(L"/") == std::wstring::npos &&
-                        objName.find(L"\\") == std::wstring::npos &&
-                        objName.length() < 260) { // MAX_PATH
+                std::wstring_view objName = DirectoryEnumerator::nameOf(*entry);
+                std::wstring_view objType = DirectoryEnumerator::typeOf(*entry);
 
-                        std::wcout << L"Object: " << fullPath << L", Type: " << objType << std::endl;
-                    }
+                if (query.matches(entry->Name, entry->TypeName)) {
+                    fullPath.resize(prefixLength);
+                    fullPath += objName;
+                    output->writeObject(fullPath, objType);
                 }
 
-                dirInfo++;
+                if (recursive && objType == L"Directory" && (maxDepth == 0 || depth < maxDepth)) {
+                    fullPath.resize(prefixLength);
+                    fullPath += objName;
+                    pending.emplace_back(scanArena.copy(fullPath), depth + 1);
+                }
             }
 
-            restart = FALSE;
-        }
+            directory.close();
 
+            // Visit subdirectories in enumeration order.
+            std::reverse(pending.begin() + firstChild, pending.end());
+        }
     }
     catch (...) {
         std::wcerr << L"Error processing objects" << std::endl;
     }
 
-    if (hDirectory) {
-        NtClose(hDirectory);
+    // Released now rather than at the next walk.
+    scanArena.reset();
+    output->flush();
+    openFailures.flushSummary();
+}
+
+bool ObjectManagerExplorer::findObject(const std::wstring& path, const ObjectQuery& query, NamespaceEntry* found) {
+    if (openFailures.knownDenied(path)) {
+        return false;
+    }
+    DirectoryEnumerator directory(ntApi, path);
+    if (!directory.isOpen()) {
+        openFailures.recordFailure(path, directory.status());
+        return false;
+    }
+
+    for (const OBJECT_DIRECTORY_INFORMATION& entry : directory) {
+        if (!ObjectQuery::isPrintableName(entry.Name) || !query.matches(entry.Name, entry.TypeName)) {
+            continue;
+        }
+        if (found) {
+            found->path = path;
+            if (found->path.empty() || found->path.back() != L'\\') found->path += L'\\';
+            found->path += DirectoryEnumerator::nameOf(entry);
+            found->type.assign(DirectoryEnumerator::typeOf(entry));
+        }
+        return true;
     }
+    return false;
 }
 
-void ObjectManagerExplorer::displayObjectInfo(const std::wstring& objectName) {
-    HANDLE objectHandle;
-    UNICODE_STRING unicodeObjectName;
-    OBJECT_ATTRIBUTES objAttributes;
+bool ObjectManagerExplorer::listPage(const std::wstring& path, const ObjectQuery& query, DirectoryCursor& cursor,
+    size_t pageSize, OutputSink* output) {
+    std::unique_ptr<OutputSink> console;
+    if (!output) {
+        console = OutputSink::console();
+        output = console.get();
+    }
 
-    RtlInitUnicodeString(&unicodeObjectName, objectName.c_str());
-    InitializeObjectAttributes(&objAttributes, &unicodeObjectName, OBJ_CASE_INSENSITIVE, NULL, NULL);
+    if (openFailures.knownDenied(path)) {
+        std::wcerr << L"Failed to open directory: " << path << std::endl;
+        return false;
+    }
+    DirectoryEnumerator directory(ntApi, path, 8192);
+    if (!directory.isOpen()) {
+        openFailures.recordFailure(path, directory.status());
+        std::wcerr << L"Failed to open directory: " << path << std::endl;
+        return false;
+    }
+    directory.seek(cursor);
 
-    NTSTATUS status = NtOpenEvent(&objectHandle, EVENT_QUERY_STATE, &objAttributes);
-    if (!NT_SUCCESS(status)) {
-        std::wcerr << L"Failed to open object: " << objectName.c_str() << std::endl;
-        return;
+    std::wstring fullPath = path;
+    if (fullPath.empty() || fullPath.back() != L'\\') fullPath += L'\\';
+    const size_t prefixLength = fullPath.size();
+
+    size_t written = 0;
+    while (written < pageSize) {
+        const OBJECT_DIRECTORY_INFORMATION* entry = directory.next();
+        if (!entry) {
+            break;
+        }
+        if (!ObjectQuery::isPrintableName(entry->Name) || !query.matches(entry->Name, entry->TypeName)) {
+            continue;
+        }
+        fullPath.resize(prefixLength);
+        fullPath += DirectoryEnumerator::nameOf(*entry);
+        output->writeObject(fullPath, DirectoryEnumerator::typeOf(*entry));
+        written++;
     }
 
-    OBJECT_BASIC_INFORMATION objBasicInfo;
-    ULONG returnLength;
-    status = NtQueryObject(
-        objectHandle,
-        ObjectBasicInformation,
-        &objBasicInfo,
-        sizeof(objBasicInfo),
-        &returnLength
-    );
+    output->flush();
+    cursor = directory.cursor();
+    return directory.hasMore();
+}
 
-    if (!NT_SUCCESS(status)) {
-        std::wcerr << L"Failed to query object information." << std::endl;
-        NtClose(objectHandle);
+void ObjectManagerExplorer::displayObjectInfo(const std::wstring& objectName) {
+    std::wstring objectType;
+    ObjectInfoResult result = inspector.queryBasicInformation(objectName, {}, &objectType);
+
+    if (!NT_SUCCESS(result.status)) {
+        if (objectType.empty()) {
+            std::wcerr << L"Failed to open object: " << objectName.c_str() << std::endl;
+        }
+        else {
+            std::wcerr << L"Failed to query object information." << std::endl;
+        }
         return;
     }
 
+    const OBJECT_BASIC_INFORMATION& objBasicInfo = result.basicInfo;
     std::wcout << L"Object Information for: " << objectName.c_str() << std::endl
+        << L"  Type: " << objectType << std::endl
         << L"  Handle Count: " << objBasicInfo.HandleCount << std::endl
         << L"  Pointer Count: " << objBasicInfo.PointerCount << std::endl
         << L"  Paged Pool Usage: " << objBasicInfo.PagedPoolUsage << std::endl
         << L"  Non-Paged Pool Usage: " << objBasicInfo.NonPagedPoolUsage << std::endl;
-
-    NtClose(objectHandle);
 }
 
-std::vector<std::pair<std::wstring, std::wstring>> ObjectManagerExplorer::getObjectNames(
-    const std::wstring& path,
-    const std::wstring& filterType
-) {
-    std::vector<std::pair<std::wstring, std::wstring>> objectNames;
-
-    HANDLE dirHandle;
-    UNICODE_STRING unicodePath;
-    OBJECT_ATTRIBUTES objAttributes;
-
-    RtlInitUnicodeString(&unicodePath, path.c_str());
-    InitializeObjectAttributes(&objAttributes, &unicodePath, OBJ_CASE_INSENSITIVE, NULL, NULL);
+void ObjectManagerExplorer::auditDirectory(const std::wstring& path) {
+    std::vector<NamespaceEntry> objects;
+    std::vector<ObjectInfoResult> results;
 
-    NTSTATUS status = NtOpenDirectoryObject(&dirHandle, DIRECTORY_QUERY, &objAttributes);
+    NTSTATUS status = inspector.queryDirectory(path, objects, results);
     if (!NT_SUCCESS(status)) {
-        std::wcerr << L"Failed to open directory: " << path.c_str() << std::endl;
-        return objectNames;
+        logDetailedError(L"NtOpenDirectoryObject", path, status);
+        return;
     }
 
-    BYTE buffer[1024];
-    ULONG context = 0;
-    ULONG returnLength = 0;
-    BOOLEAN restart = TRUE;
-
-    while (true) {
-        status = NtQueryDirectoryObject(
-            dirHandle,
-            buffer,
-            sizeof(buffer),
-            FALSE,
-            restart,
-            &context,
-            &returnLength
-        );
-
-        restart = FALSE;
-
-        if (status == STATUS_NO_MORE_ENTRIES) {
-            break;
-        }
-
-        if (!NT_SUCCESS(status)) {
-            std::wcerr << L"Failed to query directory object." << std::endl;
-            break;
+    auto output = OutputSink::console();
+    size_t failed = 0;
+    for (size_t i = 0; i < objects.size(); i++) {
+        std::wstring line = L"Object: " + objects[i].path + L", Type: " + objects[i].type;
+        if (NT_SUCCESS(results[i].status)) {
+            line += L", Handles: " + std::to_wstring(results[i].basicInfo.HandleCount)
+                + L", Pointers: " + std::to_wstring(results[i].basicInfo.PointerCount);
         }
-
-        POBJECT_DIRECTORY_INFORMATION dirInfo = reinterpret_cast<POBJECT_DIRECTORY_INFORMATION>(buffer);
-        while (dirInfo->Name.Length > 0) {
-            std::wstring typeName(dirInfo->TypeName.Buffer, dirInfo->TypeName.Length / sizeof(wchar_t));
-            std::wstring objectName(dirInfo->Name.Buffer, dirInfo->Name.Length / sizeof(wchar_t));
-
-            if (filterType.empty() || typeName == filterType) {
-                objectNames.emplace_back(objectName, typeName);
-            }
-
-            dirInfo++;
+        else {
+            wchar_t status[16];
+            swprintf(status, 16, L"0x%08X", static_cast<ULONG>(results[i].status));
+            line += L", Status: ";
+            line += status;
+            failed++;
         }
+        line += L'\n';
+        output->writeText(line);
     }
 
-    NtClose(dirHandle);
-    return objectNames;
+    output->writeText(std::to_wstring(objects.size()) + L" objects, " + std::to_wstring(failed) + L" could not be queried\n");
 }
\ No newline at end of file
@@ -1,23 +1,51 @@
 // ObjectManagerExplorer.h
 #pragma once
+#include <atomic>
 #include <string>
+#include <string_view>
 #include <vector>
-#include <windows.h>
-#include <winternl.h>
+#include "DirectoryEnumerator.h"
+#include "NtApi.h"
+#include "ObjectInspector.h"
+#include "ObjectQuery.h"
+#include "OpenFailureTracker.h"
+#include "OutputSink.h"
+#include "ScanArena.h"
 
 class ObjectManagerExplorer {
 public:
-    ObjectManagerExplorer();
+    explicit ObjectManagerExplorer(NtApi& ntApi = NtApi::system());
     ~ObjectManagerExplorer();
 
-    void exploreNamespace(const std::wstring& path, bool recursive = false);
+    // query uses the ObjectQuery syntax; throws std::invalid_argument if malformed.
+    // Listings go to output, or to the console in human format when it is null.
+    void exploreNamespace(const std::wstring& path, bool recursive = false, const std::wstring& query = L"",
+        OutputSink* output = nullptr);
     void listObjects(const std::wstring& path, const std::wstring& filterType = L"", bool recursive = false);
+    void listObjects(const std::wstring& path, const ObjectQuery& query, bool recursive = false,
+        OutputSink* output = nullptr);
+    // Recursive listing for data collection rather than display: names the
+    // console listing hides, such as drive letters like C:, are kept.
+    // Stops after the current directory query once cancel is set.
+    void collectObjects(const std::wstring& path, OutputSink& output, const std::atomic<bool>* cancel = nullptr);
+    // First object directly in path that matches query, stopping the
+    // enumeration there. Returns false if none matches or path cannot be opened.
+    bool findObject(const std::wstring& path, const ObjectQuery& query, NamespaceEntry* found = nullptr);
+    // Writes up to pageSize matching objects directly in path, starting at
+    // cursor, and advances cursor past them. Returns true if entries remain.
+    bool listPage(const std::wstring& path, const ObjectQuery& query, DirectoryCursor& cursor, size_t pageSize,
+        OutputSink* output = nullptr);
     void displayObjectInfo(const std::wstring& objectName);
+    // Basic information for every object in one directory, queried in parallel.
+    void auditDirectory(const std::wstring& path);
 
 private:
-    std::vector<std::pair<std::wstring, std::wstring>> getObjectNames(const std::wstring& path, const std::wstring& filterType);
-    std::wstring getErrorMessage(DWORD errorCode);
-    HANDLE safeOpenDirectory(const std::wstring& path);
-    void logDetailedError(const std::wstring& operation, const std::wstring& path);
+    void walkNamespace(const std::wstring& path, const ObjectQuery& query, bool recursive, bool printableOnly,
+        const std::atomic<bool>* cancel, OutputSink* output);
+    void logDetailedError(const std::wstring& operation, const std::wstring& path, NTSTATUS status);
 
+    NtApi& ntApi;
+    ObjectInspector inspector;
+    ScanArena scanArena;
+    OpenFailureTracker openFailures;
 };
\ No newline at end of file
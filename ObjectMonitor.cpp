@@ -1,38 +1,23 @@
 #include "ObjectMonitor.h"
-#include <windows.h>
-#include <winternl.h>
-#include <ntstatus.h>
+#include "Metrics.h"
+#include "Timestamp.h"
+#include <algorithm>
 #include <iostream>
-#include <set>
 
-// Required for NtQueryDirectoryObject
-#pragma comment(lib, "ntdll.lib")
-
-#define DIRECTORY_QUERY                 0x0001
-#define SYMBOLIC_LINK_QUERY            0x0001
-
-typedef struct _OBJECT_DIRECTORY_INFORMATION {
-    UNICODE_STRING Name;
-    UNICODE_STRING TypeName;
-} OBJECT_DIRECTORY_INFORMATION, * POBJECT_DIRECTORY_INFORMATION;
-
-extern "C" NTSTATUS NTAPI NtQueryDirectoryObject(
-    HANDLE DirectoryHandle,
-    PVOID Buffer,
-    ULONG Length,
-    BOOLEAN ReturnSingleEntry,
-    BOOLEAN RestartScan,
-    PULONG Context,
-    PULONG ReturnLength
-);
-
-extern "C" NTSTATUS NTAPI NtOpenDirectoryObject(
-    PHANDLE DirectoryHandle,
-    ACCESS_MASK DesiredAccess,
-    POBJECT_ATTRIBUTES ObjectAttributes
-);
+namespace {
+    uint64_t hashText(std::wstring_view text) {
+        uint64_t hash = 14695981039346656037ull;
+        for (wchar_t c : text) {
+            hash ^= static_cast<uint16_t>(c);
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+}
 
-ObjectMonitor::ObjectMonitor() : isMonitoring(false) {
+ObjectMonitor::ObjectMonitor(NtApi& ntApi) : ntApi(ntApi), inspector(ntApi), isMonitoring(false),
+    slicedDirectory(ntApi, 8192) {
+    deliver = [this](const ObjectChangeInfo& changeInfo) { deliverChange(changeInfo); };
 }
 
 ObjectMonitor::~ObjectMonitor() {
@@ -45,6 +30,8 @@ void ObjectMonitor::startMonitoring(const std::wstring& path) {
     }
 
     monitoringPath = path;
+    fingerprints.clear();
+    revalidatedUpTo.clear();
     isMonitoring = true;
     monitorThread = std::thread(&ObjectMonitor::monitoringThread, this);
 }
@@ -54,168 +41,415 @@ void ObjectMonitor::stopMonitoring() {
         return;
     }
 
-    isMonitoring = false;
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        isMonitoring = false;
+    }
+    wakeup.notify_all();
     if (monitorThread.joinable()) {
         monitorThread.join();
     }
 }
 
+void ObjectMonitor::setPollInterval(std::chrono::milliseconds interval,
+    std::function<void(const MonitorTickReport&)> callback) {
+    pollInterval = interval;
+    tickCallback = std::move(callback);
+}
+
 void ObjectMonitor::setChangeCallback(std::function<void(const ObjectChangeInfo&)> callback) {
     changeCallback = callback;
 }
 
+void ObjectMonitor::setCoalescing(const CoalescingOptions& options) {
+    coalescer.setOptions(options);
+}
+
+void ObjectMonitor::setScanSlicing(const ScanSlicing& slicing,
+    std::function<void(const ScanSliceReport&)> callback) {
+    scanSlicing = slicing;
+    sliceCallback = std::move(callback);
+}
+
+void ObjectMonitor::setRevalidationBudget(size_t objectsPerTick) {
+    revalidationBudget = objectsPerTick;
+}
+
+void ObjectMonitor::setIndex(NamespaceIndex* index) {
+    namespaceIndex = index;
+}
+
 std::map<std::wstring, ObjectStatistics> ObjectMonitor::getObjectsStatistics() {
-    return statistics;
+    std::lock_guard<std::mutex> lock(statisticsMutex);
+    return std::map<std::wstring, ObjectStatistics>(statistics.begin(), statistics.end());
 }
 
 void ObjectMonitor::updateStatistics() {
-    HANDLE hDirectory = nullptr;
-    OBJECT_ATTRIBUTES objAttributes = { 0 };
-    UNICODE_STRING uniPath = { 0 };
-
-    RtlInitUnicodeString(&uniPath, monitoringPath.c_str());
+    ScanArena arena;
+    ObjectSnapshot objects(&arena);
 
-    InitializeObjectAttributes(&objAttributes,
-        &uniPath,
-        OBJ_CASE_INSENSITIVE,
-        NULL,
-        NULL);
+    if (scanDirectory(arena, objects)) {
+        applyStatistics(objects, anchorWallClock());
+    }
+}
 
-    NTSTATUS status = NtOpenDirectoryObject(&hDirectory,
-        DIRECTORY_QUERY,
-        &objAttributes);
+bool ObjectMonitor::scanDirectory(ScanArena& arena, ObjectSnapshot& objects) {
+    DirectoryEnumerator directory(ntApi, monitoringPath, 8192);
+    if (!directory.isOpen()) {
+        return false;
+    }
 
-    if (!NT_SUCCESS(status)) {
-        return;
+    while (const OBJECT_DIRECTORY_INFORMATION* entry = directory.next()) {
+        appendEntry(arena, objects, *entry);
     }
 
-    std::vector<std::pair<std::wstring, std::wstring>> currentObjects;
-    const ULONG bufferSize = 8192;
-    ULONG context = 0;
-    ULONG returnLength;
-    BYTE buffer[bufferSize] = { 0 };
-    BOOLEAN restart = TRUE;
+    std::sort(objects.begin(), objects.end());
+    return directory.status() == STATUS_NO_MORE_ENTRIES;
+}
 
-    while (TRUE) {
-        status = NtQueryDirectoryObject(hDirectory,
-            buffer,
-            bufferSize,
-            FALSE,
-            restart,
-            &context,
-            &returnLength);
+bool ObjectMonitor::scanSlice(ScanArena& arena, ObjectSnapshot& objects, bool& passComplete) {
+    using Clock = std::chrono::steady_clock;
 
-        if (!NT_SUCCESS(status)) {
+    passComplete = false;
+    if (!slicedDirectory.isOpen()) {
+        if (!NT_SUCCESS(slicedDirectory.open(monitoringPath))) {
+            return false;
+        }
+        nextSlice = 0;
+    }
+
+    auto sliceStart = Clock::now();
+    auto deadline = scanSlicing.maxDuration.count() > 0 ? sliceStart + scanSlicing.maxDuration : Clock::time_point::max();
+    const size_t maxEntries = scanSlicing.maxEntries > 0 ? scanSlicing.maxEntries : SIZE_MAX;
+    uint64_t queriesBefore = slicedDirectory.queryCount();
+    uint64_t bytesBefore = slicedDirectory.bytesRead();
+    size_t entries = 0;
+
+    // The handle stays open between ticks; the enumerator resumes from the
+    // kernel context where the previous slice stopped.
+    while (entries < maxEntries) {
+        const OBJECT_DIRECTORY_INFORMATION* entry = slicedDirectory.next();
+        if (!entry) {
+            passComplete = true;
+            break;
+        }
+        appendEntry(arena, objects, *entry);
+        entries++;
+        if (Clock::now() >= deadline) {
             break;
         }
+    }
+    // The last batch is used up; end the pass without another slice.
+    if (!passComplete && !slicedDirectory.hasMore()) {
+        slicedDirectory.next();
+        passComplete = true;
+    }
+
+    auto elapsed = Clock::now() - sliceStart;
+    Metrics::instance().record(MetricHistogram::MonitorSlice, elapsed);
+    if (sliceCallback) {
+        sliceCallback(ScanSliceReport{ nextSlice, entries, slicedDirectory.queryCount() - queriesBefore,
+            slicedDirectory.bytesRead() - bytesBefore, elapsed, passComplete });
+    }
+    nextSlice++;
+
+    if (!passComplete) {
+        return true;
+    }
+
+    bool succeeded = slicedDirectory.status() == STATUS_NO_MORE_ENTRIES;
+    slicedDirectory.close();
+    if (!succeeded) {
+        return false;
+    }
 
-        POBJECT_DIRECTORY_INFORMATION info = (POBJECT_DIRECTORY_INFORMATION)buffer;
-        while (info->Name.Length != 0) {
-            std::wstring name(info->Name.Buffer, info->Name.Length / sizeof(WCHAR));
-            std::wstring type(info->TypeName.Buffer, info->TypeName.Length / sizeof(WCHAR));
+    // Entries that moved between slices can be read twice.
+    std::sort(objects.begin(), objects.end());
+    objects.erase(std::unique(objects.begin(), objects.end()), objects.end());
+    return true;
+}
+
+void ObjectMonitor::appendEntry(ScanArena& arena, ObjectSnapshot& objects, const OBJECT_DIRECTORY_INFORMATION& entry) {
+    std::wstring_view name = arena.copy(entry.Name.Buffer, entry.Name.Length / sizeof(WCHAR));
+    std::wstring_view type = arena.copy(entry.TypeName.Buffer, entry.TypeName.Length / sizeof(WCHAR));
+    objects.push_back({ name, type, arena.folded(name) });
+}
 
-            currentObjects.push_back({ name, type });
+void ObjectMonitor::applyStatistics(const ObjectSnapshot& objects, EventTick tick) {
+    std::lock_guard<std::mutex> lock(statisticsMutex);
+    for (const auto& object : objects) {
+        auto it = statistics.find(object.name);
+        if (it == statistics.end()) {
+            // Only names that outlive the scan are copied off the arena.
+            it = statistics.emplace_hint(it, std::wstring(object.name), ObjectStatistics{});
+            Metrics::instance().add(MetricCounter::Allocations);
+            Metrics::instance().stringAllocated(object.name.size());
+        }
 
-            ObjectStatistics& stats = statistics[name];
-            stats.handleCount = 0; 
-            stats.referenceCount = 0; 
-            stats.memoryUsage = 0; 
-            GetSystemTime(&stats.lastAccessTime);
+        ObjectStatistics& stats = it->second;
+        stats.handleCount = 0;
+        stats.referenceCount = 0;
+        stats.memoryUsage = 0;
+        stats.lastAccessTime = tick;
+    }
+}
 
-            info++;
+void ObjectMonitor::reportChange(const ScannedObject& object, bool created, EventTick tick) {
+    // The index tracks every change; only delivery is coalesced.
+    if (namespaceIndex) {
+        if (created) {
+            namespaceIndex->insert(monitoringPath, object.name, object.type);
         }
+        else {
+            namespaceIndex->erase(monitoringPath, object.name);
+        }
+    }
 
-        restart = FALSE;
+    if (!created) {
+        auto it = fingerprints.find(object.key);
+        if (it != fingerprints.end()) {
+            fingerprints.erase(it);
+        }
     }
 
-    CloseHandle(hDirectory);
+    Metrics::instance().add(MetricCounter::ChangeEvents);
+    if (created) {
+        coalescer.created(object.name, object.type, tick, deliver);
+    }
+    else {
+        coalescer.deleted(object.name, object.type, tick, deliver);
+    }
 }
 
-void ObjectMonitor::monitoringThread() {
-    std::vector<std::pair<std::wstring, std::wstring>> prevObjects;
+void ObjectMonitor::deliverChange(const ObjectChangeInfo& changeInfo) {
+    if (changeCallback) {
+        ScopedMetricTimer callbackTimer(MetricHistogram::MonitorCallback);
+        changeCallback(changeInfo);
+    }
+}
 
-    while (isMonitoring) {
-        std::vector<std::pair<std::wstring, std::wstring>> currentObjects;
-
-        HANDLE hDirectory = nullptr;
-        OBJECT_ATTRIBUTES objAttributes = { 0 };
-        UNICODE_STRING uniPath = { 0 };
-
-        RtlInitUnicodeString(&uniPath, monitoringPath.c_str());
-        InitializeObjectAttributes(&objAttributes, &uniPath, OBJ_CASE_INSENSITIVE, NULL, NULL);
-
-        if (NT_SUCCESS(NtOpenDirectoryObject(&hDirectory, DIRECTORY_QUERY, &objAttributes))) {
-            const ULONG bufferSize = 8192;
-            ULONG context = 0;
-            ULONG returnLength;
-            BYTE buffer[bufferSize] = { 0 };
-            BOOLEAN restart = TRUE;
-
-            while (TRUE) {
-                NTSTATUS status = NtQueryDirectoryObject(hDirectory,
-                    buffer,
-                    bufferSize,
-                    FALSE,
-                    restart,
-                    &context,
-                    &returnLength);
-
-                if (!NT_SUCCESS(status)) {
-                    break;
-                }
+void ObjectMonitor::revalidate(const ObjectSnapshot& objects, EventTick tick) {
+    if (revalidationBudget == 0 || objects.empty()) {
+        return;
+    }
+    ScopedMetricTimer revalidateTimer(MetricHistogram::MonitorRevalidate);
+
+    // Continue after the last object checked, wrapping around, so every
+    // object is revisited once per objects.size() / budget ticks.
+    size_t start = std::upper_bound(objects.begin(), objects.end(), std::wstring_view(revalidatedUpTo),
+        [](std::wstring_view key, const ScannedObject& object) { return key < object.key; }) - objects.begin();
+    size_t count = std::min(revalidationBudget, objects.size());
+    size_t last = start;
+
+    for (size_t k = 0; k < count; k++) {
+        last = (start + k) % objects.size();
+        const auto& object = objects[last];
+
+        // Left alone until its Created has been delivered, so a Modified
+        // never comes first or reports an object that turns out transient.
+        if (coalescer.isPending(object.name)) {
+            continue;
+        }
 
-                POBJECT_DIRECTORY_INFORMATION info = (POBJECT_DIRECTORY_INFORMATION)buffer;
-                while (info->Name.Length != 0) {
-                    std::wstring name(info->Name.Buffer, info->Name.Length / sizeof(WCHAR));
-                    std::wstring type(info->TypeName.Buffer, info->TypeName.Length / sizeof(WCHAR));
-                    currentObjects.push_back({ name, type });
-                    info++;
-                }
+        ObjectFingerprint current;
+        if (!fingerprint(object.name, object.type, current)) {
+            continue;
+        }
 
-                restart = FALSE;
-            }
+        auto it = fingerprints.find(object.key);
+        if (it == fingerprints.end()) {
+            fingerprints.emplace_hint(it, std::wstring(object.key), current);
+            Metrics::instance().add(MetricCounter::Allocations);
+            Metrics::instance().stringAllocated(object.key.size());
+        }
+        else if (it->second != current) {
+            it->second = current;
+
+            ObjectChangeInfo changeInfo;
+            changeInfo.objectName = object.name;
+            changeInfo.objectType = object.type;
+            changeInfo.changeType = ChangeType::Modified;
+            changeInfo.tick = tick;
+            Metrics::instance().add(MetricCounter::ChangeEvents);
+            Metrics::instance().stringAllocated(object.name.size());
+            Metrics::instance().stringAllocated(object.type.size());
+            deliverChange(changeInfo);
+        }
+    }
+
+    revalidatedUpTo.assign(objects[last].key);
+}
 
-            CloseHandle(hDirectory);
+void ObjectMonitor::confirmDeletions(const ObjectSnapshot& previous, std::pmr::vector<size_t>& deleted,
+    ScanArena& arena, ObjectSnapshot& objects) {
+    size_t scanned = objects.size();
+    size_t gone = 0;
+    for (size_t index : deleted) {
+        const ScannedObject& object = previous[index];
+        if (!objectExists(object.name)) {
+            deleted[gone++] = index;
+            continue;
         }
+        std::wstring_view name = arena.copy(object.name);
+        objects.push_back({ name, arena.copy(object.type), arena.folded(name) });
+    }
+    deleted.resize(gone);
 
-        if (!prevObjects.empty()) {
-            std::set<std::pair<std::wstring, std::wstring>> prevSet(prevObjects.begin(), prevObjects.end());
-            std::set<std::pair<std::wstring, std::wstring>> currSet(currentObjects.begin(), currentObjects.end());
+    // Both runs are sorted: the scan, and the carried objects in the order
+    // of previous.
+    std::inplace_merge(objects.begin(), objects.begin() + scanned, objects.end());
+}
 
-            for (const auto& obj : currSet) {
-                if (prevSet.find(obj) == prevSet.end()) {
-                    ObjectChangeInfo changeInfo;
-                    changeInfo.objectName = obj.first;
-                    changeInfo.objectType = obj.second;
-                    changeInfo.changeType = L"Created";
-                    GetSystemTime(&changeInfo.timestamp);
+bool ObjectMonitor::objectExists(std::wstring_view name) {
+    setObjectPath(name);
+
+    // Opened as a symbolic link whatever its type: that open does not follow
+    // a link, and an object of another type fails it with
+    // STATUS_OBJECT_TYPE_MISMATCH, not STATUS_OBJECT_NAME_NOT_FOUND.
+    HANDLE handle;
+    NTSTATUS status = inspector.open(objectPath, L"SymbolicLink", handle);
+    if (NT_SUCCESS(status)) {
+        ntApi.close(handle);
+        return true;
+    }
+    return status != STATUS_OBJECT_NAME_NOT_FOUND && status != STATUS_OBJECT_PATH_NOT_FOUND;
+}
 
-                    if (changeCallback) {
-                        changeCallback(changeInfo);
-                    }
-                }
-            }
+void ObjectMonitor::setObjectPath(std::wstring_view name) {
+    objectPath.assign(monitoringPath);
+    if (objectPath.empty() || objectPath.back() != L'\\') {
+        objectPath += L'\\';
+    }
+    objectPath.append(name);
+}
 
-            for (const auto& obj : prevSet) {
-                if (currSet.find(obj) == currSet.end()) {
-                    ObjectChangeInfo changeInfo;
-                    changeInfo.objectName = obj.first;
-                    changeInfo.objectType = obj.second;
-                    changeInfo.changeType = L"Deleted";
-                    GetSystemTime(&changeInfo.timestamp);
+bool ObjectMonitor::fingerprint(std::wstring_view name, std::wstring_view type, ObjectFingerprint& result) {
+    setObjectPath(name);
 
-                    if (changeCallback) {
-                        changeCallback(changeInfo);
+    HANDLE handle;
+    if (!NT_SUCCESS(inspector.open(objectPath, type, handle))) {
+        return false;
+    }
+
+    // Windows only fills CreationTime for some types (symbolic links among
+    // them); for the rest it stays zero and only the link hash can differ.
+    OBJECT_BASIC_INFORMATION basicInfo = {};
+    ULONG returnLength = 0;
+    NTSTATUS status = ntApi.queryObject(handle, ObjectBasicInformation, &basicInfo, sizeof(basicInfo), &returnLength);
+    Metrics::instance().ntCall(NT_SUCCESS(status));
+    result.creationTime = NT_SUCCESS(status) ? basicInfo.CreationTime.QuadPart : 0;
+
+    result.targetHash = 0;
+    if (type == L"SymbolicLink") {
+        std::wstring target;
+        if (NT_SUCCESS(inspector.queryLinkTarget(handle, linkBuffer, target))) {
+            result.targetHash = hashText(target);
+        }
+    }
+
+    ntApi.close(handle);
+    return true;
+}
+
+void ObjectMonitor::monitoringThread() {
+    // Two arenas alternate: one holds the previous tick's snapshot while the
+    // other is reset and refilled, so a steady-state tick allocates nothing.
+    // They only live as long as the thread, so their size is not capped.
+    ScanArena arenas[2] = { ScanArena(64 * 1024, SIZE_MAX), ScanArena(64 * 1024, SIZE_MAX) };
+    ObjectSnapshot snapshots[2] = { ObjectSnapshot(&arenas[0]), ObjectSnapshot(&arenas[1]) };
+    size_t previous = 0;
+    size_t current = 1;
+    bool haveBaseline = false;
+    // A sliced pass spans several ticks, filling snapshots[current] one
+    // slice per tick; the diff runs on the tick that completes it.
+    bool passOpen = false;
+    Metrics& metrics = Metrics::instance();
+
+    while (isMonitoring) {
+        auto tickStart = std::chrono::steady_clock::now();
+        auto cpuStart = threadCpuTime();
+
+        if (!passOpen) {
+            current = previous ^ 1;
+            arenas[current].reset();
+            snapshots[current] = ObjectSnapshot(&arenas[current]);
+        }
+
+        // A failed scan keeps the old baseline instead of reporting every
+        // object as deleted. The baseline itself is read in one go: a sliced
+        // pass can miss objects, and the first has no earlier scan to
+        // check them against.
+        bool scanned;
+        bool sliced = scanSlicing.enabled() && haveBaseline;
+        if (sliced) {
+            bool passComplete = false;
+            bool succeeded = scanSlice(arenas[current], snapshots[current], passComplete);
+            passOpen = succeeded && !passComplete;
+            scanned = succeeded && passComplete;
+        }
+        else {
+            scanned = scanDirectory(arenas[current], snapshots[current]);
+        }
+        if (scanned) {
+            // One clock reading stamps every change this scan found.
+            EventTick scanTick = anchorWallClock();
+
+            if (haveBaseline) {
+                ScopedMetricTimer diffTimer(MetricHistogram::MonitorDiff);
+                const ObjectSnapshot& prevObjects = snapshots[previous];
+                const ObjectSnapshot& currObjects = snapshots[current];
+
+                std::pmr::vector<size_t> deleted(&arenas[current]);
+                size_t p = 0;
+                size_t c = 0;
+                while (p < prevObjects.size() || c < currObjects.size()) {
+                    if (c == currObjects.size() || (p < prevObjects.size() && prevObjects[p] < currObjects[c])) {
+                        deleted.push_back(p++);
                     }
+                    else if (p == prevObjects.size() || currObjects[c] < prevObjects[p]) {
+                        reportChange(currObjects[c++], true, scanTick);
+                    }
+                    else {
+                        p++;
+                        c++;
+                    }
+                }
+
+                // A sliced pass can miss an object: the resume context counts
+                // entries, so a removal ahead of the cursor between slices
+                // moves the next entry back past it. Only objects a lookup
+                // no longer finds are reported deleted.
+                if (sliced && !deleted.empty()) {
+                    confirmDeletions(prevObjects, deleted, arenas[current], snapshots[current]);
+                }
+                for (size_t index : deleted) {
+                    reportChange(prevObjects[index], false, scanTick);
                 }
             }
+
+            coalescer.advance(scanTick, deliver);
+            revalidate(snapshots[current], scanTick);
+
+            applyStatistics(snapshots[current], scanTick);
+            previous = current;
+            haveBaseline = true;
         }
 
-        prevObjects = currentObjects;
-        updateStatistics();
+        auto elapsed = std::chrono::steady_clock::now() - tickStart;
+        metrics.record(MetricHistogram::MonitorTick, elapsed);
+        if (tickCallback) {
+            tickCallback(MonitorTickReport{ scanned, scanned ? snapshots[previous].size() : 0, elapsed,
+                threadCpuTime() - cpuStart });
+        }
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+        // Within a pass only the short slice pause separates ticks.
+        std::unique_lock<std::mutex> lock(wakeMutex);
+        wakeup.wait_for(lock, passOpen ? std::chrono::milliseconds(scanSlicing.pause) : pollInterval,
+            [this] { return !isMonitoring; });
     }
+
+    slicedDirectory.close();
+    coalescer.flush(currentTick(), deliver);
 }
 
 bool ObjectMonitor::compareObjectLists(
@@ -1,49 +1,186 @@
 #pragma once
-#include <windows.h>
+#include "ChangeCoalescer.h"
+#include "DirectoryEnumerator.h"
+#include "NamespaceIndex.h"
+#include "NtApi.h"
+#include "ObjectInspector.h"
+#include "ScanArena.h"
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <functional>
 #include <thread>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <map>
-
-struct ObjectChangeInfo {
-    std::wstring objectName;
-    std::wstring objectType;
-    std::wstring changeType;
-    SYSTEMTIME timestamp;
-};
+#include <mutex>
 
 struct ObjectStatistics {
     ULONG handleCount;
     ULONG referenceCount;
     SIZE_T memoryUsage;
-    SYSTEMTIME lastAccessTime;
+    // Tick of the last scan that saw the object.
+    EventTick lastAccessTime;
+};
+
+// What identifies one incarnation of an object beyond its name and type.
+struct ObjectFingerprint {
+    LONGLONG creationTime = 0;
+    // FNV-1a of the link target; zero for other types.
+    uint64_t targetHash = 0;
+
+    bool operator==(const ObjectFingerprint& other) const {
+        return creationTime == other.creationTime && targetHash == other.targetHash;
+    }
+    bool operator!=(const ObjectFingerprint& other) const { return !(*this == other); }
+};
+
+// Time-sliced scanning: instead of reading the whole directory in one go,
+// each monitor tick reads one bounded chunk and the next tick resumes from
+// the kernel context, diffing only once the pass is complete. The first
+// pass, which sets the baseline, is still read whole.
+struct ScanSlicing {
+    // Entries per slice; zero for no entry limit.
+    size_t maxEntries = 0;
+    // A slice ends once it has run this long; zero for no time limit.
+    std::chrono::microseconds maxDuration{ 0 };
+    // Pause between slices of one pass, in place of the poll interval.
+    std::chrono::milliseconds pause{ 10 };
+
+    bool enabled() const { return maxEntries > 0 || maxDuration.count() > 0; }
+};
+
+// Cost of one slice of a sliced pass.
+struct ScanSliceReport {
+    size_t slice;
+    size_t entries;
+    uint64_t queries;
+    uint64_t bytes;
+    std::chrono::nanoseconds duration;
+    bool passComplete;
+};
+
+// Cost of one monitor tick: the scan, diff and delivery of its changes.
+struct MonitorTickReport {
+    // False if the scan failed or, when slicing, the tick read a slice
+    // that left the pass unfinished.
+    bool scanned;
+    // Objects in the scan; zero if it failed.
+    size_t objects;
+    std::chrono::nanoseconds duration;
+    // CPU time the monitor thread spent on the tick.
+    std::chrono::nanoseconds cpuTime;
 };
 
+// One entry of a directory scan; the views point into the ScanArena the
+// scan was taken with. key is the case-folded name, made once when the
+// entry is read, so sorting and diffing compare it ordinally and a name
+// seen again in different case is still the same object.
+struct ScannedObject {
+    std::wstring_view name;
+    std::wstring_view type;
+    std::wstring_view key;
+
+    bool operator<(const ScannedObject& other) const {
+        int order = key.compare(other.key);
+        return order != 0 ? order < 0 : type < other.type;
+    }
+    bool operator==(const ScannedObject& other) const { return key == other.key && type == other.type; }
+};
+
+// One directory scan, sorted by key.
+using ObjectSnapshot = std::pmr::vector<ScannedObject>;
+
 class ObjectMonitor {
 public:
-    ObjectMonitor();
+    explicit ObjectMonitor(NtApi& ntApi = NtApi::system());
     ~ObjectMonitor();
 
     void startMonitoring(const std::wstring& path);
     void stopMonitoring();
 
     void setChangeCallback(std::function<void(const ObjectChangeInfo&)> callback);
+    // Folds short-lived objects into per-window Transient events before
+    // they reach the callback. Set before starting.
+    void setCoalescing(const CoalescingOptions& options);
+
+    // Objects re-fingerprinted per tick, round-robin over the directory, to
+    // catch retargeted links and objects recreated under the same name
+    // (reported as Modified). Zero turns revalidation off. Set before starting.
+    void setRevalidationBudget(size_t objectsPerTick);
+
+    // Set before starting. Each tick reads one slice; the callback, if any,
+    // runs on the monitor thread after every slice.
+    void setScanSlicing(const ScanSlicing& slicing,
+        std::function<void(const ScanSliceReport&)> sliceCallback = nullptr);
+
+    // Pause between the end of one tick and the start of the next; one
+    // second by default. Set before starting. The callback, if any, runs on
+    // the monitor thread after every tick.
+    void setPollInterval(std::chrono::milliseconds interval,
+        std::function<void(const MonitorTickReport&)> tickCallback = nullptr);
+
+    // Changes seen by the monitor are applied to index. Set before starting.
+    void setIndex(NamespaceIndex* index);
 
     std::map<std::wstring, ObjectStatistics> getObjectsStatistics();
     void updateStatistics();
 
 private:
     void monitoringThread();
+    bool scanDirectory(ScanArena& arena, ObjectSnapshot& objects);
+    // Reads the next slice of the current pass into objects, opening the
+    // directory if no pass is in progress. Returns false if the pass failed.
+    bool scanSlice(ScanArena& arena, ObjectSnapshot& objects, bool& passComplete);
+    static void appendEntry(ScanArena& arena, ObjectSnapshot& objects, const OBJECT_DIRECTORY_INFORMATION& entry);
+    void applyStatistics(const ObjectSnapshot& objects, EventTick tick);
+    void reportChange(const ScannedObject& object, bool created, EventTick tick);
+    void deliverChange(const ObjectChangeInfo& changeInfo);
+    // Drops from deleted the objects of previous that can still be opened
+    // and carries them into objects, keeping it sorted.
+    void confirmDeletions(const ObjectSnapshot& previous, std::pmr::vector<size_t>& deleted,
+        ScanArena& arena, ObjectSnapshot& objects);
+    bool objectExists(std::wstring_view name);
+    void revalidate(const ObjectSnapshot& objects, EventTick tick);
+    bool fingerprint(std::wstring_view name, std::wstring_view type, ObjectFingerprint& result);
+    void setObjectPath(std::wstring_view name);
     bool compareObjectLists(
         const std::vector<std::pair<std::wstring, std::wstring>>& oldList,
         const std::vector<std::pair<std::wstring, std::wstring>>& newList
     );
 
+    NtApi& ntApi;
+    ObjectInspector inspector;
     std::thread monitorThread;
     std::atomic<bool> isMonitoring;
     std::wstring monitoringPath;
     std::function<void(const ObjectChangeInfo&)> changeCallback;
-    std::map<std::wstring, ObjectStatistics> statistics;
+    ChangeCoalescer coalescer;
+    ChangeCoalescer::Callback deliver;
+
+    ScanSlicing scanSlicing;
+    std::function<void(const ScanSliceReport&)> sliceCallback;
+    // Monitor thread only; open while a sliced pass is in progress.
+    DirectoryEnumerator slicedDirectory;
+    size_t nextSlice = 0;
+
+    std::chrono::milliseconds pollInterval{ 1000 };
+    std::function<void(const MonitorTickReport&)> tickCallback;
+    // Cuts the pause short when monitoring stops.
+    std::mutex wakeMutex;
+    std::condition_variable wakeup;
+
+    // Monitor thread only.
+    size_t revalidationBudget = 128;
+    // Keyed by folded name.
+    std::map<std::wstring, ObjectFingerprint, std::less<>> fingerprints;
+    // Key revalidation resumes after.
+    std::wstring revalidatedUpTo;
+    std::wstring objectPath;
+    std::vector<WCHAR> linkBuffer;
+    NamespaceIndex* namespaceIndex = nullptr;
+    std::map<std::wstring, ObjectStatistics, std::less<>> statistics;
+    std::mutex statisticsMutex;
 };
@@ -0,0 +1,341 @@
+#include "ObjectQuery.h"
+#include "NameFolding.h"
+#include <algorithm>
+#include <cwctype>
+#include <stdexcept>
+
+namespace {
+    struct NameCharacterClasses {
+        bool unsafe[128] = {};
+
+        NameCharacterClasses() {
+            unsafe[L':'] = true;
+            unsafe[L'/'] = true;
+            unsafe[L'\\'] = true;
+        }
+    };
+
+    const NameCharacterClasses nameCharacterClasses;
+
+    // Splits on whitespace; double quotes group characters, including spaces.
+    std::vector<std::wstring> tokenize(const std::wstring& text) {
+        std::vector<std::wstring> tokens;
+        std::wstring current;
+        bool inToken = false;
+        bool quoted = false;
+
+        for (wchar_t c : text) {
+            if (c == L'"') {
+                quoted = !quoted;
+                inToken = true;
+            }
+            else if (!quoted && iswspace(c)) {
+                if (inToken) {
+                    tokens.push_back(current);
+                    current.clear();
+                    inToken = false;
+                }
+            }
+            else {
+                current += c;
+                inToken = true;
+            }
+        }
+
+        if (quoted) {
+            throw std::invalid_argument("Unterminated quote in query");
+        }
+        if (inToken) {
+            tokens.push_back(current);
+        }
+        return tokens;
+    }
+}
+
+ObjectQuery ObjectQuery::compile(const std::wstring& text) {
+    ObjectQuery query;
+
+    for (std::wstring token : tokenize(text)) {
+        bool negated = false;
+        if (token.size() > 1 && (token[0] == L'!' || token[0] == L'-')) {
+            negated = true;
+            token.erase(0, 1);
+        }
+
+        std::wstring key;
+        std::wstring value = token;
+        size_t colon = token.find(L':');
+        if (colon != std::wstring::npos) {
+            std::wstring candidate = token.substr(0, colon);
+            if (candidate == L"name" || candidate == L"type" || candidate == L"re" ||
+                candidate == L"regex" || candidate == L"depth") {
+                key = candidate;
+                value = token.substr(colon + 1);
+            }
+        }
+
+        if (value.empty()) {
+            throw std::invalid_argument("Empty value in query");
+        }
+
+        if (key == L"depth") {
+            if (negated || value.find_first_not_of(L"0123456789") != std::wstring::npos || value.size() > 6) {
+                throw std::invalid_argument("Invalid depth in query");
+            }
+            query.depthLimit = std::stoi(value);
+            continue;
+        }
+
+        Term term;
+        if (key == L"type") {
+            term.kind = TermKind::TypeSet;
+            size_t start = 0;
+            while (start <= value.size()) {
+                size_t comma = value.find(L',', start);
+                std::wstring typeName = value.substr(start, comma == std::wstring::npos ? std::wstring::npos : comma - start);
+                if (!typeName.empty()) {
+                    std::transform(typeName.begin(), typeName.end(), typeName.begin(), [](wchar_t c) { return foldChar(c); });
+                    term.types.push_back(typeName);
+                }
+                if (comma == std::wstring::npos) {
+                    break;
+                }
+                start = comma + 1;
+            }
+            if (term.types.empty()) {
+                throw std::invalid_argument("Empty type list in query");
+            }
+        }
+        else if (key == L"re" || key == L"regex") {
+            term.kind = TermKind::Regex;
+            try {
+                term.regex = std::make_shared<const std::wregex>(value,
+                    std::regex_constants::ECMAScript | std::regex_constants::icase | std::regex_constants::optimize);
+            }
+            catch (const std::regex_error&) {
+                throw std::invalid_argument("Invalid regular expression in query");
+            }
+        }
+        else {
+            term = compileGlob(value);
+        }
+
+        term.negated = negated;
+        query.terms.push_back(std::move(term));
+    }
+
+    // Cheap terms first so most entries are rejected before a glob or regex runs.
+    std::stable_sort(query.terms.begin(), query.terms.end(),
+        [](const Term& a, const Term& b) { return a.kind < b.kind; });
+    return query;
+}
+
+ObjectQuery ObjectQuery::ofType(const std::wstring& typeName) {
+    ObjectQuery query;
+    if (!typeName.empty()) {
+        Term term;
+        term.kind = TermKind::TypeSet;
+        term.types.push_back(typeName);
+        std::transform(term.types[0].begin(), term.types[0].end(), term.types[0].begin(), [](wchar_t c) { return foldChar(c); });
+        query.terms.push_back(std::move(term));
+    }
+    return query;
+}
+
+ObjectQuery::Term ObjectQuery::compileGlob(const std::wstring& pattern) {
+    Term term;
+    size_t stars = 0;
+    bool wildcards = false;
+
+    for (size_t i = 0; i < pattern.size(); i++) {
+        wchar_t c = pattern[i];
+        if (c == L'*') {
+            if (term.glob.empty() || term.glob.back().kind != GlobToken::Star) {
+                term.glob.push_back({ GlobToken::Star, 0, 0 });
+                stars++;
+            }
+        }
+        else if (c == L'?') {
+            term.glob.push_back({ GlobToken::Any, 0, 0 });
+            wildcards = true;
+        }
+        else if (c == L'[') {
+            size_t close = pattern.find(L']', i + 2);
+            if (close == std::wstring::npos) {
+                throw std::invalid_argument("Unterminated character class in query");
+            }
+
+            CharClass charClass;
+            size_t j = i + 1;
+            charClass.negated = pattern[j] == L'!' || pattern[j] == L'^';
+            if (charClass.negated) {
+                j++;
+            }
+            for (; j < close; j++) {
+                wchar_t low = foldChar(pattern[j]);
+                wchar_t high = low;
+                if (j + 2 < close && pattern[j + 1] == L'-') {
+                    high = foldChar(pattern[j + 2]);
+                    j += 2;
+                }
+                charClass.ranges.push_back({ low, high });
+            }
+
+            term.glob.push_back({ GlobToken::Class, 0, term.classes.size() });
+            term.classes.push_back(std::move(charClass));
+            wildcards = true;
+            i = close;
+        }
+        else {
+            term.glob.push_back({ GlobToken::Char, foldChar(c), 0 });
+        }
+    }
+
+    // Plain names and single-star patterns compile to straight comparisons.
+    if (!wildcards && stars <= 2) {
+        bool leading = !term.glob.empty() && term.glob.front().kind == GlobToken::Star;
+        bool trailing = term.glob.size() > 1 && term.glob.back().kind == GlobToken::Star;
+
+        if (stars == static_cast<size_t>(leading) + static_cast<size_t>(trailing)) {
+            for (const auto& token : term.glob) {
+                if (token.kind == GlobToken::Char) {
+                    term.literal += token.value;
+                }
+            }
+
+            term.kind = leading && trailing ? TermKind::Contains
+                : leading ? TermKind::Suffix
+                : trailing ? TermKind::Prefix
+                : TermKind::Exact;
+            term.glob.clear();
+            return term;
+        }
+    }
+
+    term.kind = TermKind::Glob;
+    return term;
+}
+
+bool ObjectQuery::matches(const UNICODE_STRING& name, const UNICODE_STRING& typeName) const {
+    const size_t nameLength = name.Length / sizeof(WCHAR);
+    const size_t typeLength = typeName.Length / sizeof(WCHAR);
+
+    for (const auto& term : terms) {
+        if (evaluate(term, name.Buffer, nameLength, typeName.Buffer, typeLength) == term.negated) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ObjectQuery::evaluate(const Term& term, const wchar_t* name, size_t nameLength,
+    const wchar_t* type, size_t typeLength) {
+    const std::wstring& literal = term.literal;
+
+    switch (term.kind) {
+    case TermKind::TypeSet:
+        for (const auto& candidate : term.types) {
+            if (candidate.size() == typeLength && equalsFolded(type, candidate)) {
+                return true;
+            }
+        }
+        return false;
+
+    case TermKind::Exact:
+        return nameLength == literal.size() && equalsFolded(name, literal);
+
+    case TermKind::Prefix:
+        return nameLength >= literal.size() && equalsFolded(name, literal);
+
+    case TermKind::Suffix:
+        return nameLength >= literal.size() && equalsFolded(name + nameLength - literal.size(), literal);
+
+    case TermKind::Contains:
+        if (literal.size() > nameLength) {
+            return false;
+        }
+        for (size_t i = 0; i + literal.size() <= nameLength; i++) {
+            if (equalsFolded(name + i, literal)) {
+                return true;
+            }
+        }
+        return false;
+
+    case TermKind::Glob:
+        return matchGlob(term, name, nameLength);
+
+    case TermKind::Regex:
+        return std::regex_search(name, name + nameLength, *term.regex);
+    }
+
+    return false;
+}
+
+bool ObjectQuery::matchGlob(const Term& term, const wchar_t* name, size_t length) {
+    const auto& tokens = term.glob;
+    const size_t none = static_cast<size_t>(-1);
+    size_t t = 0;
+    size_t i = 0;
+    size_t starToken = none;
+    size_t starPosition = 0;
+
+    auto tokenMatches = [&term](const GlobToken& token, wchar_t c) {
+        switch (token.kind) {
+        case GlobToken::Char:
+            return token.value == c;
+        case GlobToken::Any:
+            return true;
+        case GlobToken::Class: {
+            const CharClass& charClass = term.classes[token.classIndex];
+            bool inClass = false;
+            for (const auto& range : charClass.ranges) {
+                if (c >= range.first && c <= range.second) {
+                    inClass = true;
+                    break;
+                }
+            }
+            return inClass != charClass.negated;
+        }
+        default:
+            return false;
+        }
+    };
+
+    while (i < length) {
+        if (t < tokens.size() && tokens[t].kind == GlobToken::Star) {
+            starToken = t++;
+            starPosition = i;
+        }
+        else if (t < tokens.size() && tokenMatches(tokens[t], foldChar(name[i]))) {
+            t++;
+            i++;
+        }
+        else if (starToken != none) {
+            t = starToken + 1;
+            i = ++starPosition;
+        }
+        else {
+            return false;
+        }
+    }
+
+    while (t < tokens.size() && tokens[t].kind == GlobToken::Star) {
+        t++;
+    }
+    return t == tokens.size();
+}
+
+bool ObjectQuery::isPrintableName(const UNICODE_STRING& name) {
+    const size_t length = name.Length / sizeof(WCHAR);
+    if (length >= MAX_PATH) {
+        return false;
+    }
+
+    for (size_t i = 0; i < length; i++) {
+        wchar_t c = name.Buffer[i];
+        if (c < 0x80 && nameCharacterClasses.unsafe[c]) {
+            return false;
+        }
+    }
+    return true;
+}
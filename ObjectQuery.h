@@ -0,0 +1,76 @@
+#pragma once
+#include "NtTypes.h"
+#include <memory>
+#include <regex>
+#include <string>
+#include <vector>
+
+// Filter for directory enumeration, compiled once from a query string and
+// evaluated on the raw UNICODE_STRING entries of the query buffer, so
+// entries that do not match are never copied.
+//
+// A query is a list of terms that must all match:
+//   Global*  name:Global*    name glob (*, ?, [a-z], [!x]), case-insensitive
+//   re:^Session\d+$          regular expression searched in the name
+//   type:Event,Mutant        object type is one of the listed types
+//   depth:2                  descend at most two levels below the start
+//                            directory when recursing
+// Prefix a term with ! or - to negate it. Quote values containing spaces.
+class ObjectQuery {
+public:
+    ObjectQuery() = default;
+
+    // Throws std::invalid_argument on malformed queries.
+    static ObjectQuery compile(const std::wstring& text);
+    static ObjectQuery ofType(const std::wstring& typeName);
+
+    bool matches(const UNICODE_STRING& name, const UNICODE_STRING& typeName) const;
+    bool matchesAll() const { return terms.empty(); }
+
+    // 0 means no limit.
+    int maxDepth() const { return depthLimit; }
+
+    // Single pass over the name rejecting the characters the console
+    // listing cannot show unambiguously (':', '/', '\') and overlong names.
+    static bool isPrintableName(const UNICODE_STRING& name);
+
+private:
+    enum class TermKind {
+        TypeSet,
+        Exact,
+        Prefix,
+        Suffix,
+        Contains,
+        Glob,
+        Regex
+    };
+
+    struct GlobToken {
+        enum Kind { Char, Any, Star, Class } kind;
+        wchar_t value;
+        size_t classIndex;
+    };
+
+    struct CharClass {
+        std::vector<std::pair<wchar_t, wchar_t>> ranges;
+        bool negated;
+    };
+
+    struct Term {
+        TermKind kind;
+        bool negated = false;
+        std::wstring literal;
+        std::vector<std::wstring> types;
+        std::vector<GlobToken> glob;
+        std::vector<CharClass> classes;
+        std::shared_ptr<const std::wregex> regex;
+    };
+
+    static Term compileGlob(const std::wstring& pattern);
+    static bool evaluate(const Term& term, const wchar_t* name, size_t nameLength,
+        const wchar_t* type, size_t typeLength);
+    static bool matchGlob(const Term& term, const wchar_t* name, size_t length);
+
+    std::vector<Term> terms;
+    int depthLimit = 0;
+};
@@ -0,0 +1,127 @@
+#include "ObjectTypeTable.h"
+#include "Metrics.h"
+#include "NameFolding.h"
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <utility>
+
+namespace {
+    // Before Windows 8.1 OBJECT_TYPE_INFORMATION has no TypeIndex and the
+    // types are reported in index order starting here.
+    const USHORT FirstTypeIndex = 2;
+
+    size_t alignEntry(size_t offset) {
+        return (offset + sizeof(ULONG_PTR) - 1) & ~(sizeof(ULONG_PTR) - 1);
+    }
+
+    std::mutex cacheMutex;
+    std::map<std::pair<const NtApi*, LONGLONG>, std::shared_ptr<const ObjectTypeTable>> cache;
+
+    void storeInCache(const NtApi* ntApi, LONGLONG bootTime, std::shared_ptr<const ObjectTypeTable> table) {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        // Tables from earlier sessions of the same backend are dead.
+        for (auto it = cache.begin(); it != cache.end();) {
+            it = it->first.first == ntApi ? cache.erase(it) : std::next(it);
+        }
+        cache.emplace(std::make_pair(ntApi, bootTime), std::move(table));
+    }
+}
+
+std::shared_ptr<const ObjectTypeTable> ObjectTypeTable::current(NtApi& ntApi) {
+    LONGLONG bootTime = queryBootTime(ntApi);
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        auto it = cache.find(std::make_pair(static_cast<const NtApi*>(&ntApi), bootTime));
+        if (it != cache.end()) {
+            return it->second;
+        }
+    }
+
+    auto table = load(ntApi, bootTime);
+    if (NT_SUCCESS(table->status())) {
+        storeInCache(&ntApi, bootTime, table);
+    }
+    return table;
+}
+
+std::shared_ptr<const ObjectTypeTable> ObjectTypeTable::reload(NtApi& ntApi) {
+    LONGLONG bootTime = queryBootTime(ntApi);
+    auto table = load(ntApi, bootTime);
+    if (NT_SUCCESS(table->status())) {
+        storeInCache(&ntApi, bootTime, table);
+    }
+    return table;
+}
+
+LONGLONG ObjectTypeTable::queryBootTime(NtApi& ntApi) {
+    // A clock change moves BootTime too; that only costs one extra load.
+    SYSTEM_TIME_OF_DAY_INFORMATION timeOfDay = {};
+    ULONG returnLength = 0;
+    NTSTATUS status = ntApi.querySystemInformation(static_cast<SYSTEM_INFORMATION_CLASS>(SystemTimeOfDayInformationClass),
+        &timeOfDay, sizeof(timeOfDay), &returnLength);
+    Metrics::instance().ntCall(NT_SUCCESS(status));
+    return NT_SUCCESS(status) ? timeOfDay.BootTime.QuadPart : 0;
+}
+
+std::shared_ptr<const ObjectTypeTable> ObjectTypeTable::load(NtApi& ntApi, LONGLONG bootTime) {
+    std::shared_ptr<ObjectTypeTable> table(new ObjectTypeTable());
+    table->sessionBootTime = bootTime;
+
+    std::vector<BYTE> buffer(32 * 1024);
+    Metrics& metrics = Metrics::instance();
+    NTSTATUS status = STATUS_INFO_LENGTH_MISMATCH;
+    for (int attempt = 0; attempt < 4 && status == STATUS_INFO_LENGTH_MISMATCH; attempt++) {
+        ULONG returnLength = 0;
+        status = ntApi.queryObject(nullptr, static_cast<OBJECT_INFORMATION_CLASS>(ObjectTypesInformation),
+            buffer.data(), static_cast<ULONG>(buffer.size()), &returnLength);
+        metrics.ntCall(NT_SUCCESS(status));
+        if (status == STATUS_INFO_LENGTH_MISMATCH) {
+            buffer.resize(std::max<size_t>(returnLength, buffer.size() * 2));
+        }
+    }
+
+    table->loadStatus = status;
+    if (!NT_SUCCESS(status)) {
+        return table;
+    }
+
+    const BYTE* base = buffer.data();
+    ULONG count = reinterpret_cast<const OBJECT_TYPES_INFORMATION*>(base)->NumberOfTypes;
+    size_t offset = alignEntry(sizeof(OBJECT_TYPES_INFORMATION));
+    table->types.reserve(count);
+
+    for (ULONG i = 0; i < count && offset + sizeof(OBJECT_TYPE_INFORMATION) <= buffer.size(); i++) {
+        const auto* info = reinterpret_cast<const OBJECT_TYPE_INFORMATION*>(base + offset);
+
+        ObjectTypeEntry entry;
+        entry.typeIndex = info->TypeIndex ? info->TypeIndex : static_cast<USHORT>(i + FirstTypeIndex);
+        entry.name.assign(info->TypeName.Buffer, info->TypeName.Length / sizeof(WCHAR));
+        entry.totalObjects = info->TotalNumberOfObjects;
+        entry.totalHandles = info->TotalNumberOfHandles;
+
+        if (entry.typeIndex >= table->byIndex.size()) {
+            table->byIndex.resize(entry.typeIndex + 1, NoEntry);
+        }
+        table->byIndex[entry.typeIndex] = static_cast<uint16_t>(table->types.size());
+        table->types.push_back(std::move(entry));
+
+        offset = alignEntry(offset + sizeof(OBJECT_TYPE_INFORMATION) + info->TypeName.MaximumLength);
+    }
+    return table;
+}
+
+const ObjectTypeEntry* ObjectTypeTable::findByName(std::wstring_view name) const {
+    for (const auto& entry : types) {
+        if (equalsIgnoreCase(entry.name, name)) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+const std::wstring& ObjectTypeTable::name(USHORT typeIndex) const {
+    static const std::wstring unknown;
+    const ObjectTypeEntry* entry = find(typeIndex);
+    return entry ? entry->name : unknown;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include "NtApi.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct ObjectTypeEntry {
+    USHORT typeIndex;
+    std::wstring name;
+    // System-wide totals as of the query that loaded the table.
+    ULONG totalObjects;
+    ULONG totalHandles;
+};
+
+// Maps the ObjectTypeIndex of handle table entries to type names, built from
+// one ObjectTypesInformation query. Type indices only change across reboots,
+// so tables are cached process-wide per backend and boot session and a
+// handle's type is an array lookup.
+class ObjectTypeTable {
+public:
+    // The cached table for the boot session ntApi reports, loaded on first
+    // use. A failed load is returned but not cached.
+    static std::shared_ptr<const ObjectTypeTable> current(NtApi& ntApi = NtApi::system());
+    // Re-queries unconditionally, for fresh totals or a type registered
+    // since the cached table was loaded, and replaces the cached table.
+    static std::shared_ptr<const ObjectTypeTable> reload(NtApi& ntApi = NtApi::system());
+
+    // nullptr for indices the table does not know.
+    const ObjectTypeEntry* find(USHORT typeIndex) const {
+        if (typeIndex < byIndex.size() && byIndex[typeIndex] != NoEntry) {
+            return &types[byIndex[typeIndex]];
+        }
+        return nullptr;
+    }
+    // Case-insensitive; nullptr if no such type.
+    const ObjectTypeEntry* findByName(std::wstring_view name) const;
+    // Empty for unknown indices.
+    const std::wstring& name(USHORT typeIndex) const;
+
+    const std::vector<ObjectTypeEntry>& entries() const { return types; }
+    // Every known index is below this, for sizing per-index arrays.
+    size_t indexLimit() const { return byIndex.size(); }
+    LONGLONG bootTime() const { return sessionBootTime; }
+    NTSTATUS status() const { return loadStatus; }
+
+private:
+    static constexpr uint16_t NoEntry = UINT16_MAX;
+
+    ObjectTypeTable() = default;
+
+    static std::shared_ptr<const ObjectTypeTable> load(NtApi& ntApi, LONGLONG bootTime);
+    static LONGLONG queryBootTime(NtApi& ntApi);
+
+    std::vector<ObjectTypeEntry> types;
+    std::vector<uint16_t> byIndex;
+    LONGLONG sessionBootTime = 0;
+    NTSTATUS loadStatus = STATUS_SUCCESS;
+};
@@ -0,0 +1,144 @@
+#include "OpenFailureTracker.h"
+#include <cwchar>
+#include <iostream>
+#include <sstream>
+
+#ifdef _WIN32
+#include <shlobj.h>
+#pragma comment(lib, "shell32.lib")
+#endif
+
+namespace {
+    // A trailing backslash names the same directory.
+    std::wstring_view trimmed(std::wstring_view path) {
+        if (path.size() > 1 && path.back() == L'\\') {
+            path.remove_suffix(1);
+        }
+        return path;
+    }
+}
+
+OpenFailureTracker::OpenFailureTracker(OpenFailureOptions options) : options(options) {
+}
+
+OpenFailureTracker::~OpenFailureTracker() {
+    flushSummary(true);
+}
+
+bool OpenFailureTracker::knownDenied(std::wstring_view path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (deniedUntil.empty()) {
+        return false;
+    }
+
+    auto it = deniedUntil.find(FoldedName(trimmed(path)));
+    if (it == deniedUntil.end()) {
+        return false;
+    }
+    if (it->second <= Clock::now()) {
+        deniedUntil.erase(it);
+        return false;
+    }
+    skipped++;
+    return true;
+}
+
+void OpenFailureTracker::recordFailure(std::wstring_view path, NTSTATUS status) {
+    std::lock_guard<std::mutex> lock(mutex);
+    failureCounts[status]++;
+    if (status != STATUS_ACCESS_DENIED || options.deniedTtl.count() <= 0) {
+        return;
+    }
+
+    Clock::time_point now = Clock::now();
+    if (deniedUntil.size() >= options.maxDeniedPaths) {
+        pruneLocked(now);
+    }
+    deniedUntil[FoldedName(trimmed(path))] = now + options.deniedTtl;
+}
+
+void OpenFailureTracker::pruneLocked(Clock::time_point now) {
+    for (auto it = deniedUntil.begin(); it != deniedUntil.end();) {
+        it = it->second <= now ? deniedUntil.erase(it) : std::next(it);
+    }
+    if (deniedUntil.size() >= options.maxDeniedPaths) {
+        deniedUntil.clear();
+    }
+}
+
+void OpenFailureTracker::flushSummary(bool force) {
+    std::map<NTSTATUS, uint64_t> counts;
+    uint64_t skips;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (failureCounts.empty() && skipped == 0) {
+            return;
+        }
+        Clock::time_point now = Clock::now();
+        if (!force && summarized && now - lastSummary < options.summaryInterval) {
+            return;
+        }
+        counts.swap(failureCounts);
+        skips = skipped;
+        skipped = 0;
+        lastSummary = now;
+        summarized = true;
+    }
+
+    // Formatted outside the lock; the system message lookup is the slow part.
+    std::wostringstream line;
+    line << L"Directory open failures:";
+    const wchar_t* separator = L" ";
+    for (const auto& [status, count] : counts) {
+        wchar_t code[16];
+        swprintf(code, 16, L"0x%08X", static_cast<ULONG>(status));
+        std::wstring message = statusMessage(status);
+        while (!message.empty() && (message.back() == L'\n' || message.back() == L'\r')) {
+            message.pop_back();
+        }
+        line << separator << count << L" x " << code << L" (" << message << L")";
+        separator = L", ";
+    }
+    if (skips > 0) {
+        line << separator << skips << L" known-denied paths skipped";
+    }
+    line << L"; process privileges: " << processPrivileges();
+    std::wcerr << line.str() << std::endl;
+}
+
+const wchar_t* processPrivileges() {
+#ifdef _WIN32
+    static const wchar_t* privileges = IsUserAnAdmin() ? L"Admin" : L"Non-Admin";
+    return privileges;
+#else
+    return L"Unknown";
+#endif
+}
+
+std::wstring statusMessage(NTSTATUS status) {
+#ifdef _WIN32
+    DWORD errorCode = RtlNtStatusToDosError(status);
+    LPWSTR errorText = nullptr;
+    FormatMessageW(
+        FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_IGNORE_INSERTS,
+        nullptr,
+        errorCode,
+        MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
+        (LPWSTR)&errorText,
+        0,
+        nullptr
+    );
+
+    std::wstring errorMsg = errorText ? errorText : L"Unknown error";
+    LocalFree(errorText);
+    return errorMsg;
+#else
+    switch (status) {
+    case STATUS_ACCESS_DENIED: return L"Access is denied.";
+    case STATUS_OBJECT_NAME_NOT_FOUND: return L"The system cannot find the file specified.";
+    case STATUS_OBJECT_PATH_NOT_FOUND: return L"The system cannot find the path specified.";
+    case STATUS_OBJECT_TYPE_MISMATCH: return L"The object is not a directory.";
+    }
+    return L"Error " + std::to_wstring(static_cast<ULONG>(status));
+#endif
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include "NameFolding.h"
+#include "NtApi.h"
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+struct OpenFailureOptions {
+    // How long a denied path is skipped without asking the kernel again.
+    std::chrono::seconds deniedTtl{ 60 };
+    // Past this, expired entries are dropped, then the whole cache.
+    size_t maxDeniedPaths = 65536;
+    // Summaries are written at most this often; failures in between are
+    // carried over into the next one.
+    std::chrono::seconds summaryInterval{ 5 };
+};
+
+// Failed directory opens of one explorer. Paths refused with
+// STATUS_ACCESS_DENIED are remembered, by folded name, for the TTL, so a
+// walk that runs into thousands of them asks the kernel once per path
+// rather than once per scan. Failures are counted per NTSTATUS and
+// reported as one summary line instead of a block per failure; message
+// text is looked up once per status and summary. Thread-safe.
+class OpenFailureTracker {
+public:
+    explicit OpenFailureTracker(OpenFailureOptions options = {});
+    // Writes any failures not yet summarized.
+    ~OpenFailureTracker();
+
+    // True if path was denied less than the TTL ago; the skip is counted.
+    bool knownDenied(std::wstring_view path);
+    void recordFailure(std::wstring_view path, NTSTATUS status);
+
+    // Writes one line to std::wcerr for the failures since the last
+    // summary, unless there are none or the last one was less than the
+    // summary interval ago and force is false.
+    void flushSummary(bool force = false);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void pruneLocked(Clock::time_point now);
+
+    OpenFailureOptions options;
+    std::mutex mutex;
+    std::unordered_map<FoldedName, Clock::time_point, FoldedNameHash> deniedUntil;
+    std::map<NTSTATUS, uint64_t> failureCounts;
+    uint64_t skipped = 0;
+    Clock::time_point lastSummary;
+    bool summarized = false;
+};
+
+// Whether the process runs with administrator rights. Checked once, the
+// first time it is called; "Unknown" off Windows.
+const wchar_t* processPrivileges();
+
+// The system message for status, e.g. "Access is denied.".
+std::wstring statusMessage(NTSTATUS status);
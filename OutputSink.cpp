@@ -0,0 +1,185 @@
+#include "OutputSink.h"
+#include "Gzip.h"
+#include "Utf8.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+    class ConsoleSink : public OutputSink {
+    public:
+        explicit ConsoleSink(OutputFormat format) : OutputSink(format, 16 * 1024) {}
+        ~ConsoleSink() override { flush(); }
+
+    protected:
+        void write(std::wstring_view text) override {
+            std::wcout.write(text.data(), static_cast<std::streamsize>(text.size()));
+            std::wcout.flush();
+        }
+    };
+
+    class FileSink : public OutputSink {
+    public:
+        FileSink(const std::wstring& target, OutputFormat format)
+            : OutputSink(format, 512 * 1024), outFile{ std::filesystem::path(target), std::ios::binary } {
+            if (!outFile.is_open()) {
+                throw std::runtime_error("Unable to open output file for writing");
+            }
+        }
+
+        ~FileSink() override { flush(); }
+
+        void close() override {
+            flush();
+            if (!outFile.is_open()) {
+                return;
+            }
+            outFile.close();
+            if (outFile.fail()) {
+                throw std::runtime_error("Unable to write output file");
+            }
+        }
+
+    protected:
+        void write(std::wstring_view text) override {
+            encoded.clear();
+            appendUtf8(encoded, text);
+            outFile.write(encoded.data(), static_cast<std::streamsize>(encoded.size()));
+            outFile.flush();
+        }
+
+    private:
+        std::ofstream outFile;
+        std::string encoded;
+    };
+
+    // Each full buffer is encoded here and handed to the compressor
+    // thread, so formatting the next one overlaps compressing this one.
+    class GzipFileSink : public OutputSink {
+    public:
+        GzipFileSink(const std::wstring& target, OutputFormat format)
+            : OutputSink(format, 512 * 1024), output(target) {}
+
+        ~GzipFileSink() override {
+            try {
+                close();
+            }
+            catch (const std::exception&) {
+            }
+        }
+
+        void close() override {
+            flush();
+            output.finish();
+        }
+
+    protected:
+        void write(std::wstring_view text) override {
+            encoded.clear();
+            appendUtf8(encoded, text);
+            output.write(encoded);
+        }
+
+    private:
+        GzipWriter output;
+        std::string encoded;
+    };
+}
+
+std::unique_ptr<OutputSink> OutputSink::console(OutputFormat format) {
+    return std::make_unique<ConsoleSink>(format);
+}
+
+std::unique_ptr<OutputSink> OutputSink::open(const std::wstring& target, OutputFormat format,
+    OutputCompression compression) {
+    if (compression == OutputCompression::Gzip) {
+        return std::make_unique<GzipFileSink>(target, format);
+    }
+    return std::make_unique<FileSink>(target, format);
+}
+
+OutputSink::OutputSink(OutputFormat format, size_t bufferLimit)
+    : outputFormat(format), bufferLimit(bufferLimit) {
+    buffer.reserve(bufferLimit + 1024);
+}
+
+void OutputSink::writeObject(std::wstring_view path, std::wstring_view type) {
+    switch (outputFormat) {
+    case OutputFormat::Tsv:
+        appendEscaped(path);
+        buffer += L'\t';
+        appendEscaped(type);
+        buffer += L'\n';
+        break;
+
+    case OutputFormat::Ndjson:
+        buffer += L"{\"path\":\"";
+        appendEscaped(path);
+        buffer += L"\",\"type\":\"";
+        appendEscaped(type);
+        buffer += L"\"}\n";
+        break;
+
+    case OutputFormat::Human:
+    default:
+        buffer += L"Object: ";
+        buffer += path;
+        buffer += L", Type: ";
+        buffer += type;
+        buffer += L'\n';
+        break;
+    }
+
+    if (buffer.size() >= bufferLimit) {
+        flush();
+    }
+}
+
+void OutputSink::writeText(std::wstring_view text) {
+    if (outputFormat == OutputFormat::Human) {
+        buffer += text;
+        if (buffer.size() >= bufferLimit) {
+            flush();
+        }
+    }
+}
+
+void OutputSink::flush() {
+    if (!buffer.empty()) {
+        write(buffer);
+        buffer.clear();
+    }
+}
+
+void OutputSink::close() {
+    flush();
+}
+
+void OutputSink::appendEscaped(std::wstring_view value) {
+    for (wchar_t c : value) {
+        switch (c) {
+        case L'\t': buffer += L"\\t"; break;
+        case L'\n': buffer += L"\\n"; break;
+        case L'\r': buffer += L"\\r"; break;
+        // Paths are full of backslashes; only JSON needs them escaped.
+        case L'\\':
+            buffer += outputFormat == OutputFormat::Ndjson ? L"\\\\" : L"\\";
+            break;
+        case L'"':
+            buffer += outputFormat == OutputFormat::Ndjson ? L"\\\"" : L"\"";
+            break;
+        default:
+            if (c < 0x20) {
+                static const wchar_t hex[] = L"0123456789abcdef";
+                buffer += L"\\u00";
+                buffer += hex[(c >> 4) & 0xF];
+                buffer += hex[c & 0xF];
+            }
+            else {
+                buffer += c;
+            }
+            break;
+        }
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <string_view>
+
+enum class OutputFormat {
+    Human,
+    Tsv,
+    Ndjson
+};
+
+enum class OutputCompression {
+    None,
+    // gzip, compressed on a separate thread while output is produced.
+    Gzip
+};
+
+// Buffered destination for object listings. Records are formatted into an
+// in-memory buffer and written out only when it fills up or on flush(), so
+// large listings are not bound by per-line console writes.
+class OutputSink {
+public:
+    virtual ~OutputSink() = default;
+
+    // Console output (wcout) in the given format.
+    static std::unique_ptr<OutputSink> console(OutputFormat format = OutputFormat::Human);
+    // UTF-8 output to a file or named pipe. Throws std::runtime_error if the
+    // target cannot be opened.
+    static std::unique_ptr<OutputSink> open(const std::wstring& target, OutputFormat format,
+        OutputCompression compression = OutputCompression::None);
+
+    virtual void writeObject(std::wstring_view path, std::wstring_view type);
+    // Free text for the human format; ignored by the machine formats so
+    // their output stays parseable.
+    void writeText(std::wstring_view text);
+    void flush();
+    // Flushes and completes the output. Throws std::runtime_error if it
+    // could not be written; the destructor closes too but drops errors.
+    virtual void close();
+
+    OutputFormat format() const { return outputFormat; }
+
+protected:
+    OutputSink(OutputFormat format, size_t bufferLimit);
+
+    virtual void write(std::wstring_view text) = 0;
+
+private:
+    void appendEscaped(std::wstring_view value);
+
+    OutputFormat outputFormat;
+    size_t bufferLimit;
+    std::wstring buffer;
+};
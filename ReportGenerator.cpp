@@ -1,124 +1,682 @@
 ﻿#include "ReportGenerator.h"
-#include <fstream>
+#include "DependencyGraph.h"
+#include "HtmlReportWriter.h"
+#include "Metrics.h"
+#include "NameFolding.h"
+#include "Timestamp.h"
+#include <condition_variable>
+#include <cstring>
 #include <sstream>
 #include <iomanip>
+#include <mutex>
 #include <stdexcept>
+#include <unordered_set>
 
-ReportGenerator::ReportGenerator() {
-    objectAnalyzer = std::make_unique<ObjectAnalyzer>();
-    objectMonitor = std::make_unique<ObjectMonitor>();
+ReportGenerator::ReportGenerator(NtApi& ntApi, ThreadPool& pool) : ntApi(ntApi), pool(pool) {
+    objectAnalyzer = std::make_unique<ObjectAnalyzer>(ntApi, pool);
+    objectMonitor = std::make_unique<ObjectMonitor>(ntApi);
+    objectExplorer = std::make_unique<ObjectManagerExplorer>(ntApi);
+}
+
+namespace {
+    // How often a waiting report rechecks cancellation and timeouts.
+    const std::chrono::milliseconds SectionPollInterval(50);
+
+    // Entries in each ranking of the dependency analytics.
+    const size_t TopDependencyNodes = 10;
+
+    // Feeds a recursive listing straight into a report table.
+    class ReportTableSink : public OutputSink {
+    public:
+        ReportTableSink(HtmlReportWriter& writer, size_t table)
+            : OutputSink(OutputFormat::Tsv, 0), writer(writer), table(table) {}
+
+        void writeObject(std::wstring_view path, std::wstring_view type) override {
+            writer.addRow(table, { path, type });
+        }
+
+    protected:
+        void write(std::wstring_view) override {}
+
+    private:
+        HtmlReportWriter& writer;
+        size_t table;
+    };
+
+    // Collects a recursive listing for a snapshot, reading the target of
+    // each symbolic link as it is listed.
+    class SnapshotSink : public OutputSink {
+    public:
+        SnapshotSink(NtApi& ntApi, std::vector<SnapshotObject>& objects)
+            : OutputSink(OutputFormat::Tsv, 0), ntApi(ntApi), inspector(ntApi), objects(objects) {}
+
+        void writeObject(std::wstring_view path, std::wstring_view type) override {
+            objects.push_back({ std::wstring(path), std::wstring(type), std::wstring() });
+            if (type != L"SymbolicLink") {
+                return;
+            }
+
+            HANDLE link;
+            if (NT_SUCCESS(inspector.open(objects.back().path, type, link))) {
+                inspector.queryLinkTarget(link, linkBuffer, objects.back().detail);
+                ntApi.close(link);
+            }
+        }
+
+    protected:
+        void write(std::wstring_view) override {}
+
+    private:
+        NtApi& ntApi;
+        ObjectInspector inspector;
+        std::vector<WCHAR> linkBuffer;
+        std::vector<SnapshotObject>& objects;
+    };
+
+    // Set of the paths of a recursive listing, matched case-insensitively.
+    class PathSetSink : public OutputSink {
+    public:
+        PathSetSink() : OutputSink(OutputFormat::Tsv, 0) {}
+
+        void writeObject(std::wstring_view path, std::wstring_view) override { add(path); }
+
+        void add(std::wstring_view path) { paths.emplace(path); }
+        bool contains(const FoldedName& path) const { return paths.count(path) != 0; }
+
+    protected:
+        void write(std::wstring_view) override {}
+
+    private:
+        std::unordered_set<FoldedName, FoldedNameHash> paths;
+    };
+
+    enum class SectionOutcome {
+        Complete,
+        TimedOut,
+        Cancelled,
+        // Cancelled before a worker picked it up.
+        Skipped
+    };
+
+    // Shared between the waiting report and the pool task. A section that
+    // has not started when the report gives up on it is marked done, and the
+    // task then returns without touching the generator.
+    struct SectionTask {
+        std::mutex mutex;
+        std::condition_variable finished;
+        bool started = false;
+        bool done = false;
+        std::chrono::steady_clock::time_point startedAt;
+        std::atomic<bool> stop{ false };
+        SectionOutcome outcome = SectionOutcome::Complete;
+        std::wstring output;
+    };
+
+    std::wstring widen(const char* text) {
+        return std::wstring(text, text + strlen(text));
+    }
 }
 
 ReportGenerator::~ReportGenerator() = default;
 
 void ReportGenerator::generateReport(const ReportConfig& config) {
+    cancelRequested.store(false);
+    std::wstring targetPath = config.targetDirectory.empty() ? L"\\BaseNamedObjects" : config.targetDirectory;
+
+    if (!config.baselinePath.empty()) {
+        ReportSnapshot current = captureTarget(targetPath).snapshot;
+        generateDeltaReport(config, current);
+        if (!config.snapshotPath.empty()) {
+            current.save(config.snapshotPath, config.compression);
+        }
+        return;
+    }
+
+    std::unique_ptr<TargetCapture> capture;
+    if (!config.snapshotPath.empty()) {
+        capture = std::make_unique<TargetCapture>(captureTarget(targetPath));
+    }
+
+    if (config.format == ReportFormat::InteractiveHtml) {
+        generateInteractiveReport(config, targetPath, capture.get());
+    }
+    else {
+        generateTextReport(config, targetPath, capture.get());
+    }
+
+    if (capture) {
+        capture->snapshot.save(config.snapshotPath, config.compression);
+    }
+}
+
+void ReportGenerator::generateTextReport(const ReportConfig& config, const std::wstring& targetPath,
+    const TargetCapture* capture) {
+    // Sections are written out as they complete, so compressing the early
+    // ones overlaps rendering the rest.
+    std::unique_ptr<OutputSink> output;
+    if (!config.outputPath.empty()) {
+        output = openReportFile(config);
+    }
+    auto emit = [&](std::wstring_view text) {
+        if (output) {
+            writeReportText(*output, config.format, text);
+        }
+    };
+
+    TimestampFormatter timestamps;
+    TimestampFormatter::Buffer generated;
+    std::wstring header = L"Windows Object Manager Analysis Report\nGenerated: ";
+    header += timestamps.now(generated);
+    header += L"\n\nTarget Directory: " + targetPath + L"\n\n";
+    emit(header);
+
+    std::vector<ReportSection> sections;
+    sections.push_back({ L"Object Type Statistics", MetricHistogram::ReportTypeStatistics,
+        [this, targetPath](std::wstring& out, const std::atomic<bool>& stop) {
+            renderTypeStatistics(targetPath, out, stop);
+        } });
+    sections.push_back({ L"Object Dependencies", MetricHistogram::ReportDependencies,
+        [this, targetPath, capture](std::wstring& out, const std::atomic<bool>& stop) {
+            renderDependencies(targetPath, capture, out, stop);
+        } });
+    if (config.includeStatistics) {
+        sections.push_back({ L"Object Statistics", MetricHistogram::ReportStatistics,
+            [this, targetPath](std::wstring& out, const std::atomic<bool>& stop) {
+                renderStatistics(targetPath, out, stop);
+            } });
+    }
+    runSections(sections, config.sectionTimeout, emit);
+
+    if (output) {
+        ScopedMetricTimer saveTimer(MetricHistogram::ReportSave);
+        closeReportFile(*output, config.format);
+    }
+}
+
+ReportGenerator::TargetCapture ReportGenerator::captureTarget(const std::wstring& targetPath) {
+    TargetCapture capture;
+    ReportSnapshot& snapshot = capture.snapshot;
+    snapshot.target = targetPath;
+    snapshot.takenAt = wallClockMillis(currentTick());
+
+    // Not cancellable, the graph included: a partial listing saved as a
+    // baseline would show up as mass removals in the next delta, and a
+    // partial graph as removed dependencies.
+    SnapshotSink objects(ntApi, snapshot.objects);
+    objectExplorer->collectObjects(targetPath, objects);
+
+    // Link edges come from the targets read during the listing, which
+    // covers every subdirectory; the graph only supplies the other kinds.
+    for (const auto& object : snapshot.objects) {
+        if (!object.detail.empty()) {
+            snapshot.dependencies.push_back({ object.path, object.detail, L"SymbolicLink" });
+        }
+    }
+    capture.dependencies = objectAnalyzer->buildDependencyGraph(targetPath, nullptr);
+    for (const auto& dep : capture.dependencies) {
+        if (dep.dependencyType == L"SymbolicLink") {
+            continue;
+        }
+        snapshot.dependencies.push_back({ dep.sourceObject, dep.targetObject, dep.dependencyType });
+    }
+    snapshot.finalize();
+    return capture;
+}
+
+void ReportGenerator::generateDeltaReport(const ReportConfig& config, const ReportSnapshot& current) {
+    SnapshotReader baseline(config.baselinePath);
+    SnapshotDelta delta = compareSnapshots(baseline, current);
+
     std::wstringstream report;
+    TimestampFormatter timestamps;
+    TimestampFormatter::Buffer stamp;
+
+    report << L"Windows Object Manager Delta Report\n";
+    report << L"Generated: " << timestamps.now(stamp) << L"\n\n";
+    report << L"Target Directory: " << current.target << L"\n";
+    report << L"Baseline: " << config.baselinePath << L" (taken "
+        << timestamps.formatMillis(baseline.takenAt(), stamp) << L")\n";
+    if (baseline.target() != current.target) {
+        report << L"Warning: the baseline was taken of " << baseline.target() << L"\n";
+    }
 
-    report << L"Windows Object Manager Analysis Report\n";
-    report << L"Generated: " << getCurrentTimestamp() << L"\n\n";
+    report << L"\n=== Summary ===\n\n"
+        << L"Added: " << delta.added.size() << L"\n"
+        << L"Removed: " << delta.removed.size() << L"\n"
+        << L"Changed: " << delta.changed.size() << L"\n"
+        << L"Unchanged: " << delta.unchanged << L"\n\n";
+
+    if (!delta.typeCounts.empty()) {
+        report << L"=== Object Type Count Changes ===\n\n";
+        for (const auto& [type, counts] : delta.typeCounts) {
+            long long difference = static_cast<long long>(counts.after) - static_cast<long long>(counts.before);
+            report << type << L": " << counts.before << L" -> " << counts.after
+                << L" (" << (difference > 0 ? L"+" : L"") << difference << L")\n";
+        }
+        report << L"\n";
+    }
 
-    std::wstring targetPath = config.targetDirectory.empty() ? L"\\BaseNamedObjects" : config.targetDirectory;
-    report << L"Target Directory: " << targetPath << L"\n\n";
+    if (!delta.added.empty()) {
+        report << L"=== Added Objects ===\n\n";
+        for (const auto& object : delta.added) {
+            report << L"+ " << object.path << L" (" << object.type << L")\n";
+        }
+        report << L"\n";
+    }
 
-    try {
-        auto typeStats = objectAnalyzer->getTypeStatistics(targetPath);
-        report << L"=== Object Type Statistics ===\n\n";
+    if (!delta.removed.empty()) {
+        report << L"=== Removed Objects ===\n\n";
+        for (const auto& object : delta.removed) {
+            report << L"- " << object.path << L" (" << object.type << L")\n";
+        }
+        report << L"\n";
+    }
 
-        size_t totalCount = 0;
-        for (const auto& [type, count] : typeStats) {
-            totalCount += count;
+    if (!delta.changed.empty()) {
+        report << L"=== Changed Objects ===\n\n";
+        for (const auto& [before, after] : delta.changed) {
+            report << L"~ " << after.path << L"\n";
+            if (before.type != after.type) {
+                report << L"  Type: " << before.type << L" -> " << after.type << L"\n";
+            }
+            if (before.detail != after.detail) {
+                report << L"  Link Target: " << before.detail << L" -> " << after.detail << L"\n";
+            }
         }
+        report << L"\n";
+    }
 
-        for (const auto& [type, count] : typeStats) {
-            double percentage = (count * 100.0) / totalCount;
-            report << type << L": "
-                << count << L" objects ("
-                << std::fixed << std::setprecision(1) << percentage << L"%)\n";
-        }
-        report << L"\nTotal Objects: " << totalCount << L"\n\n";
-
-        report << L"=== Object Dependencies ===\n\n";
-        auto dependencies = objectAnalyzer->buildDependencyGraph(targetPath);
-
-        if (!dependencies.empty()) {
-            std::map<std::wstring, std::vector<std::wstring>> dependencyMap;
-            for (const auto& dep : dependencies) {
-                if (dep.sourceObject.find(targetPath) == 0 &&
-                    dep.targetObject.find(targetPath) == 0) {
-                    dependencyMap[dep.sourceObject].push_back(dep.targetObject);
+    if (!delta.addedDependencies.empty()) {
+        report << L"=== New Dependencies ===\n\n";
+        for (const auto& dep : delta.addedDependencies) {
+            report << dep.source << L" -> " << dep.target << L" (" << dep.kind << L")\n";
+        }
+        report << L"\n";
+    }
+
+    if (!delta.removedDependencies.empty()) {
+        report << L"=== Removed Dependencies ===\n\n";
+        for (const auto& dep : delta.removedDependencies) {
+            report << dep.source << L" -> " << dep.target << L" (" << dep.kind << L")\n";
+        }
+        report << L"\n";
+    }
+
+    if (!config.outputPath.empty()) {
+        saveToFile(config, report.str());
+    }
+}
+
+void ReportGenerator::runSections(const std::vector<ReportSection>& sections, std::chrono::milliseconds timeout,
+    const std::function<void(std::wstring_view)>& emit) {
+    std::vector<std::shared_ptr<SectionTask>> tasks;
+    tasks.reserve(sections.size());
+
+    for (const auto& section : sections) {
+        auto task = std::make_shared<SectionTask>();
+        tasks.push_back(task);
+        pool.submit([task, &section]() {
+            {
+                std::lock_guard<std::mutex> lock(task->mutex);
+                if (task->done) {
+                    return;
                 }
+                task->started = true;
+                task->startedAt = std::chrono::steady_clock::now();
             }
 
-            for (const auto& [source, targets] : dependencyMap) {
-                std::wstring shortSource = source.substr(targetPath.length());
-                report << L"Source: " << shortSource << L"\n";
-                for (size_t i = 0; i < targets.size(); ++i) {
-                    std::wstring shortTarget = targets[i].substr(targetPath.length());
-                    if (i == targets.size() - 1) {
-                        report << L"└─── " << shortTarget << L"\n";
-                    }
-                    else {
-                        report << L"├─── " << shortTarget << L"\n";
-                    }
+            std::wstring output;
+            try {
+                section.render(output, task->stop);
+            }
+            catch (const std::exception& e) {
+                output += L"Error during analysis: " + widen(e.what()) + L"\n";
+            }
+
+            std::lock_guard<std::mutex> lock(task->mutex);
+            Metrics::instance().record(section.histogram, std::chrono::steady_clock::now() - task->startedAt);
+            task->output = std::move(output);
+            task->done = true;
+            task->finished.notify_all();
+        });
+    }
+
+    // Sections are awaited in report order; a section's timeout counts from
+    // when a worker started it. Once stopped, a running section returns
+    // after its current NT call, so the wait below always ends.
+    for (size_t i = 0; i < sections.size(); i++) {
+        SectionTask& task = *tasks[i];
+        std::unique_lock<std::mutex> lock(task.mutex);
+        while (!task.done) {
+            if (!task.stop.load()) {
+                if (cancelRequested.load()) {
+                    task.outcome = SectionOutcome::Cancelled;
+                    task.stop.store(true);
                 }
-                report << L"\n";
+                else if (timeout.count() > 0 && task.started &&
+                    std::chrono::steady_clock::now() - task.startedAt >= timeout) {
+                    task.outcome = SectionOutcome::TimedOut;
+                    task.stop.store(true);
+                }
+            }
+            if (task.stop.load() && !task.started) {
+                task.outcome = SectionOutcome::Skipped;
+                task.done = true;
+                break;
             }
+            task.finished.wait_for(lock, SectionPollInterval);
         }
-        else {
-            report << L"No dependencies found in target directory\n\n";
+
+        std::wstring text = L"=== " + sections[i].title + L" ===\n\n";
+        text += task.output;
+        switch (task.outcome) {
+        case SectionOutcome::Complete:
+            break;
+        case SectionOutcome::TimedOut:
+            text += L"[Section stopped after " + std::to_wstring(timeout.count()) + L" ms; the output above is partial]\n\n";
+            break;
+        case SectionOutcome::Cancelled:
+            text += L"[Report cancelled; the output above is partial]\n\n";
+            break;
+        case SectionOutcome::Skipped:
+            text += L"[Report cancelled before this section ran]\n\n";
+            break;
         }
+        lock.unlock();
+        emit(text);
+    }
+}
 
-        if (config.includeStatistics) {
-            report << L"=== Object Statistics ===\n\n";
+void ReportGenerator::renderTypeStatistics(const std::wstring& targetPath, std::wstring& out,
+    const std::atomic<bool>& stop) {
+    std::wostringstream section;
+    auto typeStats = objectAnalyzer->getTypeStatistics(targetPath, &stop);
 
-            auto stats = objectAnalyzer->getTypeStatistics(targetPath);
-            for (const auto& [type, count] : stats) {
-                report << L"Type: " << type << L"\n"
-                    << L"├─ Count: " << count << L" objects\n"
-                    << L"└─ Percentage: " << std::fixed << std::setprecision(1)
-                    << (count * 100.0 / totalCount) << L"%\n\n";
+    size_t totalCount = 0;
+    for (const auto& [type, count] : typeStats) {
+        totalCount += count;
+    }
+
+    for (const auto& [type, count] : typeStats) {
+        double percentage = (count * 100.0) / totalCount;
+        section << type << L": "
+            << count << L" objects ("
+            << std::fixed << std::setprecision(1) << percentage << L"%)\n";
+    }
+    section << L"\nTotal Objects: " << totalCount << L"\n\n";
+    out = section.str();
+}
+
+void ReportGenerator::renderDependencies(const std::wstring& targetPath, const TargetCapture* capture,
+    std::wstring& out, const std::atomic<bool>& stop) {
+    std::wostringstream section;
+    std::vector<ObjectDependency> built;
+    if (!capture) {
+        built = objectAnalyzer->buildDependencyGraph(targetPath, &stop);
+    }
+    const auto& dependencies = capture ? capture->dependencies : built;
+    if (dependencies.empty()) {
+        section << L"No dependencies found in target directory\n\n";
+        out = section.str();
+        return;
+    }
+
+    DependencyGraph graph(dependencies);
+    built.clear();
+    built.shrink_to_fit();
+
+    // Names inside the target are shown relative to it; Process: and
+    // \Device targets stay as they are.
+    auto shortName = [&](DependencyGraph::Node node) -> std::wstring_view {
+        std::wstring_view name = graph.name(node);
+        if (name.size() > targetPath.size() && startsWithIgnoreCase(name, targetPath) &&
+            (targetPath.back() == L'\\' || name[targetPath.size()] == L'\\')) {
+            return name.substr(targetPath.size());
+        }
+        return name;
+    };
+
+    // Sources with the most dependencies first.
+    for (DependencyGraph::Node source : graph.topFanOut(graph.nodeCount())) {
+        section << L"Source: " << shortName(source) << L"\n";
+        for (size_t edge = graph.firstEdge(source); edge < graph.endEdge(source); edge++) {
+            section << (edge + 1 == graph.endEdge(source) ? L"└─── " : L"├─── ")
+                << shortName(graph.edgeTarget(edge)) << L" (" << graph.edgeKind(edge) << L")\n";
+        }
+        section << L"\n";
+    }
+
+    section << L"--- Dependency Analytics ---\n\n"
+        << L"Objects: " << graph.nodeCount() << L", Dependencies: " << graph.edgeCount() << L"\n\n";
+
+    auto cycles = graph.cycles();
+    section << L"Cycles: " << cycles.size() << L"\n";
+    for (const auto& cycle : cycles) {
+        section << L"  " << cycle.size() << L" object(s):";
+        for (DependencyGraph::Node node : cycle) {
+            section << L" " << shortName(node);
+        }
+        section << L"\n";
+    }
+
+    section << L"\nMost depended on:\n";
+    for (DependencyGraph::Node node : graph.topFanIn(TopDependencyNodes)) {
+        section << L"  " << shortName(node) << L": " << graph.fanIn(node) << L"\n";
+    }
+    section << L"\nMost dependencies:\n";
+    for (DependencyGraph::Node node : graph.topFanOut(TopDependencyNodes)) {
+        section << L"  " << shortName(node) << L": " << graph.fanOut(node) << L"\n";
+    }
+
+    // The orphan check lists the whole tree; a stopped section ends here,
+    // and one stopped during the listing would report links as orphaned
+    // only because their targets were not reached.
+    if (stop) {
+        out = section.str();
+        return;
+    }
+
+    // Only targets inside the listed tree can be checked; links leaving it
+    // are assumed to resolve.
+    PathSetSink listed;
+    listed.add(targetPath);
+    if (capture) {
+        for (const auto& object : capture->snapshot.objects) {
+            listed.add(object.path);
+        }
+    }
+    else {
+        objectExplorer->collectObjects(targetPath, listed, &stop);
+        if (stop) {
+            out = section.str();
+            return;
+        }
+    }
+    // Each link target is folded once, for both the prefix test and the
+    // lookup.
+    FoldedName scope(targetPath);
+    FoldedName key;
+    auto orphans = graph.orphanedLinks([&](const std::wstring& target) {
+        key.assign(target);
+        return !scope.isPathPrefixOf(key) || listed.contains(key);
+    });
+    section << L"\nOrphaned links: " << orphans.size() << L"\n";
+    for (const auto& [link, target] : orphans) {
+        section << L"  " << shortName(link) << L" -> " << graph.name(target) << L"\n";
+    }
+
+    auto processes = graph.sectionsPerProcess();
+    if (!processes.empty()) {
+        section << L"\nShared sections per process:\n";
+        for (const auto& [process, sections] : processes) {
+            section << L"  " << graph.name(process) << L": " << sections << L"\n";
+        }
+    }
+    section << L"\n";
+    out = section.str();
+}
+
+void ReportGenerator::renderStatistics(const std::wstring& targetPath, std::wstring& out,
+    const std::atomic<bool>& stop) {
+    std::wostringstream section;
+    auto stats = objectAnalyzer->getTypeStatistics(targetPath, &stop);
+
+    size_t totalCount = 0;
+    for (const auto& [type, count] : stats) {
+        totalCount += count;
+    }
+
+    for (const auto& [type, count] : stats) {
+        section << L"Type: " << type << L"\n"
+            << L"├─ Count: " << count << L" objects\n"
+            << L"└─ Percentage: " << std::fixed << std::setprecision(1)
+            << (count * 100.0 / totalCount) << L"%\n\n";
+    }
+    out = section.str();
+}
+
+void ReportGenerator::generateInteractiveReport(const ReportConfig& config, const std::wstring& targetPath,
+    const TargetCapture* capture) {
+    if (config.outputPath.empty()) {
+        return;
+    }
+
+    HtmlReportWriter writer(config.outputPath, L"Windows Object Manager Report", config.sidecarData);
+    TimestampFormatter timestamps;
+    TimestampFormatter::Buffer generated;
+
+    std::wstring summary = L"Windows Object Manager Analysis Report\nGenerated: ";
+    summary += timestamps.now(generated);
+    summary += L"\nTarget Directory: " + targetPath + L"\n";
+
+    try {
+        auto phaseStart = std::chrono::steady_clock::now();
+        auto typeStats = objectAnalyzer->getTypeStatistics(targetPath, &cancelRequested);
+        size_t totalCount = 0;
+        for (const auto& [type, count] : typeStats) {
+            totalCount += count;
+        }
+
+        size_t typeTable = writer.addTable(L"Object Types", {
+            { L"Type" }, { L"Objects", ReportColumnKind::Number }, { L"Percentage", ReportColumnKind::Number } });
+        wchar_t percentage[32];
+        for (const auto& [type, count] : typeStats) {
+            swprintf(percentage, 32, L"%.1f", count * 100.0 / totalCount);
+            writer.addRow(typeTable, { type, std::to_wstring(count), percentage });
+        }
+        summary += L"Total Objects: " + std::to_wstring(totalCount) + L"\n";
+        Metrics::instance().record(MetricHistogram::ReportTypeStatistics, std::chrono::steady_clock::now() - phaseStart);
+
+        size_t objectTable = writer.addTable(L"Objects", { { L"Path" }, { L"Type", ReportColumnKind::Dictionary } });
+        if (capture) {
+            for (const auto& object : capture->snapshot.objects) {
+                writer.addRow(objectTable, { object.path, object.type });
             }
         }
+        else {
+            // Streamed from the enumeration; the object list is never held in memory.
+            ReportTableSink objects(writer, objectTable);
+            objectExplorer->collectObjects(targetPath, objects, &cancelRequested);
+        }
+
+        phaseStart = std::chrono::steady_clock::now();
+        size_t dependencyTable = writer.addTable(L"Dependencies", {
+            { L"Source" }, { L"Target" }, { L"Kind", ReportColumnKind::Dictionary } });
+        std::vector<ObjectDependency> built;
+        if (!capture) {
+            built = objectAnalyzer->buildDependencyGraph(targetPath, &cancelRequested);
+        }
+        for (const auto& dep : capture ? capture->dependencies : built) {
+            writer.addRow(dependencyTable, { dep.sourceObject, dep.targetObject, dep.dependencyType });
+        }
+        Metrics::instance().record(MetricHistogram::ReportDependencies, std::chrono::steady_clock::now() - phaseStart);
     }
     catch (const std::exception& e) {
-        report << L"Error during analysis: "
-            << std::wstring(e.what(), e.what() + strlen(e.what())) << L"\n";
+        summary += L"Error during analysis: ";
+        summary += widen(e.what());
+        summary += L"\n";
     }
 
-    if (!config.outputPath.empty()) {
-        saveToFile(config.outputPath, config.format, report.str());
+    ScopedMetricTimer saveTimer(MetricHistogram::ReportSave);
+    writer.addSummary(summary);
+    writer.finish();
+}
+
+std::unique_ptr<OutputSink> ReportGenerator::openReportFile(const ReportConfig& config) {
+    auto output = OutputSink::open(config.outputPath, OutputFormat::Human, config.compression);
+
+    switch (config.format) {
+    case ReportFormat::HTML:
+    case ReportFormat::InteractiveHtml:
+        output->writeText(L"<!DOCTYPE html>\n"
+            L"<html>\n<head>\n"
+            L"<meta charset=\"utf-8\">\n"
+            L"<title>Windows Object Manager Report</title>\n"
+            L"<style>\n"
+            L"body { font-family: Arial, sans-serif; margin: 40px; }\n"
+            L"h1 { color: #333; }\n"
+            L"pre { background-color: #f5f5f5; padding: 10px; }\n"
+            L"</style>\n"
+            L"</head>\n<body>\n"
+            L"<h1>Windows Object Manager Report</h1>\n"
+            L"<pre>");
+        break;
+
+    case ReportFormat::XML: {
+        TimestampFormatter timestamps;
+        TimestampFormatter::Buffer generated;
+        std::wstring header = L"<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<report>\n  <timestamp>";
+        header += timestamps.now(generated);
+        header += L"</timestamp>\n  <content>";
+        output->writeText(header);
+        break;
     }
+    }
+    return output;
 }
 
-void ReportGenerator::saveToFile(const std::wstring& filePath, ReportFormat format, const std::wstring& content) {
-    std::wofstream outFile(filePath);
-    if (!outFile.is_open()) {
-        throw std::runtime_error("Unable to open file for writing");
+void ReportGenerator::writeReportText(OutputSink& output, ReportFormat format, std::wstring_view text) {
+    if (format == ReportFormat::XML) {
+        output.writeText(escapeXmlString(text));
+    }
+    else {
+        output.writeText(text);
     }
+}
 
+void ReportGenerator::closeReportFile(OutputSink& output, ReportFormat format) {
     switch (format) {
     case ReportFormat::HTML:
-        outFile << generateHtmlReport(content);
+    case ReportFormat::InteractiveHtml:
+        output.writeText(L"</pre>\n</body>\n</html>");
         break;
 
     case ReportFormat::XML:
-        outFile << generateXmlReport(content);
+        output.writeText(L"</content>\n</report>");
         break;
     }
+    output.close();
+}
 
-    outFile.close();
+void ReportGenerator::saveToFile(const ReportConfig& config, const std::wstring& content) {
+    ScopedMetricTimer saveTimer(MetricHistogram::ReportSave);
+    auto output = openReportFile(config);
+    writeReportText(*output, config.format, content);
+    closeReportFile(*output, config.format);
 }
 
 std::wstring ReportGenerator::formatStatistics(const std::map<std::wstring, ObjectStatistics>& stats) {
     std::wstringstream ss;
     ss << L"\n=== Object Statistics ===\n\n";
 
+    TimestampFormatter timestamps;
+    TimestampFormatter::Buffer lastAccess;
     for (const auto& [name, stat] : stats) {
         ss << L"Object: " << name << L"\n"
             << L"  Handle Count: " << stat.handleCount << L"\n"
             << L"  Reference Count: " << stat.referenceCount << L"\n"
             << L"  Memory Usage: " << formatBytes(stat.memoryUsage) << L"\n"
-            << L"  Last Access: " << formatTimestamp(stat.lastAccessTime) << L"\n\n";
+            << L"  Last Access: " << timestamps.format(stat.lastAccessTime, lastAccess) << L"\n\n";
     }
 
     return ss.str();
@@ -148,59 +706,6 @@ std::wstring ReportGenerator::formatTypeStatistics(const std::map<std::wstring,
     return ss.str();
 }
 
-std::wstring ReportGenerator::generateHtmlReport(const std::wstring& content) {
-    std::wstringstream ss;
-    ss << L"<!DOCTYPE html>\n"
-        << L"<html>\n<head>\n"
-        << L"<title>Windows Object Manager Report</title>\n"
-        << L"<style>\n"
-        << L"body { font-family: Arial, sans-serif; margin: 40px; }\n"
-        << L"h1 { color: #333; }\n"
-        << L"pre { background-color: #f5f5f5; padding: 10px; }\n"
-        << L"</style>\n"
-        << L"</head>\n<body>\n"
-        << L"<h1>Windows Object Manager Report</h1>\n"
-        << L"<pre>" << content << L"</pre>\n"
-        << L"</body>\n</html>";
-    return ss.str();
-}
-
-std::wstring ReportGenerator::generateXmlReport(const std::wstring& content) {
-    std::wstringstream ss;
-    ss << L"<?xml version=\"1.0\" encoding=\"UTF-16\"?>\n"
-        << L"<report>\n"
-        << L"  <timestamp>" << getCurrentTimestamp() << L"</timestamp>\n"
-        << L"  <content>" << escapeXmlString(content) << L"</content>\n"
-        << L"</report>";
-    return ss.str();
-}
-
-std::wstring ReportGenerator::getCurrentTimestamp() {
-    SYSTEMTIME st;
-    GetSystemTime(&st);
-    std::wstringstream ss;
-    ss << std::setfill(L'0')
-        << st.wYear << L"-"
-        << std::setw(2) << st.wMonth << L"-"
-        << std::setw(2) << st.wDay << L" "
-        << std::setw(2) << st.wHour << L":"
-        << std::setw(2) << st.wMinute << L":"
-        << std::setw(2) << st.wSecond;
-    return ss.str();
-}
-
-std::wstring ReportGenerator::formatTimestamp(const SYSTEMTIME& st) {
-    std::wstringstream ss;
-    ss << std::setfill(L'0')
-        << st.wYear << L"-"
-        << std::setw(2) << st.wMonth << L"-"
-        << std::setw(2) << st.wDay << L" "
-        << std::setw(2) << st.wHour << L":"
-        << std::setw(2) << st.wMinute << L":"
-        << std::setw(2) << st.wSecond;
-    return ss.str();
-}
-
 std::wstring ReportGenerator::formatBytes(SIZE_T bytes) {
     const wchar_t* units[] = { L"B", L"KB", L"MB", L"GB" };
     int unitIndex = 0;
@@ -239,7 +744,7 @@ std::wstring ReportGenerator::escapeJsonString(const std::wstring& input) {
     return ss.str();
 }
 
-std::wstring ReportGenerator::escapeXmlString(const std::wstring& input) {
+std::wstring ReportGenerator::escapeXmlString(std::wstring_view input) {
     std::wstringstream ss;
     for (wchar_t c : input) {
         switch (c) {
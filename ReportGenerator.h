@@ -1,13 +1,23 @@
 #pragma once
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
+#include "Metrics.h"
 #include "ObjectMonitor.h"
 #include "ObjectAnalyzer.h"
+#include "ObjectManagerExplorer.h"
+#include "OutputSink.h"
+#include "ReportSnapshot.h"
 
 enum class ReportFormat {
     HTML,
-    XML
+    XML,
+    // Every object of the target tree in virtualized, sortable tables.
+    InteractiveHtml
 };
 
 struct ReportConfig {
@@ -16,31 +26,89 @@ struct ReportConfig {
     bool includeAnalytics;
     std::wstring outputPath;
     std::wstring targetDirectory;
+    // InteractiveHtml only: table data goes to sidecar files next to the
+    // page instead of inline, for namespaces too large for one file.
+    bool sidecarData = false;
+    // Longest a text report section may run before it is stopped and its
+    // partial output used; zero means no limit.
+    std::chrono::milliseconds sectionTimeout{ 0 };
+    // When set, the report lists only what changed since this snapshot
+    // instead of the full target.
+    std::wstring baselinePath;
+    // When set, a snapshot of the target is saved here to serve as the
+    // baseline of a later delta report.
+    std::wstring snapshotPath;
+    // Applies to the HTML and XML reports and to the snapshot. Interactive
+    // pages are always written uncompressed so a browser can open them.
+    OutputCompression compression = OutputCompression::None;
 };
 
 class ReportGenerator {
 public:
-    ReportGenerator();
+    explicit ReportGenerator(NtApi& ntApi = NtApi::system(), ThreadPool& pool = ThreadPool::shared());
     ~ReportGenerator();
 
+    // Text reports render their sections concurrently on the pool and stitch
+    // them together in a fixed order.
     void generateReport(const ReportConfig& config);
 
+    // Stops a report in progress from another thread; sections still running
+    // keep what they have rendered and the report is written as partial.
+    void cancel() { cancelRequested.store(true); }
+
 private:
+    // Renders one section into out, checking stop between NT calls.
+    using SectionRenderer = std::function<void(std::wstring& out, const std::atomic<bool>& stop)>;
+
+    struct ReportSection {
+        std::wstring title;
+        MetricHistogram histogram;
+        SectionRenderer render;
+    };
+
+    // One read of the target: the snapshot and the dependency graph its
+    // edges came from. A report saved with a snapshot is rendered from it
+    // rather than listing the tree and building the graph again.
+    struct TargetCapture {
+        ReportSnapshot snapshot;
+        std::vector<ObjectDependency> dependencies;
+    };
+
+    NtApi& ntApi;
+    ThreadPool& pool;
+    std::atomic<bool> cancelRequested{ false };
     std::unique_ptr<ObjectMonitor> objectMonitor;
     std::unique_ptr<ObjectAnalyzer> objectAnalyzer;
+    std::unique_ptr<ObjectManagerExplorer> objectExplorer;
 
-    void saveToFile(const std::wstring& filePath, ReportFormat format, const std::wstring& content);
+    // capture, when given, replaces the listing and the graph the report
+    // would otherwise read itself.
+    void generateTextReport(const ReportConfig& config, const std::wstring& targetPath, const TargetCapture* capture);
+    void generateInteractiveReport(const ReportConfig& config, const std::wstring& targetPath,
+        const TargetCapture* capture);
+    void generateDeltaReport(const ReportConfig& config, const ReportSnapshot& current);
+    TargetCapture captureTarget(const std::wstring& targetPath);
+    // Passes each section to emit, in order, as soon as it is complete.
+    void runSections(const std::vector<ReportSection>& sections, std::chrono::milliseconds timeout,
+        const std::function<void(std::wstring_view)>& emit);
+
+    void renderTypeStatistics(const std::wstring& targetPath, std::wstring& out, const std::atomic<bool>& stop);
+    void renderDependencies(const std::wstring& targetPath, const TargetCapture* capture, std::wstring& out,
+        const std::atomic<bool>& stop);
+    void renderStatistics(const std::wstring& targetPath, std::wstring& out, const std::atomic<bool>& stop);
+
+    // A text report is written as header, content in any number of
+    // pieces, footer; the content is escaped as the format requires.
+    std::unique_ptr<OutputSink> openReportFile(const ReportConfig& config);
+    void writeReportText(OutputSink& output, ReportFormat format, std::wstring_view text);
+    void closeReportFile(OutputSink& output, ReportFormat format);
+    void saveToFile(const ReportConfig& config, const std::wstring& content);
 
     std::wstring formatStatistics(const std::map<std::wstring, ObjectStatistics>& stats);
     std::wstring formatAnalytics(const std::vector<ObjectDependency>& dependencies);
     std::wstring formatTypeStatistics(const std::map<std::wstring, size_t>& typeStats);
 
-    std::wstring generateHtmlReport(const std::wstring& content);
-    std::wstring generateXmlReport(const std::wstring& content);
-
-    std::wstring getCurrentTimestamp();
-    std::wstring formatTimestamp(const SYSTEMTIME& st);
     std::wstring formatBytes(SIZE_T bytes);
     std::wstring escapeJsonString(const std::wstring& input);
-    std::wstring escapeXmlString(const std::wstring& input);
+    std::wstring escapeXmlString(std::wstring_view input);
 };
\ No newline at end of file
@@ -0,0 +1,301 @@
+#include "ReportSnapshot.h"
+#include "NameFolding.h"
+#include "Utf8.h"
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <stdexcept>
+#include <tuple>
+
+namespace {
+    // Version 1 snapshots were ordered by exact path and cannot be merged
+    // against the case-insensitive order used since.
+    const char SnapshotFormat[] = "kursova-snapshot\t";
+    const char SnapshotMagic[] = "kursova-snapshot\t2";
+
+    // Only the record separators and the escape character itself are
+    // escaped, so the backslash-heavy paths stay readable.
+    void appendField(std::string& out, std::wstring_view value) {
+        size_t start = 0;
+        for (size_t i = 0; i < value.size(); i++) {
+            const char* escaped = nullptr;
+            switch (value[i]) {
+            case L'%': escaped = "%25"; break;
+            case L'\t': escaped = "%09"; break;
+            case L'\n': escaped = "%0A"; break;
+            case L'\r': escaped = "%0D"; break;
+            default: continue;
+            }
+            appendUtf8(out, value.substr(start, i - start));
+            out += escaped;
+            start = i + 1;
+        }
+        appendUtf8(out, value.substr(start));
+    }
+
+    int hexValue(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        return -1;
+    }
+
+    void decodeField(std::wstring& out, std::string_view field) {
+        out.clear();
+        size_t start = 0;
+        for (size_t i = 0; i < field.size(); i++) {
+            if (field[i] != '%' || i + 2 >= field.size()) {
+                continue;
+            }
+            int high = hexValue(field[i + 1]);
+            int low = hexValue(field[i + 2]);
+            if (high < 0 || low < 0) {
+                continue;
+            }
+            appendWide(out, field.substr(start, i - start));
+            out += static_cast<wchar_t>(high * 16 + low);
+            i += 2;
+            start = i + 1;
+        }
+        appendWide(out, field.substr(start));
+    }
+
+    // Object Manager paths are matched without regard to case, so they are
+    // ordered the same way; exact case only breaks ties.
+    int comparePaths(const std::wstring& a, const std::wstring& b) {
+        return compareIgnoreCase(a, b);
+    }
+
+    int compareDependencies(const SnapshotDependency& a, const SnapshotDependency& b) {
+        if (int order = comparePaths(a.source, b.source)) return order;
+        if (int order = comparePaths(a.target, b.target)) return order;
+        return a.kind.compare(b.kind);
+    }
+}
+
+void ReportSnapshot::finalize() {
+    std::sort(objects.begin(), objects.end(), [](const SnapshotObject& a, const SnapshotObject& b) {
+        if (int order = comparePaths(a.path, b.path)) return order < 0;
+        return std::tie(a.type, a.path) < std::tie(b.type, b.path);
+    });
+    std::sort(dependencies.begin(), dependencies.end(), [](const SnapshotDependency& a, const SnapshotDependency& b) {
+        if (int order = compareDependencies(a, b)) return order < 0;
+        return std::tie(a.source, a.target) < std::tie(b.source, b.target);
+    });
+}
+
+void ReportSnapshot::save(const std::wstring& filePath, OutputCompression compression) const {
+    std::ofstream file;
+    std::unique_ptr<GzipWriter> gzip;
+    if (compression == OutputCompression::Gzip) {
+        gzip = std::make_unique<GzipWriter>(filePath);
+    }
+    else {
+        file.open(std::filesystem::path(filePath), std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("Unable to open snapshot file for writing");
+        }
+    }
+
+    std::string buffer = SnapshotMagic;
+    buffer += '\t';
+    appendField(buffer, target);
+    buffer += '\t';
+    buffer += std::to_string(takenAt);
+    buffer += '\n';
+
+    auto writeBuffer = [&]() {
+        if (gzip) {
+            gzip->write(buffer);
+        }
+        else {
+            file.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        }
+        buffer.clear();
+    };
+    auto flushFull = [&]() {
+        if (buffer.size() >= 256 * 1024) {
+            writeBuffer();
+        }
+    };
+
+    for (const auto& object : objects) {
+        buffer += "O\t";
+        appendField(buffer, object.path);
+        buffer += '\t';
+        appendField(buffer, object.type);
+        buffer += '\t';
+        appendField(buffer, object.detail);
+        buffer += '\n';
+        flushFull();
+    }
+    for (const auto& dependency : dependencies) {
+        buffer += "D\t";
+        appendField(buffer, dependency.source);
+        buffer += '\t';
+        appendField(buffer, dependency.target);
+        buffer += '\t';
+        appendField(buffer, dependency.kind);
+        buffer += '\n';
+        flushFull();
+    }
+
+    writeBuffer();
+    if (gzip) {
+        gzip->finish();
+    }
+    else if (!file) {
+        throw std::runtime_error("Unable to write snapshot file");
+    }
+}
+
+SnapshotReader::SnapshotReader(const std::wstring& filePath)
+    : file{ std::filesystem::path(filePath), std::ios::binary } {
+    if (!file.is_open()) {
+        throw std::runtime_error("Unable to open snapshot file");
+    }
+
+    if (GzipInputBuffer::detect(*file.rdbuf())) {
+        gzip = std::make_unique<GzipInputBuffer>(*file.rdbuf());
+        input.rdbuf(gzip.get());
+    }
+    else {
+        input.rdbuf(file.rdbuf());
+    }
+    // Lets inflate errors through instead of reading as end of file.
+    input.exceptions(std::ios::badbit);
+
+    if (!std::getline(input, line) || line.compare(0, sizeof(SnapshotFormat) - 1, SnapshotFormat) != 0) {
+        throw std::runtime_error("Not a snapshot file");
+    }
+    if (line.compare(0, sizeof(SnapshotMagic) - 1, SnapshotMagic) != 0) {
+        throw std::runtime_error("Snapshot was saved by an older version; take a new baseline");
+    }
+    size_t targetStart = sizeof(SnapshotMagic);
+    size_t targetEnd = line.find('\t', targetStart);
+    if (targetEnd == std::string::npos) {
+        throw std::runtime_error("Not a snapshot file");
+    }
+    decodeField(snapshotTarget, std::string_view(line).substr(targetStart, targetEnd - targetStart));
+    snapshotTakenAt = std::strtoll(line.c_str() + targetEnd + 1, nullptr, 10);
+}
+
+bool SnapshotReader::readRecord(wchar_t& kind) {
+    while (std::getline(input, line)) {
+        if (line.size() < 2 || line[1] != '\t') {
+            continue;
+        }
+        kind = static_cast<wchar_t>(line[0]);
+
+        size_t field = 0;
+        size_t start = 2;
+        while (field < 3) {
+            size_t end = line.find('\t', start);
+            if (end == std::string::npos) {
+                end = line.size();
+            }
+            if (fields.size() <= field) {
+                fields.emplace_back();
+            }
+            decodeField(fields[field], std::string_view(line).substr(start, end - start));
+            field++;
+            start = std::min(end + 1, line.size());
+        }
+        return true;
+    }
+    return false;
+}
+
+bool SnapshotReader::nextObject(SnapshotObject& object) {
+    wchar_t kind;
+    if (dependencyPending || !readRecord(kind)) {
+        return false;
+    }
+    if (kind != L'O') {
+        dependencyPending = true;
+        return false;
+    }
+    object.path = std::move(fields[0]);
+    object.type = std::move(fields[1]);
+    object.detail = std::move(fields[2]);
+    return true;
+}
+
+bool SnapshotReader::nextDependency(SnapshotDependency& dependency) {
+    wchar_t kind = L'D';
+    if (!dependencyPending) {
+        do {
+            if (!readRecord(kind)) {
+                return false;
+            }
+        } while (kind != L'D');
+    }
+    dependencyPending = false;
+    dependency.source = std::move(fields[0]);
+    dependency.target = std::move(fields[1]);
+    dependency.kind = std::move(fields[2]);
+    return true;
+}
+
+SnapshotDelta compareSnapshots(SnapshotReader& baseline, const ReportSnapshot& current) {
+    SnapshotDelta delta;
+
+    SnapshotObject before;
+    bool haveBefore = baseline.nextObject(before);
+    size_t next = 0;
+    while (haveBefore || next < current.objects.size()) {
+        int order = !haveBefore ? 1
+            : next == current.objects.size() ? -1
+            : comparePaths(before.path, current.objects[next].path);
+
+        if (order < 0) {
+            delta.typeCounts[before.type].before++;
+            delta.removed.push_back(std::move(before));
+            haveBefore = baseline.nextObject(before);
+        }
+        else if (order > 0) {
+            const SnapshotObject& after = current.objects[next++];
+            delta.typeCounts[after.type].after++;
+            delta.added.push_back(after);
+        }
+        else {
+            const SnapshotObject& after = current.objects[next++];
+            delta.typeCounts[before.type].before++;
+            delta.typeCounts[after.type].after++;
+            if (before.type != after.type || before.detail != after.detail) {
+                delta.changed.emplace_back(std::move(before), after);
+            }
+            else {
+                delta.unchanged++;
+            }
+            haveBefore = baseline.nextObject(before);
+        }
+    }
+
+    for (auto it = delta.typeCounts.begin(); it != delta.typeCounts.end();) {
+        it = it->second.before == it->second.after ? delta.typeCounts.erase(it) : std::next(it);
+    }
+
+    SnapshotDependency dependency;
+    bool haveDependency = baseline.nextDependency(dependency);
+    next = 0;
+    while (haveDependency || next < current.dependencies.size()) {
+        int order = !haveDependency ? 1
+            : next == current.dependencies.size() ? -1
+            : compareDependencies(dependency, current.dependencies[next]);
+
+        if (order < 0) {
+            delta.removedDependencies.push_back(std::move(dependency));
+        }
+        else if (order > 0) {
+            delta.addedDependencies.push_back(current.dependencies[next++]);
+            continue;
+        }
+        else {
+            next++;
+        }
+        haveDependency = baseline.nextDependency(dependency);
+    }
+
+    return delta;
+}
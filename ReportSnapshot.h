@@ -0,0 +1,96 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <istream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Gzip.h"
+#include "OutputSink.h"
+
+struct SnapshotObject {
+    std::wstring path;
+    std::wstring type;
+    // Link target for symbolic links, empty otherwise.
+    std::wstring detail;
+};
+
+struct SnapshotDependency {
+    std::wstring source;
+    std::wstring target;
+    std::wstring kind;
+};
+
+// The objects and dependencies of one report target, each sorted by path
+// without regard to case, so two snapshots can be compared in a single
+// merge pass and a path that only changed case still matches.
+struct ReportSnapshot {
+    std::wstring target;
+    int64_t takenAt = 0;
+    std::vector<SnapshotObject> objects;
+    std::vector<SnapshotDependency> dependencies;
+
+    // Sorts both lists. Symbolic link targets are filled in by whoever
+    // collects the objects.
+    void finalize();
+
+    // UTF-8 lines: a header, then "O" object records, then "D" dependency
+    // records, tab-separated, optionally gzip-compressed. Throws
+    // std::runtime_error on I/O failure.
+    void save(const std::wstring& filePath, OutputCompression compression = OutputCompression::None) const;
+};
+
+// Reads a saved snapshot record by record without loading it. Compressed
+// snapshots are recognized by their gzip header and inflated as they are
+// read.
+class SnapshotReader {
+public:
+    // Throws std::runtime_error if the file cannot be opened or is not a
+    // snapshot.
+    explicit SnapshotReader(const std::wstring& filePath);
+
+    const std::wstring& target() const { return snapshotTarget; }
+    int64_t takenAt() const { return snapshotTakenAt; }
+
+    // Objects come first, in the order they were saved; nextObject returns
+    // false once they are exhausted, after which nextDependency reads the
+    // rest. A corrupt compressed snapshot throws std::runtime_error.
+    bool nextObject(SnapshotObject& object);
+    bool nextDependency(SnapshotDependency& dependency);
+
+private:
+    bool readRecord(wchar_t& kind);
+
+    std::ifstream file;
+    std::unique_ptr<GzipInputBuffer> gzip;
+    std::istream input{ nullptr };
+    std::string line;
+    std::vector<std::wstring> fields;
+    std::wstring snapshotTarget;
+    int64_t snapshotTakenAt = 0;
+    // A dependency read while looking for the next object.
+    bool dependencyPending = false;
+};
+
+struct TypeCountDelta {
+    size_t before = 0;
+    size_t after = 0;
+};
+
+struct SnapshotDelta {
+    std::vector<SnapshotObject> added;
+    std::vector<SnapshotObject> removed;
+    // Baseline and current versions of objects whose type or link target
+    // differs.
+    std::vector<std::pair<SnapshotObject, SnapshotObject>> changed;
+    size_t unchanged = 0;
+    // Only the types whose count differs.
+    std::map<std::wstring, TypeCountDelta> typeCounts;
+    std::vector<SnapshotDependency> addedDependencies;
+    std::vector<SnapshotDependency> removedDependencies;
+};
+
+// Merges the baseline stream against current; both must be in snapshot
+// order. Memory use is bounded by the size of the delta.
+SnapshotDelta compareSnapshots(SnapshotReader& baseline, const ReportSnapshot& current);
@@ -0,0 +1,86 @@
+#include "ScanArena.h"
+#include "Metrics.h"
+#include "NameFolding.h"
+#include <algorithm>
+#include <cstring>
+
+ScanArena::ScanArena(size_t initialCapacity, size_t maxRetained)
+    : initialSize(std::max<size_t>(initialCapacity, 1024)), maxRetained(maxRetained) {
+    addBlock(initialSize);
+}
+
+void ScanArena::addBlock(size_t minimumSize) {
+    size_t size = blocks.empty() ? minimumSize : std::max(minimumSize, blocks.back().size * 2);
+    blocks.push_back({ std::make_unique<std::byte[]>(size), size });
+    Metrics::instance().add(MetricCounter::Allocations);
+}
+
+void* ScanArena::do_allocate(size_t bytes, size_t alignment) {
+    while (true) {
+        Block& block = blocks[currentBlock];
+        size_t aligned = (offset + alignment - 1) & ~(alignment - 1);
+
+        if (aligned + bytes <= block.size) {
+            offset = aligned + bytes;
+            used += bytes;
+            return block.data.get() + aligned;
+        }
+
+        if (currentBlock + 1 == blocks.size()) {
+            addBlock(bytes + alignment);
+        }
+        currentBlock++;
+        offset = 0;
+    }
+}
+
+std::wstring_view ScanArena::copy(const wchar_t* data, size_t length) {
+    if (length == 0) {
+        return std::wstring_view();
+    }
+
+    auto* target = static_cast<wchar_t*>(allocate(length * sizeof(wchar_t), alignof(wchar_t)));
+    std::memcpy(target, data, length * sizeof(wchar_t));
+    return std::wstring_view(target, length);
+}
+
+std::wstring_view ScanArena::folded(std::wstring_view value) {
+    size_t first = 0;
+    while (first < value.size() && foldChar(value[first]) == value[first]) {
+        first++;
+    }
+    if (first == value.size()) {
+        return value;
+    }
+
+    auto* target = static_cast<wchar_t*>(allocate(value.size() * sizeof(wchar_t), alignof(wchar_t)));
+    std::memcpy(target, value.data(), first * sizeof(wchar_t));
+    for (size_t i = first; i < value.size(); i++) {
+        target[i] = foldChar(value[i]);
+    }
+    return std::wstring_view(target, value.size());
+}
+
+void ScanArena::reset() {
+    // Sized from what the scan used, not from the doubled blocks it took.
+    if (used > maxRetained) {
+        blocks.clear();
+        addBlock(initialSize);
+    }
+    else if (blocks.size() > 1) {
+        blocks.clear();
+        addBlock(std::max(initialSize, used + used / 8));
+    }
+
+    currentBlock = 0;
+    offset = 0;
+    used = 0;
+}
+
+size_t ScanArena::capacity() const {
+    size_t total = 0;
+    for (const auto& block : blocks) {
+        total += block.size;
+    }
+    return total;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+// Bump allocator for names and paths that only live for one scan (a monitor
+// tick or a single listing). Nothing is freed individually; reset() drops
+// everything at once and folds the blocks used into one, so a scan of the
+// same size as the previous one never touches the heap. An arena grown
+// past maxRetained is not kept at that size: reset() goes back to the
+// initial block, so one walk of the whole namespace does not pin its peak
+// for the owner's lifetime.
+class ScanArena : public std::pmr::memory_resource {
+public:
+    static constexpr size_t DefaultMaxRetained = 1024 * 1024;
+
+    explicit ScanArena(size_t initialCapacity = 64 * 1024, size_t maxRetained = DefaultMaxRetained);
+
+    ScanArena(const ScanArena&) = delete;
+    ScanArena& operator=(const ScanArena&) = delete;
+
+    // Copies a counted (not necessarily terminated) string into the arena.
+    std::wstring_view copy(const wchar_t* data, size_t length);
+    std::wstring_view copy(std::wstring_view value) { return copy(value.data(), value.size()); }
+    // The case-folded form of value: value itself when folding changes
+    // nothing, as for most kernel names, otherwise a folded arena copy.
+    std::wstring_view folded(std::wstring_view value);
+
+    void reset();
+
+    size_t bytesUsed() const { return used; }
+    size_t capacity() const;
+
+private:
+    struct Block {
+        std::unique_ptr<std::byte[]> data;
+        size_t size;
+    };
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void*, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    void addBlock(size_t minimumSize);
+
+    std::vector<Block> blocks;
+    size_t initialSize;
+    size_t maxRetained;
+    size_t currentBlock = 0;
+    size_t offset = 0;
+    size_t used = 0;
+};
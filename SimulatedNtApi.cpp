@@ -0,0 +1,1179 @@
+#include "SimulatedNtApi.h"
+#include "DirectoryHandlePool.h"
+#include "NameFolding.h"
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <random>
+
+namespace {
+    const wchar_t* const DirectoryTypeName = L"Directory";
+    const wchar_t* const SymbolicLinkTypeName = L"SymbolicLink";
+    const int MaxLinkDepth = 8;
+
+    // NT reports object type indices starting at 2.
+    const USHORT FirstTypeIndex = 2;
+
+    HANDLE toHandle(ULONG_PTR value) {
+        return reinterpret_cast<HANDLE>(value);
+    }
+
+    ULONG_PTR fromHandle(HANDLE handle) {
+        return reinterpret_cast<ULONG_PTR>(handle);
+    }
+
+    std::wstring fromUnicodeString(const UNICODE_STRING* value) {
+        if (!value || !value->Buffer) {
+            return std::wstring();
+        }
+        return std::wstring(value->Buffer, value->Length / sizeof(WCHAR));
+    }
+
+    std::mt19937_64& randomEngine() {
+        thread_local std::mt19937_64 engine(std::random_device{}());
+        return engine;
+    }
+}
+
+SimulatedNtApi::SimulatedNtApi() {
+    internType(DirectoryTypeName);
+    internType(SymbolicLinkTypeName);
+
+    Node root;
+    root.live = true;
+    root.directory = 0;
+    root.typeIndex = typeIndexByName[DirectoryTypeName];
+    root.creationTime = currentNtTime();
+    bootTime = root.creationTime;
+    nodes.push_back(root);
+    directories.emplace_back();
+    typeObjectCounts[root.typeIndex]++;
+    liveObjects = 1;
+}
+
+SimulatedNtApi::~SimulatedNtApi() {
+    stopChurn();
+    DirectoryHandlePool::discard(*this);
+}
+
+void SimulatedNtApi::Directory::addSlot() {
+    // The new tree node covers the slots (i - lowbit(i), i], all but the
+    // new one already counted.
+    size_t i = slots.size() + 1;
+    liveCounts.push_back(static_cast<uint32_t>(liveBefore(i - 1) - liveBefore(i - (i & (0 - i)))));
+    slots.push_back(InvalidIndex);
+}
+
+void SimulatedNtApi::Directory::setLive(size_t slot, bool live) {
+    for (size_t i = slot + 1; i <= liveCounts.size(); i += i & (0 - i)) {
+        if (live) {
+            liveCounts[i - 1]++;
+        }
+        else {
+            liveCounts[i - 1]--;
+        }
+    }
+}
+
+size_t SimulatedNtApi::Directory::liveBefore(size_t slot) const {
+    size_t count = 0;
+    for (size_t i = slot; i > 0; i -= i & (0 - i)) {
+        count += liveCounts[i - 1];
+    }
+    return count;
+}
+
+size_t SimulatedNtApi::Directory::slotOfEntry(size_t ordinal) const {
+    size_t step = 1;
+    while (step * 2 <= liveCounts.size()) {
+        step *= 2;
+    }
+
+    // The longest prefix of slots with at most ordinal live entries ends
+    // just before the wanted one.
+    size_t position = 0;
+    for (; step > 0; step /= 2) {
+        if (position + step <= liveCounts.size() && liveCounts[position + step - 1] <= ordinal) {
+            position += step;
+            ordinal -= liveCounts[position - 1];
+        }
+    }
+    return position;
+}
+
+std::wstring SimulatedNtApi::foldName(const wchar_t* name, size_t length) {
+    std::wstring folded(name, length);
+    for (auto& c : folded) {
+        c = foldChar(c);
+    }
+    return folded;
+}
+
+LONGLONG SimulatedNtApi::currentNtTime() {
+    // 100ns intervals since 1601-01-01, like KeQuerySystemTime.
+    const LONGLONG epochDelta = 116444736000000000LL;
+    auto sinceUnixEpoch = std::chrono::system_clock::now().time_since_epoch();
+    return epochDelta + std::chrono::duration_cast<std::chrono::nanoseconds>(sinceUnixEpoch).count() / 100;
+}
+
+NTSTATUS SimulatedNtApi::injectFault() {
+    int64_t latency = faultLatencyMicros.load(std::memory_order_relaxed);
+    int64_t jitter = faultJitterMicros.load(std::memory_order_relaxed);
+    if (jitter > 0) {
+        latency += std::uniform_int_distribution<int64_t>(0, jitter)(randomEngine());
+    }
+    if (latency > 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(latency));
+    }
+
+    uint32_t failurePerMillion = faultFailurePerMillion.load(std::memory_order_relaxed);
+    if (failurePerMillion > 0 &&
+        std::uniform_int_distribution<uint32_t>(0, 999999)(randomEngine()) < failurePerMillion) {
+        return faultFailureStatus.load(std::memory_order_relaxed);
+    }
+    return STATUS_SUCCESS;
+}
+
+void SimulatedNtApi::setFaults(const SimulatedFaults& faults) {
+    double rate = std::min(std::max(faults.failureRate, 0.0), 1.0);
+    faultLatencyMicros = faults.callLatency.count();
+    faultJitterMicros = faults.latencyJitter.count();
+    faultFailurePerMillion = static_cast<uint32_t>(rate * 1000000.0);
+    faultFailureStatus = faults.failureStatus;
+    faultNameStallMillis = faults.nameQueryStall.count();
+}
+
+uint16_t SimulatedNtApi::internType(const std::wstring& typeName) {
+    auto it = typeIndexByName.find(typeName);
+    if (it != typeIndexByName.end()) {
+        return it->second;
+    }
+
+    uint16_t index = static_cast<uint16_t>(typeNames.size());
+    typeNames.push_back(typeName);
+    typeObjectCounts.push_back(0);
+    typeHandleCounts.push_back(0);
+    typeIndexByName.emplace(typeName, index);
+    return index;
+}
+
+NTSTATUS SimulatedNtApi::resolvePathLocked(uint32_t start, const std::wstring& path, int depth, uint32_t& node) const {
+    if (depth > MaxLinkDepth) {
+        return STATUS_OBJECT_PATH_NOT_FOUND;
+    }
+
+    uint32_t current = start;
+    size_t pos = 0;
+    if (!path.empty() && path[0] == L'\\') {
+        current = 0;
+        pos = 1;
+    }
+
+    while (pos < path.size()) {
+        size_t end = path.find(L'\\', pos);
+        if (end == std::wstring::npos) {
+            end = path.size();
+        }
+        if (end == pos) {
+            pos = end + 1;
+            continue;
+        }
+
+        const Node& dirNode = nodes[current];
+        if (dirNode.directory == InvalidIndex) {
+            // Intermediate symbolic links are traversed like the kernel does.
+            auto link = linkTargets.find(current);
+            if (link == linkTargets.end()) {
+                return STATUS_OBJECT_PATH_NOT_FOUND;
+            }
+            NTSTATUS status = resolvePathLocked(0, link->second, depth + 1, current);
+            if (!NT_SUCCESS(status)) {
+                return status;
+            }
+            if (nodes[current].directory == InvalidIndex) {
+                return STATUS_OBJECT_PATH_NOT_FOUND;
+            }
+        }
+
+        const Directory& dir = directories[nodes[current].directory];
+        auto it = dir.byName.find(foldName(path.data() + pos, end - pos));
+        if (it == dir.byName.end()) {
+            return end == path.size() ? STATUS_OBJECT_NAME_NOT_FOUND : STATUS_OBJECT_PATH_NOT_FOUND;
+        }
+
+        current = dir.slots[it->second];
+        pos = end + 1;
+    }
+
+    node = current;
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS SimulatedNtApi::resolveLocked(const OBJECT_ATTRIBUTES* objectAttributes, uint32_t& node) const {
+    if (!objectAttributes || !objectAttributes->ObjectName) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    uint32_t start = 0;
+    if (objectAttributes->RootDirectory) {
+        HandleEntry root;
+        if (!lookupHandleLocked(objectAttributes->RootDirectory, root) || root.kind != HandleKind::Object ||
+            !nodeIsValid(root.node, root.generation)) {
+            return STATUS_INVALID_HANDLE;
+        }
+        start = root.node;
+    }
+    else if (objectAttributes->ObjectName->Length == 0 ||
+        objectAttributes->ObjectName->Buffer[0] != L'\\') {
+        return STATUS_OBJECT_NAME_INVALID;
+    }
+
+    return resolvePathLocked(start, fromUnicodeString(objectAttributes->ObjectName), 0, node);
+}
+
+NTSTATUS SimulatedNtApi::resolveParentLocked(const std::wstring& path, uint32_t& parent, std::wstring& leafName) {
+    std::wstring trimmed = path;
+    while (trimmed.size() > 1 && trimmed.back() == L'\\') {
+        trimmed.pop_back();
+    }
+
+    size_t split = trimmed.rfind(L'\\');
+    if (split == std::wstring::npos || split + 1 >= trimmed.size()) {
+        return STATUS_OBJECT_NAME_INVALID;
+    }
+
+    leafName = trimmed.substr(split + 1);
+    NTSTATUS status = resolvePathLocked(0, split == 0 ? L"\\" : trimmed.substr(0, split), 0, parent);
+    if (!NT_SUCCESS(status)) {
+        return STATUS_OBJECT_PATH_NOT_FOUND;
+    }
+    return nodes[parent].directory == InvalidIndex ? STATUS_OBJECT_PATH_NOT_FOUND : STATUS_SUCCESS;
+}
+
+NTSTATUS SimulatedNtApi::insertLocked(uint32_t parent, const std::wstring& name, uint16_t typeIndex, uint32_t& node) {
+    Directory& dir = directories[nodes[parent].directory];
+    std::wstring key = foldName(name.data(), name.size());
+    if (dir.byName.count(key)) {
+        return STATUS_OBJECT_NAME_COLLISION;
+    }
+
+    if (freeNodes.empty()) {
+        node = static_cast<uint32_t>(nodes.size());
+        nodes.emplace_back();
+    }
+    else {
+        node = freeNodes.back();
+        freeNodes.pop_back();
+    }
+
+    uint32_t slot;
+    if (dir.freeSlots.empty()) {
+        slot = static_cast<uint32_t>(dir.slots.size());
+        dir.addSlot();
+    }
+    else {
+        slot = dir.freeSlots.back();
+        dir.freeSlots.pop_back();
+    }
+    dir.slots[slot] = node;
+    dir.setLive(slot, true);
+    dir.byName.emplace(std::move(key), slot);
+
+    Node& entry = nodes[node];
+    entry.name = name;
+    entry.parent = parent;
+    entry.slot = slot;
+    entry.directory = InvalidIndex;
+    entry.handleCount = 0;
+    entry.typeIndex = typeIndex;
+    entry.live = true;
+    entry.creationTime = currentNtTime();
+
+    typeObjectCounts[typeIndex]++;
+    liveObjects++;
+    return STATUS_SUCCESS;
+}
+
+void SimulatedNtApi::removeLocked(uint32_t node) {
+    Node& entry = nodes[node];
+    Directory& dir = directories[nodes[entry.parent].directory];
+
+    dir.byName.erase(foldName(entry.name.data(), entry.name.size()));
+    dir.slots[entry.slot] = InvalidIndex;
+    dir.setLive(entry.slot, false);
+    dir.freeSlots.push_back(entry.slot);
+
+    linkTargets.erase(node);
+    typeObjectCounts[entry.typeIndex]--;
+    typeHandleCounts[entry.typeIndex] -= entry.handleCount;
+    liveObjects--;
+
+    entry.live = false;
+    entry.generation++;
+    entry.name.clear();
+    entry.name.shrink_to_fit();
+    freeNodes.push_back(node);
+}
+
+std::wstring SimulatedNtApi::fullPathLocked(uint32_t node) const {
+    if (node == 0) {
+        return L"\\";
+    }
+
+    std::vector<uint32_t> chain;
+    for (uint32_t current = node; current != 0; current = nodes[current].parent) {
+        chain.push_back(current);
+    }
+
+    std::wstring path;
+    for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+        path += L'\\';
+        path += nodes[*it].name;
+    }
+    return path;
+}
+
+bool SimulatedNtApi::nodeIsValid(uint32_t node, uint32_t generation) const {
+    return node < nodes.size() && nodes[node].live && nodes[node].generation == generation;
+}
+
+NTSTATUS SimulatedNtApi::createDirectory(const std::wstring& path) {
+    std::unique_lock<std::shared_mutex> lock(stateLock);
+
+    uint32_t current = 0;
+    size_t pos = 1;
+    while (pos < path.size()) {
+        size_t end = path.find(L'\\', pos);
+        if (end == std::wstring::npos) {
+            end = path.size();
+        }
+        if (end > pos) {
+            std::wstring component = path.substr(pos, end - pos);
+            Directory& dir = directories[nodes[current].directory];
+            auto it = dir.byName.find(foldName(component.data(), component.size()));
+
+            if (it != dir.byName.end()) {
+                current = dir.slots[it->second];
+                if (nodes[current].directory == InvalidIndex) {
+                    return STATUS_OBJECT_TYPE_MISMATCH;
+                }
+            }
+            else {
+                uint32_t node;
+                NTSTATUS status = insertLocked(current, component, typeIndexByName[DirectoryTypeName], node);
+                if (!NT_SUCCESS(status)) {
+                    return status;
+                }
+                nodes[node].directory = static_cast<uint32_t>(directories.size());
+                directories.emplace_back();
+                current = node;
+            }
+        }
+        pos = end + 1;
+    }
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS SimulatedNtApi::createObject(const std::wstring& path, const std::wstring& typeName) {
+    if (typeName == DirectoryTypeName) {
+        return createDirectory(path);
+    }
+
+    std::unique_lock<std::shared_mutex> lock(stateLock);
+    uint32_t parent;
+    std::wstring leafName;
+    NTSTATUS status = resolveParentLocked(path, parent, leafName);
+    if (!NT_SUCCESS(status)) {
+        return status;
+    }
+
+    uint32_t node;
+    return insertLocked(parent, leafName, internType(typeName), node);
+}
+
+NTSTATUS SimulatedNtApi::createSymbolicLink(const std::wstring& path, const std::wstring& target) {
+    std::unique_lock<std::shared_mutex> lock(stateLock);
+    uint32_t parent;
+    std::wstring leafName;
+    NTSTATUS status = resolveParentLocked(path, parent, leafName);
+    if (!NT_SUCCESS(status)) {
+        return status;
+    }
+
+    uint32_t node;
+    status = insertLocked(parent, leafName, typeIndexByName[SymbolicLinkTypeName], node);
+    if (NT_SUCCESS(status)) {
+        linkTargets[node] = target;
+    }
+    return status;
+}
+
+NTSTATUS SimulatedNtApi::deleteObject(const std::wstring& path) {
+    std::unique_lock<std::shared_mutex> lock(stateLock);
+    uint32_t node;
+    NTSTATUS status = resolvePathLocked(0, path, 0, node);
+    if (!NT_SUCCESS(status)) {
+        return status;
+    }
+    if (node == 0) {
+        return STATUS_ACCESS_DENIED;
+    }
+
+    const Node& entry = nodes[node];
+    if (entry.directory != InvalidIndex &&
+        !directories[entry.directory].byName.empty()) {
+        return STATUS_ACCESS_DENIED;
+    }
+
+    removeLocked(node);
+    return STATUS_SUCCESS;
+}
+
+size_t SimulatedNtApi::populate(const std::wstring& directory, const std::wstring& typeName,
+    const std::wstring& namePrefix, size_t count) {
+    if (!NT_SUCCESS(createDirectory(directory))) {
+        return 0;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(stateLock);
+    uint32_t parent;
+    if (!NT_SUCCESS(resolvePathLocked(0, directory, 0, parent))) {
+        return 0;
+    }
+
+    uint16_t typeIndex = internType(typeName);
+    size_t created = 0;
+    for (size_t i = 0; i < count; i++) {
+        uint32_t node;
+        if (NT_SUCCESS(insertLocked(parent, namePrefix + std::to_wstring(i), typeIndex, node))) {
+            created++;
+        }
+    }
+    return created;
+}
+
+void SimulatedNtApi::populateDefaultNamespace() {
+    createDirectory(L"\\BaseNamedObjects");
+    createDirectory(L"\\Device");
+    createDirectory(L"\\GLOBAL??");
+    createDirectory(L"\\KnownDlls");
+    createDirectory(L"\\Sessions\\1\\BaseNamedObjects");
+
+    createObject(L"\\Device\\HarddiskVolume1", L"Device");
+    createObject(L"\\Device\\HarddiskVolume3", L"Device");
+    createObject(L"\\Device\\NamedPipe", L"Device");
+    createSymbolicLink(L"\\GLOBAL??\\C:", L"\\Device\\HarddiskVolume3");
+    createSymbolicLink(L"\\GLOBAL??\\PIPE", L"\\Device\\NamedPipe");
+    createSymbolicLink(L"\\BaseNamedObjects\\Global", L"\\BaseNamedObjects");
+    createSymbolicLink(L"\\BaseNamedObjects\\Local", L"\\BaseNamedObjects");
+    createSymbolicLink(L"\\BaseNamedObjects\\Session", L"\\Sessions\\1\\BaseNamedObjects");
+
+    populate(L"\\BaseNamedObjects", L"Event", L"SimEvent_", 64);
+    populate(L"\\BaseNamedObjects", L"Mutant", L"SimMutant_", 16);
+    populate(L"\\BaseNamedObjects", L"Section", L"SimSection_", 16);
+    populate(L"\\BaseNamedObjects", L"Semaphore", L"SimSemaphore_", 8);
+    populate(L"\\BaseNamedObjects", L"Timer", L"SimTimer_", 4);
+    populate(L"\\KnownDlls", L"Section", L"module", 32);
+    populate(L"\\Sessions\\1\\BaseNamedObjects", L"Event", L"SessionEvent_", 32);
+
+    // File objects have no namespace entry on Windows; the simulator parks
+    // them in a directory of their own so process handles can refer to them.
+    populate(L"\\Device\\SimFiles", L"File", L"Pipe_", 4);
+
+    addProcess(4);
+    addProcess(CurrentProcessId);
+
+    for (int i = 0; i < 8; i++) {
+        addProcessHandle(4, L"\\KnownDlls\\module" + std::to_wstring(i), SECTION_QUERY);
+        addProcessHandle(4, L"\\BaseNamedObjects\\SimEvent_" + std::to_wstring(i), EVENT_QUERY_STATE);
+        addProcessHandle(CurrentProcessId, L"\\BaseNamedObjects\\SimEvent_" + std::to_wstring(i), EVENT_QUERY_STATE);
+    }
+    // Two synchronous pipes and two ordinary ones.
+    addProcessHandle(4, L"\\Device\\SimFiles\\Pipe_0", 0x0012019F);
+    addProcessHandle(4, L"\\Device\\SimFiles\\Pipe_1", 0x0012019F);
+    addProcessHandle(4, L"\\Device\\SimFiles\\Pipe_2", 0x00120089);
+    addProcessHandle(CurrentProcessId, L"\\Device\\SimFiles\\Pipe_3", 0x00120089);
+}
+
+size_t SimulatedNtApi::objectCount() const {
+    std::shared_lock<std::shared_mutex> lock(stateLock);
+    return liveObjects;
+}
+
+void SimulatedNtApi::addProcess(DWORD processId) {
+    std::unique_lock<std::shared_mutex> lock(stateLock);
+    processHandles[processId];
+}
+
+NTSTATUS SimulatedNtApi::addProcessHandle(DWORD processId, const std::wstring& objectPath, ACCESS_MASK grantedAccess) {
+    std::unique_lock<std::shared_mutex> lock(stateLock);
+    uint32_t node;
+    NTSTATUS status = resolvePathLocked(0, objectPath, 0, node);
+    if (!NT_SUCCESS(status)) {
+        return status;
+    }
+
+    ULONG_PTR handleValue = nextHandleValue;
+    nextHandleValue += 4;
+    processHandles[processId].push_back({ handleValue, node, nodes[node].generation, grantedAccess });
+    nodes[node].handleCount++;
+    typeHandleCounts[nodes[node].typeIndex]++;
+    return STATUS_SUCCESS;
+}
+
+HANDLE SimulatedNtApi::allocateHandleLocked(const HandleEntry& entry) {
+    ULONG_PTR handleValue = nextHandleValue;
+    nextHandleValue += 4;
+    handles.emplace(handleValue, entry);
+
+    if (entry.kind == HandleKind::Object) {
+        nodes[entry.node].handleCount++;
+        typeHandleCounts[nodes[entry.node].typeIndex]++;
+    }
+    return toHandle(handleValue);
+}
+
+bool SimulatedNtApi::lookupHandleLocked(HANDLE handle, HandleEntry& entry) const {
+    auto it = handles.find(fromHandle(handle));
+    if (it == handles.end()) {
+        return false;
+    }
+    entry = it->second;
+    return true;
+}
+
+NTSTATUS SimulatedNtApi::openTyped(PHANDLE handle, ACCESS_MASK desiredAccess, POBJECT_ATTRIBUTES objectAttributes,
+    const wchar_t* requiredType) {
+    NTSTATUS status = injectFault();
+    if (!NT_SUCCESS(status)) {
+        return status;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(stateLock);
+    uint32_t node;
+    status = resolveLocked(objectAttributes, node);
+    if (!NT_SUCCESS(status)) {
+        return status;
+    }
+
+    // Opening anything but the link itself reparses through the target.
+    for (int depth = 0; linkTargets.count(node); depth++) {
+        if (depth == MaxLinkDepth) {
+            return STATUS_OBJECT_PATH_NOT_FOUND;
+        }
+        status = resolvePathLocked(0, linkTargets.at(node), depth + 1, node);
+        if (!NT_SUCCESS(status)) {
+            return status;
+        }
+    }
+
+    if (requiredType && typeNames[nodes[node].typeIndex] != requiredType) {
+        return STATUS_OBJECT_TYPE_MISMATCH;
+    }
+
+    *handle = allocateHandleLocked({ HandleKind::Object, node, nodes[node].generation, 0, desiredAccess });
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS SimulatedNtApi::openDirectoryObject(PHANDLE directoryHandle, ACCESS_MASK desiredAccess, POBJECT_ATTRIBUTES objectAttributes) {
+    return openTyped(directoryHandle, desiredAccess, objectAttributes, DirectoryTypeName);
+}
+
+NTSTATUS SimulatedNtApi::queryDirectoryObject(HANDLE directoryHandle, PVOID buffer, ULONG length, BOOLEAN returnSingleEntry,
+    BOOLEAN restartScan, PULONG context, PULONG returnLength) {
+    NTSTATUS status = injectFault();
+    if (!NT_SUCCESS(status)) {
+        return status;
+    }
+    if (!context) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    std::shared_lock<std::shared_mutex> lock(stateLock);
+    HandleEntry entry;
+    if (!lookupHandleLocked(directoryHandle, entry) || entry.kind != HandleKind::Object) {
+        return STATUS_INVALID_HANDLE;
+    }
+    if (!nodeIsValid(entry.node, entry.generation) || nodes[entry.node].directory == InvalidIndex) {
+        return STATUS_NO_MORE_ENTRIES;
+    }
+
+    const Directory& dir = directories[nodes[entry.node].directory];
+    const size_t entrySize = sizeof(OBJECT_DIRECTORY_INFORMATION);
+
+    // First pass: decide how many entries fit, entries first and strings after
+    // the terminating zero entry, the same layout the kernel produces.
+    size_t ordinal = restartScan ? 0 : *context;
+    size_t index = dir.slotOfEntry(ordinal);
+    size_t first = index;
+    size_t picked = 0;
+    size_t used = entrySize;
+    size_t firstRequired = 0;
+
+    while (index < dir.slots.size()) {
+        uint32_t child = dir.slots[index];
+        if (child == InvalidIndex) {
+            index++;
+            continue;
+        }
+
+        const Node& node = nodes[child];
+        size_t required = entrySize +
+            (node.name.size() + 1 + typeNames[node.typeIndex].size() + 1) * sizeof(WCHAR);
+        if (used + required > length) {
+            if (picked == 0) {
+                firstRequired = used + required;
+            }
+            break;
+        }
+
+        used += required;
+        picked++;
+        index++;
+        if (returnSingleEntry) {
+            break;
+        }
+    }
+
+    if (picked == 0) {
+        if (firstRequired == 0) {
+            *context = static_cast<ULONG>(ordinal);
+            if (returnLength) {
+                *returnLength = 0;
+            }
+            return STATUS_NO_MORE_ENTRIES;
+        }
+        if (returnLength) {
+            *returnLength = static_cast<ULONG>(firstRequired);
+        }
+        return STATUS_BUFFER_TOO_SMALL;
+    }
+
+    // Second pass: write entries and strings.
+    auto* info = static_cast<POBJECT_DIRECTORY_INFORMATION>(buffer);
+    auto* strings = reinterpret_cast<WCHAR*>(static_cast<BYTE*>(buffer) + (picked + 1) * entrySize);
+
+    auto emit = [&strings](UNICODE_STRING& target, const std::wstring& value) {
+        std::copy(value.begin(), value.end(), strings);
+        strings[value.size()] = L'\0';
+        target.Buffer = strings;
+        target.Length = static_cast<USHORT>(value.size() * sizeof(WCHAR));
+        target.MaximumLength = static_cast<USHORT>(target.Length + sizeof(WCHAR));
+        strings += value.size() + 1;
+    };
+
+    size_t written = 0;
+    for (size_t slot = first; written < picked; slot++) {
+        uint32_t child = dir.slots[slot];
+        if (child == InvalidIndex) {
+            continue;
+        }
+        emit(info[written].Name, nodes[child].name);
+        emit(info[written].TypeName, typeNames[nodes[child].typeIndex]);
+        written++;
+    }
+    std::memset(&info[picked], 0, entrySize);
+
+    *context = static_cast<ULONG>(ordinal + picked);
+    if (returnLength) {
+        *returnLength = static_cast<ULONG>(used);
+    }
+    return dir.liveBefore(dir.slots.size()) > ordinal + picked ? STATUS_MORE_ENTRIES : STATUS_SUCCESS;
+}
+
+NTSTATUS SimulatedNtApi::openSymbolicLinkObject(PHANDLE linkHandle, ACCESS_MASK desiredAccess, POBJECT_ATTRIBUTES objectAttributes) {
+    NTSTATUS status = injectFault();
+    if (!NT_SUCCESS(status)) {
+        return status;
+    }
+
+    // The final component must not be followed, so resolve the parent first.
+    std::unique_lock<std::shared_mutex> lock(stateLock);
+    if (!objectAttributes || !objectAttributes->ObjectName) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    std::wstring path = fromUnicodeString(objectAttributes->ObjectName);
+    uint32_t parent;
+    std::wstring leafName;
+    if (objectAttributes->RootDirectory) {
+        HandleEntry root;
+        if (!lookupHandleLocked(objectAttributes->RootDirectory, root) || !nodeIsValid(root.node, root.generation)) {
+            return STATUS_INVALID_HANDLE;
+        }
+        path = fullPathLocked(root.node) + L"\\" + path;
+    }
+
+    status = resolveParentLocked(path, parent, leafName);
+    if (!NT_SUCCESS(status)) {
+        return status;
+    }
+
+    const Directory& dir = directories[nodes[parent].directory];
+    auto it = dir.byName.find(foldName(leafName.data(), leafName.size()));
+    if (it == dir.byName.end()) {
+        return STATUS_OBJECT_NAME_NOT_FOUND;
+    }
+
+    uint32_t node = dir.slots[it->second];
+    if (typeNames[nodes[node].typeIndex] != SymbolicLinkTypeName) {
+        return STATUS_OBJECT_TYPE_MISMATCH;
+    }
+
+    *linkHandle = allocateHandleLocked({ HandleKind::Object, node, nodes[node].generation, 0, desiredAccess });
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS SimulatedNtApi::querySymbolicLinkObject(HANDLE linkHandle, PUNICODE_STRING linkTarget, PULONG returnedLength) {
+    NTSTATUS status = injectFault();
+    if (!NT_SUCCESS(status)) {
+        return status;
+    }
+
+    std::shared_lock<std::shared_mutex> lock(stateLock);
+    HandleEntry entry;
+    if (!lookupHandleLocked(linkHandle, entry) || !nodeIsValid(entry.node, entry.generation)) {
+        return STATUS_INVALID_HANDLE;
+    }
+
+    auto it = linkTargets.find(entry.node);
+    if (it == linkTargets.end()) {
+        return STATUS_OBJECT_TYPE_MISMATCH;
+    }
+
+    ULONG required = static_cast<ULONG>(it->second.size() * sizeof(WCHAR));
+    if (returnedLength) {
+        *returnedLength = required;
+    }
+    if (required > linkTarget->MaximumLength) {
+        return STATUS_BUFFER_TOO_SMALL;
+    }
+
+    std::copy(it->second.begin(), it->second.end(), linkTarget->Buffer);
+    linkTarget->Length = static_cast<USHORT>(required);
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS SimulatedNtApi::openEvent(PHANDLE eventHandle, ACCESS_MASK desiredAccess, POBJECT_ATTRIBUTES objectAttributes) {
+    return openTyped(eventHandle, desiredAccess, objectAttributes, L"Event");
+}
+
+NTSTATUS SimulatedNtApi::openSection(PHANDLE sectionHandle, ACCESS_MASK desiredAccess, POBJECT_ATTRIBUTES objectAttributes) {
+    return openTyped(sectionHandle, desiredAccess, objectAttributes, L"Section");
+}
+
+NTSTATUS SimulatedNtApi::openMutant(PHANDLE mutantHandle, ACCESS_MASK desiredAccess, POBJECT_ATTRIBUTES objectAttributes) {
+    return openTyped(mutantHandle, desiredAccess, objectAttributes, L"Mutant");
+}
+
+NTSTATUS SimulatedNtApi::openSemaphore(PHANDLE semaphoreHandle, ACCESS_MASK desiredAccess, POBJECT_ATTRIBUTES objectAttributes) {
+    return openTyped(semaphoreHandle, desiredAccess, objectAttributes, L"Semaphore");
+}
+
+NTSTATUS SimulatedNtApi::openTimer(PHANDLE timerHandle, ACCESS_MASK desiredAccess, POBJECT_ATTRIBUTES objectAttributes) {
+    return openTyped(timerHandle, desiredAccess, objectAttributes, L"Timer");
+}
+
+NTSTATUS SimulatedNtApi::openFile(PHANDLE fileHandle, ACCESS_MASK desiredAccess, POBJECT_ATTRIBUTES objectAttributes,
+    PIO_STATUS_BLOCK ioStatusBlock, ULONG shareAccess, ULONG openOptions) {
+    (void)shareAccess;
+    (void)openOptions;
+
+    NTSTATUS status = openTyped(fileHandle, desiredAccess, objectAttributes, L"Device");
+    if (ioStatusBlock) {
+        ioStatusBlock->Status = status;
+        ioStatusBlock->Information = 0;
+    }
+    return status;
+}
+
+NTSTATUS SimulatedNtApi::queryObject(HANDLE handle, OBJECT_INFORMATION_CLASS objectInformationClass, PVOID objectInformation,
+    ULONG objectInformationLength, PULONG returnLength) {
+    NTSTATUS status = injectFault();
+    if (!NT_SUCCESS(status)) {
+        return status;
+    }
+
+    std::shared_lock<std::shared_mutex> lock(stateLock);
+    // The only class that needs no handle.
+    if (static_cast<int>(objectInformationClass) == ObjectTypesInformation) {
+        return queryObjectTypesLocked(objectInformation, objectInformationLength, returnLength);
+    }
+
+    HandleEntry entry;
+    if (!lookupHandleLocked(handle, entry) || entry.kind != HandleKind::Object ||
+        !nodeIsValid(entry.node, entry.generation)) {
+        return STATUS_INVALID_HANDLE;
+    }
+
+    int64_t stall = faultNameStallMillis.load(std::memory_order_relaxed);
+    if (stall > 0 && static_cast<int>(objectInformationClass) == 1 && typeNames[nodes[entry.node].typeIndex] == L"File") {
+        lock.unlock();
+        std::this_thread::sleep_for(std::chrono::milliseconds(stall));
+        lock.lock();
+        if (!nodeIsValid(entry.node, entry.generation)) {
+            return STATUS_INVALID_HANDLE;
+        }
+    }
+    const Node& node = nodes[entry.node];
+
+    // Variable-length classes: fixed header followed by the string.
+    auto writeString = [&](size_t headerSize, UNICODE_STRING& target, const std::wstring& value) {
+        auto* text = reinterpret_cast<WCHAR*>(static_cast<BYTE*>(objectInformation) + headerSize);
+        std::copy(value.begin(), value.end(), text);
+        text[value.size()] = L'\0';
+        target.Buffer = text;
+        target.Length = static_cast<USHORT>(value.size() * sizeof(WCHAR));
+        target.MaximumLength = static_cast<USHORT>(target.Length + sizeof(WCHAR));
+    };
+
+    switch (static_cast<int>(objectInformationClass)) {
+    case ObjectBasicInformation:
+    {
+        if (returnLength) {
+            *returnLength = sizeof(OBJECT_BASIC_INFORMATION);
+        }
+        if (objectInformationLength < sizeof(OBJECT_BASIC_INFORMATION)) {
+            return STATUS_INFO_LENGTH_MISMATCH;
+        }
+
+        OBJECT_BASIC_INFORMATION info = {};
+        info.DesiredAccess = entry.access;
+        info.HandleCount = node.handleCount;
+        info.PointerCount = node.handleCount + 1;
+        info.CreationTime.QuadPart = node.creationTime;
+        std::memcpy(objectInformation, &info, sizeof(info));
+        return STATUS_SUCCESS;
+    }
+
+    case 1: // ObjectNameInformation
+    {
+        std::wstring path = fullPathLocked(entry.node);
+        size_t required = sizeof(OBJECT_NAME_INFORMATION) + (path.size() + 1) * sizeof(WCHAR);
+        if (returnLength) {
+            *returnLength = static_cast<ULONG>(required);
+        }
+        if (objectInformationLength < required) {
+            return STATUS_INFO_LENGTH_MISMATCH;
+        }
+
+        auto* info = static_cast<POBJECT_NAME_INFORMATION>(objectInformation);
+        writeString(sizeof(OBJECT_NAME_INFORMATION), info->Name, path);
+        return STATUS_SUCCESS;
+    }
+
+    case ObjectTypeInformation:
+    {
+        const std::wstring& typeName = typeNames[node.typeIndex];
+        size_t required = sizeof(OBJECT_TYPE_INFORMATION) + (typeName.size() + 1) * sizeof(WCHAR);
+        if (returnLength) {
+            *returnLength = static_cast<ULONG>(required);
+        }
+        if (objectInformationLength < required) {
+            return STATUS_INFO_LENGTH_MISMATCH;
+        }
+
+        auto* info = static_cast<POBJECT_TYPE_INFORMATION>(objectInformation);
+        *info = {};
+        info->TotalNumberOfObjects = static_cast<ULONG>(typeObjectCounts[node.typeIndex]);
+        info->TotalNumberOfHandles = static_cast<ULONG>(typeHandleCounts[node.typeIndex]);
+        info->TypeIndex = static_cast<BYTE>(node.typeIndex + FirstTypeIndex);
+        writeString(sizeof(OBJECT_TYPE_INFORMATION), info->TypeName, typeName);
+        return STATUS_SUCCESS;
+    }
+
+    default:
+        return STATUS_INVALID_INFO_CLASS;
+    }
+}
+
+NTSTATUS SimulatedNtApi::queryObjectTypesLocked(PVOID objectInformation, ULONG objectInformationLength,
+    PULONG returnLength) const {
+    auto align = [](size_t offset) {
+        return (offset + sizeof(ULONG_PTR) - 1) & ~(sizeof(ULONG_PTR) - 1);
+    };
+
+    size_t required = align(sizeof(OBJECT_TYPES_INFORMATION));
+    for (const auto& typeName : typeNames) {
+        required = align(required + sizeof(OBJECT_TYPE_INFORMATION) + (typeName.size() + 1) * sizeof(WCHAR));
+    }
+    if (returnLength) {
+        *returnLength = static_cast<ULONG>(required);
+    }
+    if (objectInformationLength < required) {
+        return STATUS_INFO_LENGTH_MISMATCH;
+    }
+
+    BYTE* base = static_cast<BYTE*>(objectInformation);
+    reinterpret_cast<POBJECT_TYPES_INFORMATION>(base)->NumberOfTypes = static_cast<ULONG>(typeNames.size());
+
+    size_t offset = align(sizeof(OBJECT_TYPES_INFORMATION));
+    for (size_t i = 0; i < typeNames.size(); i++) {
+        auto* info = reinterpret_cast<POBJECT_TYPE_INFORMATION>(base + offset);
+        *info = {};
+        info->TotalNumberOfObjects = static_cast<ULONG>(typeObjectCounts[i]);
+        info->TotalNumberOfHandles = static_cast<ULONG>(typeHandleCounts[i]);
+        info->TypeIndex = static_cast<BYTE>(i + FirstTypeIndex);
+
+        auto* text = reinterpret_cast<WCHAR*>(base + offset + sizeof(OBJECT_TYPE_INFORMATION));
+        std::copy(typeNames[i].begin(), typeNames[i].end(), text);
+        text[typeNames[i].size()] = L'\0';
+        info->TypeName.Buffer = text;
+        info->TypeName.Length = static_cast<USHORT>(typeNames[i].size() * sizeof(WCHAR));
+        info->TypeName.MaximumLength = static_cast<USHORT>(info->TypeName.Length + sizeof(WCHAR));
+
+        offset = align(offset + sizeof(OBJECT_TYPE_INFORMATION) + info->TypeName.MaximumLength);
+    }
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS SimulatedNtApi::querySystemInformation(SYSTEM_INFORMATION_CLASS systemInformationClass, PVOID systemInformation,
+    ULONG systemInformationLength, PULONG returnLength) {
+    NTSTATUS status = injectFault();
+    if (!NT_SUCCESS(status)) {
+        return status;
+    }
+
+    if (static_cast<int>(systemInformationClass) == SystemTimeOfDayInformationClass) {
+        if (returnLength) {
+            *returnLength = sizeof(SYSTEM_TIME_OF_DAY_INFORMATION);
+        }
+        if (systemInformationLength < sizeof(SYSTEM_TIME_OF_DAY_INFORMATION)) {
+            return STATUS_INFO_LENGTH_MISMATCH;
+        }
+
+        SYSTEM_TIME_OF_DAY_INFORMATION info = {};
+        info.BootTime.QuadPart = bootTime;
+        info.CurrentTime.QuadPart = currentNtTime();
+        std::memcpy(systemInformation, &info, sizeof(info));
+        return STATUS_SUCCESS;
+    }
+    if (static_cast<int>(systemInformationClass) != SystemExtendedHandleInformation) {
+        return STATUS_INVALID_INFO_CLASS;
+    }
+
+    std::shared_lock<std::shared_mutex> lock(stateLock);
+
+    size_t count = handles.size();
+    for (const auto& [pid, table] : processHandles) {
+        count += table.size();
+    }
+
+    size_t required = offsetof(SYSTEM_HANDLE_INFORMATION_EX, Handles) + count * sizeof(SYSTEM_HANDLE_TABLE_ENTRY_INFO_EX);
+    if (returnLength) {
+        *returnLength = static_cast<ULONG>(required);
+    }
+    if (systemInformationLength < required) {
+        return STATUS_INFO_LENGTH_MISMATCH;
+    }
+
+    auto* info = static_cast<PSYSTEM_HANDLE_INFORMATION_EX>(systemInformation);
+    info->NumberOfHandles = 0;
+    info->Reserved = 0;
+
+    auto append = [&](DWORD pid, ULONG_PTR handleValue, uint32_t node, ACCESS_MASK access) {
+        SYSTEM_HANDLE_TABLE_ENTRY_INFO_EX& out = info->Handles[info->NumberOfHandles++];
+        out = {};
+        // Fake but stable kernel address per node slot.
+        out.Object = reinterpret_cast<PVOID>(static_cast<ULONG_PTR>(0x10000) + (static_cast<ULONG_PTR>(node) << 4));
+        out.UniqueProcessId = pid;
+        out.HandleValue = handleValue;
+        out.GrantedAccess = access;
+        out.ObjectTypeIndex = static_cast<USHORT>(nodes[node].typeIndex + FirstTypeIndex);
+    };
+
+    for (const auto& [pid, table] : processHandles) {
+        for (const auto& handle : table) {
+            if (nodeIsValid(handle.node, handle.generation)) {
+                append(pid, handle.handleValue, handle.node, handle.access);
+            }
+        }
+    }
+    for (const auto& [value, entry] : handles) {
+        if (entry.kind == HandleKind::Object && nodeIsValid(entry.node, entry.generation)) {
+            append(CurrentProcessId, value, entry.node, entry.access);
+        }
+    }
+
+    if (returnLength) {
+        *returnLength = static_cast<ULONG>(offsetof(SYSTEM_HANDLE_INFORMATION_EX, Handles) +
+            info->NumberOfHandles * sizeof(SYSTEM_HANDLE_TABLE_ENTRY_INFO_EX));
+    }
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS SimulatedNtApi::duplicateObject(HANDLE sourceProcessHandle, HANDLE sourceHandle, HANDLE targetProcessHandle,
+    PHANDLE targetHandle, ACCESS_MASK desiredAccess, ULONG handleAttributes, ULONG options) {
+    (void)targetProcessHandle;
+    (void)handleAttributes;
+
+    NTSTATUS status = injectFault();
+    if (!NT_SUCCESS(status)) {
+        return status;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(stateLock);
+    uint32_t node = InvalidIndex;
+    uint32_t generation = 0;
+    ACCESS_MASK access = desiredAccess;
+
+    if (sourceProcessHandle == currentProcess()) {
+        HandleEntry source;
+        if (!lookupHandleLocked(sourceHandle, source) || source.kind != HandleKind::Object) {
+            return STATUS_INVALID_HANDLE;
+        }
+        node = source.node;
+        generation = source.generation;
+        if (options & DUPLICATE_SAME_ACCESS) {
+            access = source.access;
+        }
+    }
+    else {
+        HandleEntry process;
+        if (!lookupHandleLocked(sourceProcessHandle, process) || process.kind != HandleKind::Process) {
+            return STATUS_INVALID_HANDLE;
+        }
+
+        auto table = processHandles.find(process.processId);
+        if (table == processHandles.end()) {
+            return STATUS_INVALID_HANDLE;
+        }
+        auto it = std::find_if(table->second.begin(), table->second.end(),
+            [sourceHandle](const ProcessHandle& h) { return h.handleValue == fromHandle(sourceHandle); });
+        if (it == table->second.end()) {
+            return STATUS_INVALID_HANDLE;
+        }
+        node = it->node;
+        generation = it->generation;
+        if (options & DUPLICATE_SAME_ACCESS) {
+            access = it->access;
+        }
+    }
+
+    if (!nodeIsValid(node, generation)) {
+        return STATUS_INVALID_HANDLE;
+    }
+
+    *targetHandle = allocateHandleLocked({ HandleKind::Object, node, generation, 0, access });
+    return STATUS_SUCCESS;
+}
+
+NTSTATUS SimulatedNtApi::close(HANDLE handle) {
+    std::unique_lock<std::shared_mutex> lock(stateLock);
+    auto it = handles.find(fromHandle(handle));
+    if (it == handles.end()) {
+        return STATUS_INVALID_HANDLE;
+    }
+
+    const HandleEntry& entry = it->second;
+    if (entry.kind == HandleKind::Object && nodeIsValid(entry.node, entry.generation) &&
+        nodes[entry.node].handleCount > 0) {
+        nodes[entry.node].handleCount--;
+        typeHandleCounts[nodes[entry.node].typeIndex]--;
+    }
+    handles.erase(it);
+    return STATUS_SUCCESS;
+}
+
+bool SimulatedNtApi::enumerateProcesses(std::vector<DWORD>& processIds) {
+    std::shared_lock<std::shared_mutex> lock(stateLock);
+    processIds.clear();
+    for (const auto& [pid, table] : processHandles) {
+        processIds.push_back(pid);
+    }
+    std::sort(processIds.begin(), processIds.end());
+    return true;
+}
+
+HANDLE SimulatedNtApi::openProcess(ACCESS_MASK desiredAccess, DWORD processId) {
+    if (!NT_SUCCESS(injectFault())) {
+        return nullptr;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(stateLock);
+    if (!processHandles.count(processId)) {
+        return nullptr;
+    }
+    return allocateHandleLocked({ HandleKind::Process, InvalidIndex, 0, processId, desiredAccess });
+}
+
+HANDLE SimulatedNtApi::currentProcess() {
+    // Same pseudo-handle value GetCurrentProcess() returns.
+    return toHandle(static_cast<ULONG_PTR>(-1));
+}
+
+DWORD SimulatedNtApi::currentProcessId() {
+    return CurrentProcessId;
+}
+
+void SimulatedNtApi::startChurn(const ChurnConfig& config) {
+    stopChurn();
+    createDirectory(config.directory);
+
+    std::lock_guard<std::mutex> lock(churnMutex);
+    churnRunning = true;
+    churner = std::thread(&SimulatedNtApi::churnThread, this, config);
+}
+
+void SimulatedNtApi::stopChurn() {
+    {
+        std::lock_guard<std::mutex> lock(churnMutex);
+        churnRunning = false;
+    }
+    churnWakeup.notify_all();
+
+    if (churner.joinable()) {
+        churner.join();
+    }
+}
+
+void SimulatedNtApi::churnThread(ChurnConfig config) {
+    using Clock = std::chrono::steady_clock;
+    const auto step = std::chrono::milliseconds(10);
+
+    std::deque<std::pair<Clock::time_point, std::wstring>> alive;
+    std::wstring prefix = config.directory;
+    if (prefix.back() != L'\\') {
+        prefix += L'\\';
+    }
+    prefix += config.namePrefix;
+
+    uint64_t sequence = 0;
+    double pending = 0.0;
+    auto last = Clock::now();
+
+    std::unique_lock<std::mutex> lock(churnMutex);
+    while (churnRunning) {
+        lock.unlock();
+
+        auto now = Clock::now();
+        pending += config.createsPerSecond * std::chrono::duration<double>(now - last).count();
+        last = now;
+
+        while (pending >= 1.0) {
+            std::wstring path = prefix + std::to_wstring(sequence++);
+            if (NT_SUCCESS(createObject(path, config.objectType))) {
+                alive.emplace_back(now + config.objectLifetime, std::move(path));
+                churnCreatedCount.fetch_add(1, std::memory_order_relaxed);
+            }
+            pending -= 1.0;
+        }
+
+        while (!alive.empty() && alive.front().first <= now) {
+            if (NT_SUCCESS(deleteObject(alive.front().second))) {
+                churnDeletedCount.fetch_add(1, std::memory_order_relaxed);
+            }
+            alive.pop_front();
+        }
+
+        lock.lock();
+        churnWakeup.wait_for(lock, step, [this] { return !churnRunning; });
+    }
+    lock.unlock();
+
+    for (const auto& [deadline, path] : alive) {
+        if (NT_SUCCESS(deleteObject(path))) {
+            churnDeletedCount.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
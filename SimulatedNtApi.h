@@ -0,0 +1,199 @@
+#pragma once
+#include "NtApi.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Latency and error injection applied to every simulated call.
+struct SimulatedFaults {
+    std::chrono::microseconds callLatency{ 0 };
+    std::chrono::microseconds latencyJitter{ 0 };
+    double failureRate = 0.0;
+    NTSTATUS failureStatus = STATUS_INSUFFICIENT_RESOURCES;
+    // Name queries on File objects sleep this long, standing in for pipe
+    // handles whose ObjectNameInformation query never returns.
+    std::chrono::milliseconds nameQueryStall{ 0 };
+};
+
+// Background create/delete workload against a single directory. Each object
+// lives for objectLifetime, so the steady-state population is roughly
+// createsPerSecond * objectLifetime.
+struct ChurnConfig {
+    std::wstring directory = L"\\BaseNamedObjects";
+    std::wstring objectType = L"Event";
+    std::wstring namePrefix = L"Churn_";
+    unsigned createsPerSecond = 1000;
+    std::chrono::milliseconds objectLifetime{ 500 };
+};
+
+// In-memory Object Manager namespace. Nodes live in one flat vector and
+// directories keep a slot array (the enumeration order) plus a
+// case-insensitive name index, which keeps millions of objects affordable.
+class SimulatedNtApi : public NtApi {
+public:
+    SimulatedNtApi();
+    ~SimulatedNtApi() override;
+
+    // Namespace construction. Paths are absolute, e.g. L"\\BaseNamedObjects\\Foo".
+    NTSTATUS createDirectory(const std::wstring& path);
+    NTSTATUS createObject(const std::wstring& path, const std::wstring& typeName);
+    NTSTATUS createSymbolicLink(const std::wstring& path, const std::wstring& target);
+    NTSTATUS deleteObject(const std::wstring& path);
+    size_t populate(const std::wstring& directory, const std::wstring& typeName,
+        const std::wstring& namePrefix, size_t count);
+    void populateDefaultNamespace();
+    size_t objectCount() const;
+
+    // Synthetic processes and their handle-table entries.
+    void addProcess(DWORD processId);
+    NTSTATUS addProcessHandle(DWORD processId, const std::wstring& objectPath, ACCESS_MASK grantedAccess);
+
+    void setFaults(const SimulatedFaults& faults);
+
+    void startChurn(const ChurnConfig& config);
+    void stopChurn();
+    uint64_t churnCreated() const { return churnCreatedCount.load(std::memory_order_relaxed); }
+    uint64_t churnDeleted() const { return churnDeletedCount.load(std::memory_order_relaxed); }
+
+    NTSTATUS openDirectoryObject(PHANDLE directoryHandle, ACCESS_MASK desiredAccess, POBJECT_ATTRIBUTES objectAttributes) override;
+    NTSTATUS queryDirectoryObject(HANDLE directoryHandle, PVOID buffer, ULONG length, BOOLEAN returnSingleEntry,
+        BOOLEAN restartScan, PULONG context, PULONG returnLength) override;
+
+    NTSTATUS openSymbolicLinkObject(PHANDLE linkHandle, ACCESS_MASK desiredAccess, POBJECT_ATTRIBUTES objectAttributes) override;
+    NTSTATUS querySymbolicLinkObject(HANDLE linkHandle, PUNICODE_STRING linkTarget, PULONG returnedLength) override;
+
+    NTSTATUS openEvent(PHANDLE eventHandle, ACCESS_MASK desiredAccess, POBJECT_ATTRIBUTES objectAttributes) override;
+    NTSTATUS openSection(PHANDLE sectionHandle, ACCESS_MASK desiredAccess, POBJECT_ATTRIBUTES objectAttributes) override;
+    NTSTATUS openMutant(PHANDLE mutantHandle, ACCESS_MASK desiredAccess, POBJECT_ATTRIBUTES objectAttributes) override;
+    NTSTATUS openSemaphore(PHANDLE semaphoreHandle, ACCESS_MASK desiredAccess, POBJECT_ATTRIBUTES objectAttributes) override;
+    NTSTATUS openTimer(PHANDLE timerHandle, ACCESS_MASK desiredAccess, POBJECT_ATTRIBUTES objectAttributes) override;
+    NTSTATUS openFile(PHANDLE fileHandle, ACCESS_MASK desiredAccess, POBJECT_ATTRIBUTES objectAttributes,
+        PIO_STATUS_BLOCK ioStatusBlock, ULONG shareAccess, ULONG openOptions) override;
+
+    NTSTATUS queryObject(HANDLE handle, OBJECT_INFORMATION_CLASS objectInformationClass, PVOID objectInformation,
+        ULONG objectInformationLength, PULONG returnLength) override;
+    NTSTATUS querySystemInformation(SYSTEM_INFORMATION_CLASS systemInformationClass, PVOID systemInformation,
+        ULONG systemInformationLength, PULONG returnLength) override;
+    NTSTATUS duplicateObject(HANDLE sourceProcessHandle, HANDLE sourceHandle, HANDLE targetProcessHandle,
+        PHANDLE targetHandle, ACCESS_MASK desiredAccess, ULONG handleAttributes, ULONG options) override;
+
+    NTSTATUS close(HANDLE handle) override;
+
+    bool enumerateProcesses(std::vector<DWORD>& processIds) override;
+    HANDLE openProcess(ACCESS_MASK desiredAccess, DWORD processId) override;
+    HANDLE currentProcess() override;
+    DWORD currentProcessId() override;
+
+    static constexpr DWORD CurrentProcessId = 4242;
+
+private:
+    static constexpr uint32_t InvalidIndex = UINT32_MAX;
+
+    struct Node {
+        std::wstring name;
+        uint32_t parent = InvalidIndex;
+        uint32_t slot = InvalidIndex;
+        uint32_t directory = InvalidIndex;
+        uint32_t generation = 0;
+        uint32_t handleCount = 0;
+        uint16_t typeIndex = 0;
+        bool live = false;
+        LONGLONG creationTime = 0;
+    };
+
+    // A removed entry leaves its slot empty, but the resume context counts
+    // entries, as the kernel's does: removing one ahead of a caller's
+    // cursor moves the entries after it back by one. liveCounts is a
+    // Fenwick tree over the slots, so an entry ordinal maps to its slot in
+    // O(log n).
+    struct Directory {
+        std::vector<uint32_t> slots;
+        std::vector<uint32_t> freeSlots;
+        std::vector<uint32_t> liveCounts;
+        std::unordered_map<std::wstring, uint32_t> byName;
+
+        // Appends an empty slot.
+        void addSlot();
+        void setLive(size_t slot, bool live);
+        // Live entries in the slots before slot.
+        size_t liveBefore(size_t slot) const;
+        // The slot holding entry ordinal, or slots.size() past the last.
+        size_t slotOfEntry(size_t ordinal) const;
+    };
+
+    enum class HandleKind {
+        Object,
+        Process
+    };
+
+    struct HandleEntry {
+        HandleKind kind;
+        uint32_t node;
+        uint32_t generation;
+        DWORD processId;
+        ACCESS_MASK access;
+    };
+
+    struct ProcessHandle {
+        ULONG_PTR handleValue;
+        uint32_t node;
+        uint32_t generation;
+        ACCESS_MASK access;
+    };
+
+    NTSTATUS injectFault();
+
+    static std::wstring foldName(const wchar_t* name, size_t length);
+    static LONGLONG currentNtTime();
+
+    uint16_t internType(const std::wstring& typeName);
+    NTSTATUS resolveLocked(const OBJECT_ATTRIBUTES* objectAttributes, uint32_t& node) const;
+    NTSTATUS resolvePathLocked(uint32_t start, const std::wstring& path, int depth, uint32_t& node) const;
+    NTSTATUS resolveParentLocked(const std::wstring& path, uint32_t& parent, std::wstring& leafName);
+    NTSTATUS insertLocked(uint32_t parent, const std::wstring& name, uint16_t typeIndex, uint32_t& node);
+    void removeLocked(uint32_t node);
+    std::wstring fullPathLocked(uint32_t node) const;
+    bool nodeIsValid(uint32_t node, uint32_t generation) const;
+
+    NTSTATUS queryObjectTypesLocked(PVOID objectInformation, ULONG objectInformationLength, PULONG returnLength) const;
+    NTSTATUS openTyped(PHANDLE handle, ACCESS_MASK desiredAccess, POBJECT_ATTRIBUTES objectAttributes, const wchar_t* requiredType);
+    HANDLE allocateHandleLocked(const HandleEntry& entry);
+    bool lookupHandleLocked(HANDLE handle, HandleEntry& entry) const;
+
+    void churnThread(ChurnConfig config);
+
+    mutable std::shared_mutex stateLock;
+    std::vector<Node> nodes;
+    std::vector<uint32_t> freeNodes;
+    std::vector<Directory> directories;
+    std::vector<std::wstring> typeNames;
+    std::vector<size_t> typeObjectCounts;
+    std::vector<size_t> typeHandleCounts;
+    std::unordered_map<std::wstring, uint16_t> typeIndexByName;
+    std::unordered_map<uint32_t, std::wstring> linkTargets;
+    std::unordered_map<ULONG_PTR, HandleEntry> handles;
+    std::unordered_map<DWORD, std::vector<ProcessHandle>> processHandles;
+    ULONG_PTR nextHandleValue = 0x1000;
+    LONGLONG bootTime = 0;
+    size_t liveObjects = 0;
+
+    std::atomic<int64_t> faultLatencyMicros{ 0 };
+    std::atomic<int64_t> faultJitterMicros{ 0 };
+    std::atomic<uint32_t> faultFailurePerMillion{ 0 };
+    std::atomic<NTSTATUS> faultFailureStatus{ STATUS_INSUFFICIENT_RESOURCES };
+    std::atomic<int64_t> faultNameStallMillis{ 0 };
+
+    std::thread churner;
+    std::mutex churnMutex;
+    std::condition_variable churnWakeup;
+    bool churnRunning = false;
+    std::atomic<uint64_t> churnCreatedCount{ 0 };
+    std::atomic<uint64_t> churnDeletedCount{ 0 };
+};
@@ -0,0 +1,113 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+ThreadPool::ThreadPool(size_t threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(2u, std::thread::hardware_concurrency());
+    }
+
+    for (size_t i = 0; i < threadCount; i++) {
+        workers.emplace_back(&ThreadPool::workerThread, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueWakeup.notify_all();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        tasks.push_back(std::move(task));
+    }
+    queueWakeup.notify_one();
+}
+
+void ThreadPool::workerThread() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueWakeup.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty()) {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, size_t chunkSize, const std::function<void(size_t, size_t)>& body) {
+    if (count == 0) {
+        return;
+    }
+    chunkSize = std::max<size_t>(chunkSize, 1);
+    const size_t chunks = (count + chunkSize - 1) / chunkSize;
+
+    // Shared with the helper tasks, which may start after this call has
+    // returned; they only touch body while unclaimed chunks remain.
+    struct State {
+        std::atomic<size_t> nextChunk{ 0 };
+        size_t finishedChunks = 0;
+        std::exception_ptr error;
+        std::mutex mutex;
+        std::condition_variable done;
+    };
+    auto state = std::make_shared<State>();
+
+    auto run = [state, count, chunkSize, chunks, &body]() {
+        while (true) {
+            size_t chunk = state->nextChunk.fetch_add(1);
+            if (chunk >= chunks) {
+                return;
+            }
+
+            size_t begin = chunk * chunkSize;
+            std::exception_ptr error;
+            try {
+                body(begin, std::min(begin + chunkSize, count));
+            }
+            catch (...) {
+                error = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (error && !state->error) {
+                state->error = error;
+            }
+            if (++state->finishedChunks == chunks) {
+                state->done.notify_all();
+            }
+        }
+    };
+
+    size_t helpers = std::min(workers.size(), chunks - 1);
+    for (size_t i = 0; i < helpers; i++) {
+        submit(run);
+    }
+    run();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->done.wait(lock, [&state, chunks] { return state->finishedChunks == chunks; });
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads shared by the batch queries. parallelFor is
+// the main entry point: the calling thread takes chunks as well, so nested
+// or concurrent calls cannot deadlock waiting for busy workers.
+class ThreadPool {
+public:
+    // 0 threads means one per hardware thread.
+    explicit ThreadPool(size_t threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(std::function<void()> task);
+
+    // Calls body(begin, end) for consecutive ranges covering [0, count) and
+    // returns once all of them have run. The first exception thrown by body
+    // is rethrown here.
+    void parallelFor(size_t count, size_t chunkSize, const std::function<void(size_t, size_t)>& body);
+
+    size_t size() const { return workers.size(); }
+
+    static ThreadPool& shared();
+
+private:
+    void workerThread();
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex queueMutex;
+    std::condition_variable queueWakeup;
+    bool stopping = false;
+};
@@ -0,0 +1,123 @@
+#include "Timestamp.h"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+namespace {
+    // Wall-clock nanoseconds since the Unix epoch minus the steady tick.
+    std::atomic<int64_t> wallOffset{ 0 };
+    std::atomic<bool> anchored{ false };
+
+    const int64_t MillisPerDay = 86400000;
+
+    void putDigits(wchar_t* out, unsigned value, int width) {
+        for (int i = width - 1; i >= 0; i--) {
+            out[i] = static_cast<wchar_t>(L'0' + value % 10);
+            value /= 10;
+        }
+    }
+
+    // Days since 1970-01-01 to a proleptic Gregorian date.
+    void civilFromDays(int64_t days, int64_t& year, unsigned& month, unsigned& day) {
+        days += 719468;
+        const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+        const unsigned dayOfEra = static_cast<unsigned>(days - era * 146097);
+        const unsigned yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+        const unsigned dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+        const unsigned monthIndex = (5 * dayOfYear + 2) / 153;
+        day = dayOfYear - (153 * monthIndex + 2) / 5 + 1;
+        month = monthIndex < 10 ? monthIndex + 3 : monthIndex - 9;
+        year = static_cast<int64_t>(yearOfEra) + era * 400 + (month <= 2);
+    }
+}
+
+EventTick currentTick() {
+    return static_cast<EventTick>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+EventTick anchorWallClock() {
+    EventTick tick = currentTick();
+    int64_t wall = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    wallOffset.store(wall - static_cast<int64_t>(tick), std::memory_order_relaxed);
+    anchored.store(true, std::memory_order_release);
+    return tick;
+}
+
+std::chrono::nanoseconds threadCpuTime() {
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) {
+        return std::chrono::nanoseconds(0);
+    }
+    // FILETIME counts 100ns intervals.
+    uint64_t total = ((static_cast<uint64_t>(kernel.dwHighDateTime) << 32) | kernel.dwLowDateTime) +
+        ((static_cast<uint64_t>(user.dwHighDateTime) << 32) | user.dwLowDateTime);
+    return std::chrono::nanoseconds(total * 100);
+#else
+    timespec now{};
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now) != 0) {
+        return std::chrono::nanoseconds(0);
+    }
+    return std::chrono::seconds(now.tv_sec) + std::chrono::nanoseconds(now.tv_nsec);
+#endif
+}
+
+int64_t wallClockMillis(EventTick tick) {
+    if (!anchored.load(std::memory_order_acquire)) {
+        anchorWallClock();
+    }
+    int64_t nanos = static_cast<int64_t>(tick) + wallOffset.load(std::memory_order_relaxed);
+    return nanos / 1000000;
+}
+
+std::wstring_view TimestampFormatter::format(EventTick tick, Buffer& out) {
+    return formatMillis(wallClockMillis(tick), out);
+}
+
+std::wstring_view TimestampFormatter::formatMillis(int64_t unixMillis, Buffer& out) {
+    int64_t days = unixMillis >= 0 ? unixMillis / MillisPerDay : (unixMillis - MillisPerDay + 1) / MillisPerDay;
+    unsigned secondOfDay = static_cast<unsigned>((unixMillis - days * MillisPerDay) / 1000);
+
+    if (days != cachedDay) {
+        int64_t year;
+        unsigned month;
+        unsigned day;
+        civilFromDays(days, year, month, day);
+        setDate(year, month, day);
+        cachedDay = days;
+    }
+    return render(secondOfDay / 3600, secondOfDay / 60 % 60, secondOfDay % 60, out);
+}
+
+std::wstring_view TimestampFormatter::now(Buffer& out) {
+    return formatMillis(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count(), out);
+}
+
+void TimestampFormatter::setDate(int64_t year, unsigned month, unsigned day) {
+    putDigits(datePrefix, static_cast<unsigned>(year), 4);
+    datePrefix[4] = L'-';
+    putDigits(datePrefix + 5, month, 2);
+    datePrefix[7] = L'-';
+    putDigits(datePrefix + 8, day, 2);
+    datePrefix[10] = L' ';
+}
+
+std::wstring_view TimestampFormatter::render(unsigned hour, unsigned minute, unsigned second, Buffer& out) {
+    std::memcpy(out, datePrefix, sizeof(datePrefix));
+    putDigits(out + 11, hour, 2);
+    out[13] = L':';
+    putDigits(out + 14, minute, 2);
+    out[16] = L':';
+    putDigits(out + 17, second, 2);
+    out[Length] = L'\0';
+    return std::wstring_view(out, Length);
+}
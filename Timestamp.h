@@ -0,0 +1,45 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Monotonic event time in steady-clock nanoseconds. Events carry only the
+// tick; wall-clock time is recovered from the latest anchor when rendered.
+using EventTick = uint64_t;
+
+EventTick currentTick();
+
+// Re-pairs the steady clock with the wall clock and returns the tick it
+// was paired at. The monitor calls this once per scan, so clock
+// adjustments are picked up within one tick.
+EventTick anchorWallClock();
+
+// CPU time the calling thread has used so far, user and kernel.
+std::chrono::nanoseconds threadCpuTime();
+
+// Milliseconds since the Unix epoch (UTC) at tick.
+int64_t wallClockMillis(EventTick tick);
+
+// Renders "YYYY-MM-DD HH:MM:SS" (UTC) into a caller-owned buffer without
+// streams or allocation. The date part is cached, so while consecutive
+// timestamps fall on the same day only the time of day is redrawn. Not
+// thread-safe; give each thread its own formatter.
+class TimestampFormatter {
+public:
+    static constexpr size_t Length = 19;
+    using Buffer = wchar_t[Length + 1];
+
+    std::wstring_view format(EventTick tick, Buffer& out);
+    std::wstring_view formatMillis(int64_t unixMillis, Buffer& out);
+    std::wstring_view now(Buffer& out);
+
+private:
+    static constexpr size_t DateLength = 11;
+
+    void setDate(int64_t year, unsigned month, unsigned day);
+    std::wstring_view render(unsigned hour, unsigned minute, unsigned second, Buffer& out);
+
+    int64_t cachedDay = INT64_MIN;
+    wchar_t datePrefix[DateLength] = {};
+};
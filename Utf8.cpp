@@ -0,0 +1,189 @@
+#include "Utf8.h"
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define UTF8_USE_SSE2 1
+#endif
+
+namespace {
+    // Copies the leading ASCII characters of text to out as bytes and
+    // returns how many there were.
+    template <typename Unit>
+    size_t copyAscii(const Unit* text, size_t size, char* out) {
+        size_t i = 0;
+#ifdef UTF8_USE_SSE2
+        const __m128i zero = _mm_setzero_si128();
+        if constexpr (sizeof(Unit) == 2) {
+            const __m128i high = _mm_set1_epi16(static_cast<short>(0xFF80));
+            while (i + 16 <= size) {
+                __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+                __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i + 8));
+                __m128i nonAscii = _mm_and_si128(_mm_or_si128(a, b), high);
+                if (_mm_movemask_epi8(_mm_cmpeq_epi16(nonAscii, zero)) != 0xFFFF) {
+                    break;
+                }
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(a, b));
+                i += 16;
+            }
+        }
+        else if constexpr (sizeof(Unit) == 4) {
+            const __m128i high = _mm_set1_epi32(static_cast<int>(0xFFFFFF80));
+            while (i + 16 <= size) {
+                __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+                __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i + 4));
+                __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i + 8));
+                __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i + 12));
+                __m128i nonAscii = _mm_and_si128(_mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d)), high);
+                if (_mm_movemask_epi8(_mm_cmpeq_epi32(nonAscii, zero)) != 0xFFFF) {
+                    break;
+                }
+                __m128i low = _mm_packs_epi32(a, b);
+                __m128i upper = _mm_packs_epi32(c, d);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packus_epi16(low, upper));
+                i += 16;
+            }
+        }
+#endif
+        while (i < size && static_cast<uint32_t>(text[i]) < 0x80) {
+            out[i] = static_cast<char>(text[i]);
+            i++;
+        }
+        return i;
+    }
+
+    template <typename Unit>
+    void encodeUtf8(std::string& out, const Unit* text, size_t size) {
+        // Worst case: three bytes per UTF-16 unit, four per UTF-32 one.
+        size_t start = out.size();
+        out.resize(start + size * (sizeof(Unit) == 2 ? 3 : 4));
+        char* begin = &out[start];
+        char* p = begin;
+
+        size_t i = 0;
+        while (i < size) {
+            size_t ascii = copyAscii(text + i, size - i, p);
+            i += ascii;
+            p += ascii;
+
+            for (; i < size && static_cast<uint32_t>(text[i]) >= 0x80; i++) {
+                uint32_t c = static_cast<uint32_t>(text[i]);
+
+                // UTF-16 surrogate pair.
+                if (c >= 0xD800 && c <= 0xDBFF && i + 1 < size) {
+                    uint32_t low = static_cast<uint32_t>(text[i + 1]);
+                    if (low >= 0xDC00 && low <= 0xDFFF) {
+                        c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+                        i++;
+                    }
+                }
+
+                if (c < 0x800) {
+                    *p++ = static_cast<char>(0xC0 | (c >> 6));
+                    *p++ = static_cast<char>(0x80 | (c & 0x3F));
+                }
+                else if (c < 0x10000) {
+                    *p++ = static_cast<char>(0xE0 | (c >> 12));
+                    *p++ = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+                    *p++ = static_cast<char>(0x80 | (c & 0x3F));
+                }
+                else {
+                    *p++ = static_cast<char>(0xF0 | (c >> 18));
+                    *p++ = static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+                    *p++ = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+                    *p++ = static_cast<char>(0x80 | (c & 0x3F));
+                }
+            }
+        }
+
+        out.resize(start + static_cast<size_t>(p - begin));
+    }
+}
+
+void appendUtf8(std::string& out, std::wstring_view text) {
+    encodeUtf8(out, text.data(), text.size());
+}
+
+void appendUtf8(std::string& out, std::u16string_view text) {
+    encodeUtf8(out, text.data(), text.size());
+}
+
+void appendWide(std::wstring& out, std::string_view utf8) {
+    size_t i = 0;
+    while (i < utf8.size()) {
+        uint32_t c = static_cast<unsigned char>(utf8[i]);
+        if (c < 0x80) {
+            out += static_cast<wchar_t>(c);
+            i++;
+            continue;
+        }
+
+        size_t length = c < 0xE0 ? 2 : c < 0xF0 ? 3 : 4;
+        if (c < 0xC0) {
+            length = 1;
+        }
+        if (i + length > utf8.size()) {
+            length = 1;
+        }
+
+        if (length == 2) {
+            c &= 0x1F;
+        }
+        else if (length == 3) {
+            c &= 0x0F;
+        }
+        else if (length == 4) {
+            c &= 0x07;
+        }
+        for (size_t j = 1; j < length; j++) {
+            c = (c << 6) | (static_cast<unsigned char>(utf8[i + j]) & 0x3F);
+        }
+        i += length;
+
+        if (c >= 0x10000 && sizeof(wchar_t) == 2) {
+            c -= 0x10000;
+            out += static_cast<wchar_t>(0xD800 + (c >> 10));
+            out += static_cast<wchar_t>(0xDC00 + (c & 0x3FF));
+        }
+        else {
+            out += static_cast<wchar_t>(c);
+        }
+    }
+}
+
+void appendUtf16(std::u16string& out, std::wstring_view text) {
+    if constexpr (sizeof(wchar_t) == 2) {
+        out.append(text.begin(), text.end());
+        return;
+    }
+
+    out.reserve(out.size() + text.size());
+    for (wchar_t wide : text) {
+        uint32_t c = static_cast<uint32_t>(wide);
+        if (c >= 0x10000 && c <= 0x10FFFF) {
+            c -= 0x10000;
+            out += static_cast<char16_t>(0xD800 + (c >> 10));
+            out += static_cast<char16_t>(0xDC00 + (c & 0x3FF));
+        }
+        else {
+            out += static_cast<char16_t>(c);
+        }
+    }
+}
+
+void appendWide(std::wstring& out, std::u16string_view text) {
+    if constexpr (sizeof(wchar_t) == 2) {
+        out.append(text.begin(), text.end());
+        return;
+    }
+
+    out.reserve(out.size() + text.size());
+    for (size_t i = 0; i < text.size(); i++) {
+        uint32_t c = text[i];
+        if (c >= 0xD800 && c <= 0xDBFF && i + 1 < text.size() && text[i + 1] >= 0xDC00 && text[i + 1] <= 0xDFFF) {
+            c = 0x10000 + ((c - 0xD800) << 10) + (text[i + 1] - 0xDC00);
+            i++;
+        }
+        out += static_cast<wchar_t>(c);
+    }
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+// Conversions between wide strings (UTF-16 on Windows, UTF-32 elsewhere),
+// UTF-16 and UTF-8 for the files this tool writes and reads back.
+// Unpaired surrogates and malformed UTF-8 are passed through as best they
+// can be rather than rejected.
+//
+// The UTF-8 encoders copy runs of ASCII, which is nearly all of an Object
+// Manager name, sixteen characters at a time where SSE2 is available.
+void appendUtf8(std::string& out, std::wstring_view text);
+void appendUtf8(std::string& out, std::u16string_view text);
+void appendWide(std::wstring& out, std::string_view utf8);
+
+// Names are stored as UTF-16 wherever many of them are kept, so they take
+// two bytes per character even where wchar_t is four.
+void appendUtf16(std::u16string& out, std::wstring_view text);
+void appendWide(std::wstring& out, std::u16string_view text);
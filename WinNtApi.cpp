@@ -0,0 +1,178 @@
+#include "WinNtApi.h"
+
+#ifdef _WIN32
+#include "DirectoryHandlePool.h"
+#include <psapi.h>
+
+#pragma comment(lib, "ntdll.lib")
+
+extern "C" {
+    NTSTATUS NTAPI NtOpenDirectoryObject(
+        OUT PHANDLE DirectoryHandle,
+        IN ACCESS_MASK DesiredAccess,
+        IN POBJECT_ATTRIBUTES ObjectAttributes
+    );
+
+    NTSTATUS NTAPI NtQueryDirectoryObject(
+        IN HANDLE DirectoryHandle,
+        OUT PVOID Buffer,
+        IN ULONG Length,
+        IN BOOLEAN ReturnSingleEntry,
+        IN BOOLEAN RestartScan,
+        IN OUT PULONG Context,
+        OUT PULONG ReturnLength OPTIONAL
+    );
+
+    NTSTATUS NTAPI NtOpenSymbolicLinkObject(
+        OUT PHANDLE LinkHandle,
+        IN ACCESS_MASK DesiredAccess,
+        IN POBJECT_ATTRIBUTES ObjectAttributes
+    );
+
+    NTSTATUS NTAPI NtQuerySymbolicLinkObject(
+        IN HANDLE LinkHandle,
+        IN OUT PUNICODE_STRING LinkTarget,
+        OUT PULONG ReturnedLength OPTIONAL
+    );
+
+    NTSTATUS NTAPI NtOpenEvent(
+        OUT PHANDLE EventHandle,
+        IN ACCESS_MASK DesiredAccess,
+        IN POBJECT_ATTRIBUTES ObjectAttributes
+    );
+
+    NTSTATUS NTAPI NtOpenSection(
+        OUT PHANDLE SectionHandle,
+        IN ACCESS_MASK DesiredAccess,
+        IN POBJECT_ATTRIBUTES ObjectAttributes
+    );
+
+    NTSTATUS NTAPI NtOpenMutant(
+        OUT PHANDLE MutantHandle,
+        IN ACCESS_MASK DesiredAccess,
+        IN POBJECT_ATTRIBUTES ObjectAttributes
+    );
+
+    NTSTATUS NTAPI NtOpenSemaphore(
+        OUT PHANDLE SemaphoreHandle,
+        IN ACCESS_MASK DesiredAccess,
+        IN POBJECT_ATTRIBUTES ObjectAttributes
+    );
+
+    NTSTATUS NTAPI NtOpenTimer(
+        OUT PHANDLE TimerHandle,
+        IN ACCESS_MASK DesiredAccess,
+        IN POBJECT_ATTRIBUTES ObjectAttributes
+    );
+
+    NTSTATUS NTAPI NtDuplicateObject(
+        IN HANDLE SourceProcessHandle,
+        IN HANDLE SourceHandle,
+        IN HANDLE TargetProcessHandle OPTIONAL,
+        OUT PHANDLE TargetHandle OPTIONAL,
+        IN ACCESS_MASK DesiredAccess,
+        IN ULONG HandleAttributes,
+        IN ULONG Options
+    );
+}
+
+WinNtApi::~WinNtApi() {
+    // Stops the pool's sweeper before it can close through a destroyed backend.
+    DirectoryHandlePool::discard(*this);
+}
+
+NTSTATUS WinNtApi::openDirectoryObject(PHANDLE directoryHandle, ACCESS_MASK desiredAccess, POBJECT_ATTRIBUTES objectAttributes) {
+    return NtOpenDirectoryObject(directoryHandle, desiredAccess, objectAttributes);
+}
+
+NTSTATUS WinNtApi::queryDirectoryObject(HANDLE directoryHandle, PVOID buffer, ULONG length, BOOLEAN returnSingleEntry,
+    BOOLEAN restartScan, PULONG context, PULONG returnLength) {
+    return NtQueryDirectoryObject(directoryHandle, buffer, length, returnSingleEntry, restartScan, context, returnLength);
+}
+
+NTSTATUS WinNtApi::openSymbolicLinkObject(PHANDLE linkHandle, ACCESS_MASK desiredAccess, POBJECT_ATTRIBUTES objectAttributes) {
+    return NtOpenSymbolicLinkObject(linkHandle, desiredAccess, objectAttributes);
+}
+
+NTSTATUS WinNtApi::querySymbolicLinkObject(HANDLE linkHandle, PUNICODE_STRING linkTarget, PULONG returnedLength) {
+    return NtQuerySymbolicLinkObject(linkHandle, linkTarget, returnedLength);
+}
+
+NTSTATUS WinNtApi::openEvent(PHANDLE eventHandle, ACCESS_MASK desiredAccess, POBJECT_ATTRIBUTES objectAttributes) {
+    return NtOpenEvent(eventHandle, desiredAccess, objectAttributes);
+}
+
+NTSTATUS WinNtApi::openSection(PHANDLE sectionHandle, ACCESS_MASK desiredAccess, POBJECT_ATTRIBUTES objectAttributes) {
+    return NtOpenSection(sectionHandle, desiredAccess, objectAttributes);
+}
+
+NTSTATUS WinNtApi::openMutant(PHANDLE mutantHandle, ACCESS_MASK desiredAccess, POBJECT_ATTRIBUTES objectAttributes) {
+    return NtOpenMutant(mutantHandle, desiredAccess, objectAttributes);
+}
+
+NTSTATUS WinNtApi::openSemaphore(PHANDLE semaphoreHandle, ACCESS_MASK desiredAccess, POBJECT_ATTRIBUTES objectAttributes) {
+    return NtOpenSemaphore(semaphoreHandle, desiredAccess, objectAttributes);
+}
+
+NTSTATUS WinNtApi::openTimer(PHANDLE timerHandle, ACCESS_MASK desiredAccess, POBJECT_ATTRIBUTES objectAttributes) {
+    return NtOpenTimer(timerHandle, desiredAccess, objectAttributes);
+}
+
+NTSTATUS WinNtApi::openFile(PHANDLE fileHandle, ACCESS_MASK desiredAccess, POBJECT_ATTRIBUTES objectAttributes,
+    PIO_STATUS_BLOCK ioStatusBlock, ULONG shareAccess, ULONG openOptions) {
+    return NtOpenFile(fileHandle, desiredAccess, objectAttributes, ioStatusBlock, shareAccess, openOptions);
+}
+
+NTSTATUS WinNtApi::queryObject(HANDLE handle, OBJECT_INFORMATION_CLASS objectInformationClass, PVOID objectInformation,
+    ULONG objectInformationLength, PULONG returnLength) {
+    return NtQueryObject(handle, objectInformationClass, objectInformation, objectInformationLength, returnLength);
+}
+
+NTSTATUS WinNtApi::querySystemInformation(SYSTEM_INFORMATION_CLASS systemInformationClass, PVOID systemInformation,
+    ULONG systemInformationLength, PULONG returnLength) {
+    return NtQuerySystemInformation(systemInformationClass, systemInformation, systemInformationLength, returnLength);
+}
+
+NTSTATUS WinNtApi::duplicateObject(HANDLE sourceProcessHandle, HANDLE sourceHandle, HANDLE targetProcessHandle,
+    PHANDLE targetHandle, ACCESS_MASK desiredAccess, ULONG handleAttributes, ULONG options) {
+    return NtDuplicateObject(sourceProcessHandle, sourceHandle, targetProcessHandle, targetHandle,
+        desiredAccess, handleAttributes, options);
+}
+
+NTSTATUS WinNtApi::close(HANDLE handle) {
+    return NtClose(handle);
+}
+
+bool WinNtApi::enumerateProcesses(std::vector<DWORD>& processIds) {
+    processIds.resize(1024);
+
+    while (true) {
+        DWORD cbNeeded = 0;
+        DWORD cbBuffer = static_cast<DWORD>(processIds.size() * sizeof(DWORD));
+        if (!EnumProcesses(processIds.data(), cbBuffer, &cbNeeded)) {
+            processIds.clear();
+            return false;
+        }
+
+        // A full buffer may mean the list was truncated.
+        if (cbNeeded < cbBuffer) {
+            processIds.resize(cbNeeded / sizeof(DWORD));
+            return true;
+        }
+        processIds.resize(processIds.size() * 2);
+    }
+}
+
+HANDLE WinNtApi::openProcess(ACCESS_MASK desiredAccess, DWORD processId) {
+    return OpenProcess(desiredAccess, FALSE, processId);
+}
+
+HANDLE WinNtApi::currentProcess() {
+    return GetCurrentProcess();
+}
+
+DWORD WinNtApi::currentProcessId() {
+    return GetCurrentProcessId();
+}
+
+#endif
@@ -0,0 +1,41 @@
+#pragma once
+#include "NtApi.h"
+
+#ifdef _WIN32
+
+// Production backend: forwards every call straight to ntdll.
+class WinNtApi : public NtApi {
+public:
+    ~WinNtApi() override;
+
+    NTSTATUS openDirectoryObject(PHANDLE directoryHandle, ACCESS_MASK desiredAccess, POBJECT_ATTRIBUTES objectAttributes) override;
+    NTSTATUS queryDirectoryObject(HANDLE directoryHandle, PVOID buffer, ULONG length, BOOLEAN returnSingleEntry,
+        BOOLEAN restartScan, PULONG context, PULONG returnLength) override;
+
+    NTSTATUS openSymbolicLinkObject(PHANDLE linkHandle, ACCESS_MASK desiredAccess, POBJECT_ATTRIBUTES objectAttributes) override;
+    NTSTATUS querySymbolicLinkObject(HANDLE linkHandle, PUNICODE_STRING linkTarget, PULONG returnedLength) override;
+
+    NTSTATUS openEvent(PHANDLE eventHandle, ACCESS_MASK desiredAccess, POBJECT_ATTRIBUTES objectAttributes) override;
+    NTSTATUS openSection(PHANDLE sectionHandle, ACCESS_MASK desiredAccess, POBJECT_ATTRIBUTES objectAttributes) override;
+    NTSTATUS openMutant(PHANDLE mutantHandle, ACCESS_MASK desiredAccess, POBJECT_ATTRIBUTES objectAttributes) override;
+    NTSTATUS openSemaphore(PHANDLE semaphoreHandle, ACCESS_MASK desiredAccess, POBJECT_ATTRIBUTES objectAttributes) override;
+    NTSTATUS openTimer(PHANDLE timerHandle, ACCESS_MASK desiredAccess, POBJECT_ATTRIBUTES objectAttributes) override;
+    NTSTATUS openFile(PHANDLE fileHandle, ACCESS_MASK desiredAccess, POBJECT_ATTRIBUTES objectAttributes,
+        PIO_STATUS_BLOCK ioStatusBlock, ULONG shareAccess, ULONG openOptions) override;
+
+    NTSTATUS queryObject(HANDLE handle, OBJECT_INFORMATION_CLASS objectInformationClass, PVOID objectInformation,
+        ULONG objectInformationLength, PULONG returnLength) override;
+    NTSTATUS querySystemInformation(SYSTEM_INFORMATION_CLASS systemInformationClass, PVOID systemInformation,
+        ULONG systemInformationLength, PULONG returnLength) override;
+    NTSTATUS duplicateObject(HANDLE sourceProcessHandle, HANDLE sourceHandle, HANDLE targetProcessHandle,
+        PHANDLE targetHandle, ACCESS_MASK desiredAccess, ULONG handleAttributes, ULONG options) override;
+
+    NTSTATUS close(HANDLE handle) override;
+
+    bool enumerateProcesses(std::vector<DWORD>& processIds) override;
+    HANDLE openProcess(ACCESS_MASK desiredAccess, DWORD processId) override;
+    HANDLE currentProcess() override;
+    DWORD currentProcessId() override;
+};
+
+#endif
@@ -2,46 +2,71 @@
 #include "ObjectMonitor.h"
 #include "ReportGenerator.h" 
 #include "ObjectAnalyzer.h"
+#include "HandleResolver.h"
+#include "DependencyGraph.h"
+#include "Metrics.h"
+#include "MonitorBenchmark.h"
+#include "NamespaceIndex.h"
+#include "OutputSink.h"
+#include "SimulatedNtApi.h"
+#include "Timestamp.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <iomanip>
 #include <limits>
+#include <locale>
+#include <stdexcept>
 
-// Existing callback for object changes 
+// Runs on the monitor thread, which owns the formatter.
 void handleObjectChange(const ObjectChangeInfo& changeInfo) {
-    SYSTEMTIME& time = const_cast<SYSTEMTIME&>(changeInfo.timestamp);
-    std::wcout << std::setfill(L'0')
-        << time.wYear << L"-"
-        << std::setw(2) << time.wMonth << L"-"
-        << std::setw(2) << time.wDay << L" "
-        << std::setw(2) << time.wHour << L":"
-        << std::setw(2) << time.wMinute << L":"
-        << std::setw(2) << time.wSecond << L" - ";
+    static TimestampFormatter timestamps;
+    TimestampFormatter::Buffer time;
+    std::wcout << timestamps.format(changeInfo.tick, time) << L" - ";
+
+    if (changeInfo.changeType == ChangeType::Transient) {
+        std::wcout << changeInfo.count << L" short-lived " << changeInfo.objectType
+            << L" object(s) matching " << changeInfo.objectName << L" created and deleted\n";
+        return;
+    }
+    if (changeInfo.count > 1) {
+        std::wcout << changeInfo.count << L" " << changeInfo.objectType << L" object(s) matching "
+            << changeInfo.objectName << L" " << changeTypeName(changeInfo.changeType) << L"\n";
+        return;
+    }
 
     std::wcout << L"Object " << changeInfo.objectName
         << L" (" << changeInfo.objectType << L") "
-        << changeInfo.changeType << L"\n";
+        << changeTypeName(changeInfo.changeType) << L"\n";
 }
 
 // Callback for object analysis results
-void handleAnalysisResults(
-    const std::wstring& objectName,
-    const std::wstring& objectType,
-    ULONG handleCount,
-    ULONG referenceCount,
-    const std::vector<std::wstring>& linkedObjects,
-    ACCESS_MASK accessMask) {
-
-    std::wcout << L"\nAnalysis Results for: " << objectName << L"\n"
-        << L"Type: " << objectType << L"\n"
-        << L"Handle Count: " << handleCount << L"\n"
-        << L"Reference Count: " << referenceCount << L"\n"
-        << L"Access Mask: 0x" << std::hex << accessMask << std::dec << L"\n";
-
-    if (!linkedObjects.empty()) {
-        std::wcout << L"Linked Objects:\n";
-        for (const auto& obj : linkedObjects) {
-            std::wcout << L"  - " << obj << L"\n";
+void handleAnalysisResults(const AnalysisBatch& batch) {
+    for (const auto& result : batch) {
+        std::wcout << L"\nAnalysis Results for: " << result.objectName << L"\n"
+            << L"Type: " << result.objectType << L"\n";
+
+        if (!NT_SUCCESS(result.status)) {
+            std::wcout << L"Unavailable. Status: 0x" << std::hex << result.status << std::dec << L"\n";
+            continue;
+        }
+
+        std::wcout << L"Handle Count: " << result.handleCount << L"\n"
+            << L"Reference Count: " << result.referenceCount << L"\n"
+            << L"Access Mask: 0x" << std::hex << result.accessMask << std::dec << L"\n";
+
+        if (!result.linkTarget.empty() || result.processCount > 0) {
+            std::wcout << L"Linked Objects:\n";
+            if (!result.linkTarget.empty()) {
+                std::wcout << L"  - " << result.linkTarget << L"\n";
+            }
+            for (size_t i = 0; i < result.processCount; i++) {
+                std::wcout << L"  - Process:" << result.processIds[i] << L"\n";
+            }
         }
     }
 }
@@ -59,13 +84,55 @@ void printMenu() {
         << L"8. Generate Report\n"
         << L"9. Build dependency graph\n"
         << L"10. Show type statistics\n"
+        << L"11. Export metrics\n"
+        << L"12. Search namespace index\n"
+        << L"13. Audit all objects in a directory\n"
+        << L"14. Resolve system handles\n"
+        << L"15. Analyze object relations\n"
+        << L"16. Show handle statistics by type\n"
+        << L"17. Find first matching object in a directory\n"
+        << L"18. List a directory page by page\n"
         << L"Select an option: ";
 }
 
+void printMetricsFormatMenu() {
+    std::wcout << L"\nSelect metrics format:\n"
+        << L"1. Prometheus text\n"
+        << L"2. JSON\n"
+        << L"Select format: ";
+}
+
+void printIndexMenu() {
+    std::wcout << L"\nSelect index operation:\n"
+        << L"1. Rebuild index\n"
+        << L"2. Look up full path\n"
+        << L"3. Search by path prefix\n"
+        << L"4. Find name in any directory\n"
+        << L"Select operation: ";
+}
+
+void printIndexResults(const std::vector<NamespaceEntry>& results, std::chrono::steady_clock::duration elapsed) {
+    for (const auto& entry : results) {
+        std::wcout << L"Object: " << entry.path << L", Type: " << entry.type << L"\n";
+    }
+    std::wcout << results.size() << L" result(s) in "
+        << std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() << L" us\n";
+}
+
+void printOutputFormatMenu() {
+    std::wcout << L"\nSelect output format:\n"
+        << L"1. Human-readable\n"
+        << L"2. TSV\n"
+        << L"3. NDJSON\n"
+        << L"Select format: ";
+}
+
 void printReportFormatMenu() {
     std::wcout << L"\nSelect report format:\n"
         << L"1. HTML\n"
         << L"2. XML\n"
+        << L"3. Interactive HTML\n"
+        << L"4. Interactive HTML with data in sidecar files (very large namespaces)\n"
         << L"Select format: ";
 }
 
@@ -103,11 +170,121 @@ bool getValidatedBooleanInput(const std::wstring& prompt) {
     return input == 1;
 }
 
-int main() {
-    ObjectManagerExplorer explorer;
-    ObjectMonitor monitor;
-    ReportGenerator reporter;
-    ObjectAnalyzer analyzer;
+void printUsage() {
+    std::wcout << L"Usage: kursova [--simulate <objects>] [--churn <creates per second>] [--stall <ms>]\n"
+        << L"              [--coalesce <ms>]\n"
+        << L"              [--slice <entries>] [--section-timeout <ms>]\n"
+        << L"              [--bench-monitor <report file> [--bench-seconds <s>] [--seed <n>]]\n"
+        << L"  --simulate  run against an in-memory Object Manager with <objects> extra\n"
+        << L"              Events in \\BaseNamedObjects instead of the live kernel\n"
+        << L"  --churn     create and delete short-lived Events in the simulated namespace\n"
+        << L"  --stall     make name queries on simulated File handles block for <ms>\n"
+        << L"  --coalesce  report objects that live shorter than <ms> as per-window\n"
+        << L"              counts instead of individual Created/Deleted events\n"
+        << L"  --slice     let the monitor read at most <entries> directory entries per\n"
+        << L"              scan slice, resuming between slices\n"
+        << L"  --section-timeout  stop a report section after <ms> and keep its\n"
+        << L"              partial output\n"
+        << L"  --bench-monitor  measure the monitor's detection latency and losses under\n"
+        << L"              a simulated create/delete workload at several poll intervals,\n"
+        << L"              write the report to <report file> and exit. --simulate sets\n"
+        << L"              the background objects, --churn the creates per second\n";
+}
+
+int main(int argc, char* argv[]) {
+#ifndef _WIN32
+    // Wide streams need a UTF-8 locale for the report's box-drawing characters.
+    try {
+        std::locale::global(std::locale("C.UTF-8"));
+        std::wcout.imbue(std::locale());
+    }
+    catch (const std::runtime_error&) {
+    }
+#endif
+
+    std::unique_ptr<SimulatedNtApi> simulated;
+    unsigned long churnRate = 0;
+    unsigned long stallMillis = 0;
+    unsigned long coalesceMillis = 0;
+    unsigned long sliceEntries = 0;
+    unsigned long sectionTimeoutMillis = 0;
+    std::wstring benchReportPath;
+    MonitorBenchmarkConfig benchConfig;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--simulate" && i + 1 < argc) {
+            unsigned long objects = std::strtoul(argv[++i], nullptr, 10);
+            benchConfig.backgroundObjects = objects;
+            simulated = std::make_unique<SimulatedNtApi>();
+            simulated->populateDefaultNamespace();
+            simulated->populate(L"\\BaseNamedObjects", L"Event", L"LoadEvent_", objects);
+        }
+        else if (arg == "--churn" && i + 1 < argc) {
+            churnRate = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--stall" && i + 1 < argc) {
+            stallMillis = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--coalesce" && i + 1 < argc) {
+            coalesceMillis = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--slice" && i + 1 < argc) {
+            sliceEntries = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--section-timeout" && i + 1 < argc) {
+            sectionTimeoutMillis = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--bench-monitor" && i + 1 < argc) {
+            benchReportPath = std::filesystem::path(argv[++i]).wstring();
+        }
+        else if (arg == "--bench-seconds" && i + 1 < argc) {
+            benchConfig.duration = std::chrono::seconds(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--seed" && i + 1 < argc) {
+            benchConfig.seed = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else {
+            printUsage();
+            return 1;
+        }
+    }
+
+    if (!benchReportPath.empty()) {
+        if (churnRate > 0) {
+            benchConfig.createsPerSecond = static_cast<unsigned>(churnRate);
+        }
+        try {
+            MonitorBenchmark benchmark(benchConfig);
+            auto results = benchmark.run();
+            benchmark.saveReport(results, benchReportPath);
+            std::wcout << benchmark.renderReport(results);
+        }
+        catch (const std::exception& e) {
+            std::wcerr << L"Benchmark failed: " << e.what() << L"\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    if (simulated && churnRate > 0) {
+        ChurnConfig churn;
+        churn.createsPerSecond = static_cast<unsigned>(churnRate);
+        simulated->startChurn(churn);
+    }
+    if (simulated && stallMillis > 0) {
+        SimulatedFaults faults;
+        faults.nameQueryStall = std::chrono::milliseconds(stallMillis);
+        simulated->setFaults(faults);
+    }
+
+    NtApi& ntApi = simulated ? static_cast<NtApi&>(*simulated) : NtApi::system();
+    ObjectManagerExplorer explorer(ntApi);
+    ObjectMonitor monitor(ntApi);
+    ReportGenerator reporter(ntApi);
+    ObjectAnalyzer analyzer(ntApi);
+    NamespaceIndex index(ntApi);
+    HandleResolver handleResolver(ntApi);
 
     int choice;
     std::wstring path;
@@ -116,12 +293,23 @@ int main() {
     bool isMonitoring = false;
 
     monitor.setChangeCallback(handleObjectChange);
+    monitor.setIndex(&index);
+    if (coalesceMillis > 0) {
+        CoalescingOptions coalescing;
+        coalescing.window = std::chrono::milliseconds(coalesceMillis);
+        monitor.setCoalescing(coalescing);
+    }
+    if (sliceEntries > 0) {
+        ScanSlicing slicing;
+        slicing.maxEntries = sliceEntries;
+        monitor.setScanSlicing(slicing);
+    }
     analyzer.setAnalysisCallback(handleAnalysisResults);
 
     while (true) {
         try {
             printMenu();
-            choice = getValidatedIntegerInput(0, 10);
+            choice = getValidatedIntegerInput(0, 18);
 
             switch (choice) {
             case 0:
@@ -148,13 +336,54 @@ int main() {
             case 3:
                 std::wcout << L"Enter object name (e.g., \\BaseNamedObjects\\CPFATE_12280_v4.0.30319): ";
                 std::getline(std::wcin, objectName);
+
+                // A bare name is resolved through the index when one has been built.
+                if (!objectName.empty() && objectName[0] != L'\\' && !index.empty()) {
+                    auto matches = index.findName(objectName, 20);
+                    if (matches.size() > 1) {
+                        std::wcout << L"Name is ambiguous; candidates:\n";
+                        for (const auto& entry : matches) {
+                            std::wcout << L"  " << entry.path << L" (" << entry.type << L")\n";
+                        }
+                        break;
+                    }
+                    if (matches.size() == 1) {
+                        objectName = matches[0].path;
+                    }
+                }
+
                 explorer.displayObjectInfo(objectName);
                 break;
 
             case 4:
                 std::wcout << L"Enter directory path to explore recursively (e.g., \\BaseNamedObjects): ";
                 std::getline(std::wcin, path);
-                explorer.exploreNamespace(path, true);
+                std::wcout << L"Enter query, or leave empty for all objects (e.g., type:Event,Mutant !name:Churn_* depth:2): ";
+                std::getline(std::wcin, filterType);
+
+                printOutputFormatMenu();
+                {
+                    int formatChoice = getValidatedIntegerInput(1, 3);
+                    OutputFormat format = formatChoice == 2 ? OutputFormat::Tsv
+                        : formatChoice == 3 ? OutputFormat::Ndjson
+                        : OutputFormat::Human;
+
+                    std::wstring outputPath;
+                    std::wcout << L"Enter output file or pipe path (leave empty for console): ";
+                    std::getline(std::wcin, outputPath);
+
+                    try {
+                        auto output = outputPath.empty() ? OutputSink::console(format) : OutputSink::open(outputPath, format);
+                        explorer.exploreNamespace(path, true, filterType, output.get());
+                        if (!outputPath.empty()) {
+                            std::wcout << L"Listing written to: " << outputPath << L"\n";
+                        }
+                    }
+                    catch (const std::exception& e) {
+                        std::wcout << L"Error exploring namespace: "
+                            << std::wstring(e.what(), e.what() + strlen(e.what())) << L"\n";
+                    }
+                }
                 break;
 
             case 5:
@@ -187,19 +416,14 @@ int main() {
                     std::wcout << L"\nCurrent Object Statistics:\n";
                     std::wcout << L"=======================\n";
 
+                    TimestampFormatter timestamps;
+                    TimestampFormatter::Buffer lastAccess;
                     for (const auto& [name, stat] : stats) {
                         std::wcout << L"Object: " << name << L"\n"
                             << L"  Handles: " << stat.handleCount << L"\n"
                             << L"  References: " << stat.referenceCount << L"\n"
                             << L"  Memory Usage: " << stat.memoryUsage << L" bytes\n"
-                            << L"  Last Access: "
-                            << std::setfill(L'0')
-                            << stat.lastAccessTime.wYear << L"-"
-                            << std::setw(2) << stat.lastAccessTime.wMonth << L"-"
-                            << std::setw(2) << stat.lastAccessTime.wDay << L" "
-                            << std::setw(2) << stat.lastAccessTime.wHour << L":"
-                            << std::setw(2) << stat.lastAccessTime.wMinute << L":"
-                            << std::setw(2) << stat.lastAccessTime.wSecond << L"\n"
+                            << L"  Last Access: " << timestamps.format(stat.lastAccessTime, lastAccess) << L"\n"
                             << L"------------------------\n";
                     }
                 }
@@ -212,22 +436,38 @@ int main() {
             {
                 ReportConfig config;
                 std::wstring outputPath;
+                config.sectionTimeout = std::chrono::milliseconds(sectionTimeoutMillis);
 
                 std::wcout << L"Enter target directory path (e.g., \\BaseNamedObjects): ";
                 std::getline(std::wcin, config.targetDirectory);
 
                 printReportFormatMenu();
-                int formatChoice = getValidatedIntegerInput(1, 2);
+                int formatChoice = getValidatedIntegerInput(1, 4);
 
                 switch (formatChoice) {
                 case 1: config.format = ReportFormat::HTML; break;
                 case 2: config.format = ReportFormat::XML; break;
+                case 3: config.format = ReportFormat::InteractiveHtml; break;
+                case 4:
+                    config.format = ReportFormat::InteractiveHtml;
+                    config.sidecarData = true;
+                    break;
                 }
 
                 std::wcout << L"Enter output file path (e.g., D:\\report.html): ";
                 std::getline(std::wcin, outputPath);
                 config.outputPath = outputPath;
 
+                std::wcout << L"Baseline snapshot to report changes against (empty for a full report): ";
+                std::getline(std::wcin, config.baselinePath);
+                std::wcout << L"Save a snapshot for later delta reports to (empty to skip): ";
+                std::getline(std::wcin, config.snapshotPath);
+                if (config.format != ReportFormat::InteractiveHtml || !config.snapshotPath.empty()) {
+                    config.compression = getValidatedBooleanInput(
+                        L"Compress the output with gzip? (1 = yes, 0 = no): ")
+                        ? OutputCompression::Gzip : OutputCompression::None;
+                }
+
                 try {
                     reporter.generateReport(config);
                     std::wcout << L"Report generated successfully at: " << outputPath << L"\n";
@@ -259,6 +499,23 @@ int main() {
                                 << dep.dependencyType << L")\n";
                         }
                         std::wcout << L"\nTotal dependencies found: " << dependencies.size() << L"\n";
+
+                        std::wstring graphPath;
+                        std::wcout << L"Export graph to a .graphml or .dot file (empty to skip): ";
+                        std::getline(std::wcin, graphPath);
+                        if (!graphPath.empty()) {
+                            DependencyGraph graph(dependencies);
+                            auto graphFile = OutputSink::open(graphPath, OutputFormat::Human);
+                            std::wstring extension = std::filesystem::path(graphPath).extension().wstring();
+                            if (equalsIgnoreCase(extension, L".dot") || equalsIgnoreCase(extension, L".gv")) {
+                                graph.writeDot(*graphFile);
+                            }
+                            else {
+                                graph.writeGraphML(*graphFile);
+                            }
+                            std::wcout << graph.nodeCount() << L" objects and " << graph.edgeCount()
+                                << L" dependencies written to " << graphPath << L"\n";
+                        }
                     }
                 }
                 catch (const std::exception& e) {
@@ -289,6 +546,191 @@ int main() {
                 }
             }
             break;
+
+            case 11:
+            {
+                printMetricsFormatMenu();
+                MetricsFormat format = getValidatedIntegerInput(1, 2) == 1 ? MetricsFormat::Prometheus : MetricsFormat::Json;
+
+                std::wstring outputPath;
+                std::wcout << L"Enter output file path (leave empty to print): ";
+                std::getline(std::wcin, outputPath);
+
+                if (outputPath.empty()) {
+                    std::wcout << L"\n" << Metrics::instance().exportText(format);
+                    break;
+                }
+
+                std::wcout << L"Enter dump interval in seconds (0 = write once): ";
+                int interval = getValidatedIntegerInput(0, 86400);
+
+                try {
+                    if (interval == 0) {
+                        Metrics::instance().exportToFile(outputPath, format);
+                        std::wcout << L"Metrics written to: " << outputPath << L"\n";
+                    }
+                    else {
+                        Metrics::instance().startPeriodicDump(outputPath, format, std::chrono::seconds(interval));
+                        std::wcout << L"Metrics will be dumped to " << outputPath
+                            << L" every " << interval << L" seconds.\n";
+                    }
+                }
+                catch (const std::exception& e) {
+                    std::wcout << L"Error exporting metrics: "
+                        << std::wstring(e.what(), e.what() + strlen(e.what())) << L"\n";
+                }
+            }
+            break;
+
+            case 12:
+            {
+                printIndexMenu();
+                int operation = getValidatedIntegerInput(1, 4);
+
+                if (operation == 1 || index.empty()) {
+                    std::wcout << L"Indexing namespace...\n";
+                    auto start = std::chrono::steady_clock::now();
+                    size_t count = index.build();
+                    auto elapsed = std::chrono::steady_clock::now() - start;
+                    std::wcout << L"Indexed " << count << L" objects in "
+                        << std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() << L" ms ("
+                        << index.memoryUsage() / 1024 << L" KB)\n";
+                    if (operation == 1) {
+                        break;
+                    }
+                }
+
+                std::wcout << (operation == 4 ? L"Enter object name: " : L"Enter path (e.g., \\BaseNamedObjects\\Global): ");
+                std::wstring query;
+                std::getline(std::wcin, query);
+
+                auto start = std::chrono::steady_clock::now();
+                std::vector<NamespaceEntry> results;
+                if (operation == 2) {
+                    NamespaceEntry entry;
+                    if (index.lookup(query, entry)) {
+                        results.push_back(entry);
+                    }
+                }
+                else if (operation == 3) {
+                    results = index.findPrefix(query);
+                }
+                else {
+                    results = index.findName(query);
+                }
+                printIndexResults(results, std::chrono::steady_clock::now() - start);
+            }
+            break;
+
+            case 13:
+                std::wcout << L"Enter directory path (e.g., \\BaseNamedObjects): ";
+                std::getline(std::wcin, path);
+                explorer.auditDirectory(path);
+                break;
+
+            case 14:
+            {
+                std::wcout << L"Enter process ID (0 for all processes): ";
+                int processId = getValidatedIntegerInput(0, std::numeric_limits<int>::max());
+
+                auto start = std::chrono::steady_clock::now();
+                HandleSnapshot snapshot = handleResolver.resolve(static_cast<DWORD>(processId));
+                auto elapsed = std::chrono::steady_clock::now() - start;
+
+                if (!NT_SUCCESS(snapshot.status)) {
+                    std::wcout << L"Failed to read the system handle table. Status: 0x"
+                        << std::hex << snapshot.status << std::dec << L"\n";
+                    break;
+                }
+
+                // Unnamed objects make up most of the table; list named ones only.
+                for (const auto& handle : snapshot.handles) {
+                    const ResolvedObject& object = snapshot.objects[handle.objectIndex];
+                    if (object.state == HandleNameState::Resolved) {
+                        std::wcout << L"PID: " << handle.processId
+                            << L", Handle: 0x" << std::hex << handle.handleValue << std::dec
+                            << L", Type: " << object.type
+                            << L", Name: " << object.name << L"\n";
+                    }
+                }
+
+                std::wcout << snapshot.handles.size() << L" handle(s) to " << snapshot.objects.size()
+                    << L" object(s) resolved in "
+                    << std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() << L" ms; "
+                    << snapshot.processesDenied << L" process(es) could not be opened, "
+                    << snapshot.timedOut << L" name queries timed out, "
+                    << snapshot.skipped << L" skipped\n";
+            }
+            break;
+
+            case 15:
+            {
+                std::wcout << L"Enter object name or directory path (e.g., \\BaseNamedObjects): ";
+                std::getline(std::wcin, objectName);
+
+                NTSTATUS status = analyzer.analyzeObjectRelations(objectName);
+                if (!NT_SUCCESS(status)) {
+                    std::wcout << L"Failed to analyze " << objectName << L". Status: 0x"
+                        << std::hex << status << std::dec << L"\n";
+                }
+            }
+            break;
+
+            case 16:
+            {
+                std::wcout << L"Enter process ID (0 for all processes): ";
+                int processId = getValidatedIntegerInput(0, std::numeric_limits<int>::max());
+
+                auto typeStats = analyzer.getHandleTypeStatistics(static_cast<DWORD>(processId));
+                std::wcout << L"\nHandle Statistics by Type:\n";
+                std::wcout << L"=========================\n";
+
+                for (const auto& entry : typeStats) {
+                    std::wcout << entry.typeName << L": " << entry.handles << L" handles"
+                        << L" (system: " << entry.totalObjects << L" objects, "
+                        << entry.totalHandles << L" handles)\n";
+                }
+            }
+            break;
+
+            case 17:
+            {
+                std::wcout << L"Enter directory path (e.g., \\BaseNamedObjects): ";
+                std::getline(std::wcin, path);
+                std::wcout << L"Enter query (e.g., type:Section name:Global*): ";
+                std::getline(std::wcin, filterType);
+
+                NamespaceEntry found;
+                if (explorer.findObject(path, ObjectQuery::compile(filterType), &found)) {
+                    std::wcout << L"Found: " << found.path << L" (" << found.type << L")\n";
+                }
+                else {
+                    std::wcout << L"No matching object.\n";
+                }
+            }
+            break;
+
+            case 18:
+            {
+                std::wcout << L"Enter directory path (e.g., \\BaseNamedObjects): ";
+                std::getline(std::wcin, path);
+                std::wcout << L"Enter query, or leave empty for all objects: ";
+                std::getline(std::wcin, filterType);
+                std::wcout << L"Enter page size: ";
+                int pageSize = getValidatedIntegerInput(1, 100000);
+
+                ObjectQuery query = ObjectQuery::compile(filterType);
+                DirectoryCursor cursor;
+                while (explorer.listPage(path, query, cursor, static_cast<size_t>(pageSize))) {
+                    std::wcout << L"Press Enter for the next page, or q to stop: ";
+                    std::wstring answer;
+                    std::getline(std::wcin, answer);
+                    if (!answer.empty() && (answer[0] == L'q' || answer[0] == L'Q')) {
+                        break;
+                    }
+                }
+            }
+            break;
             }
         }
         catch (const std::exception& e) {